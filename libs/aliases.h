@@ -2,7 +2,9 @@
 #define BOARD_BEE_LIBS_ALIASES_H_
 
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -46,6 +48,36 @@ sptr<T> mk_sptr(Args&&... args) { return std::make_shared<T>(args...); }
 template <typename K, typename V>
 using HashMap = std::unordered_map<K, V>;
 
+// Hashes every kind of string as a str_view, so maps keyed by strings can be
+// searched with a str_view instead of a key built from it.
+struct StrHash {
+  using is_transparent = void;
+  size_t operator()(const str_view s) const {
+    return std::hash<str_view>()(s);
+  }
+};
+
+// A HashMap keyed by strings whose find() takes a str_view.
+template <typename V>
+using StrHashMap = std::unordered_map<str, V, StrHash, std::equal_to<>>;
+
 using std::vector;
 
+// Variants of the above whose storage comes from a std::pmr::memory_resource.
+namespace pmr {
+
+using str = std::pmr::string;
+
+template <typename K, typename V>
+using HashMap = std::pmr::unordered_map<K, V>;
+
+template <typename V>
+using StrHashMap =
+    std::pmr::unordered_map<str, V, StrHash, std::equal_to<>>;
+
+template <typename T>
+using vector = std::pmr::vector<T>;
+
+}  // namespace pmr
+
 #endif  // BOARD_BEE_LIBS_ALIASES_H_
@@ -0,0 +1,102 @@
+#include "arena_allocator.h"
+
+#if __has_include(<sys/mman.h>) && __has_include(<unistd.h>)
+#define ROSE_ARENA_HAS_MMAP 1
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define ROSE_ARENA_HAS_MMAP 0
+#endif
+
+#include "aliases.h"
+
+namespace rose {
+
+namespace {
+
+// Size of a transparent huge page on x86-64 and 4K-page AArch64.
+constexpr size_t kHugePageBytes = 2 * 1024 * 1024;  // 2 MiB
+
+size_t RoundUp(const size_t bytes, const size_t multiple) {
+  return (bytes + multiple - 1) / multiple * multiple;
+}
+
+#if ROSE_ARENA_HAS_MMAP
+size_t PageBytes() {
+  static const size_t page_bytes = sysconf(_SC_PAGESIZE);
+  return page_bytes;
+}
+#endif
+
+}  // namespace
+
+#if ROSE_ARENA_HAS_MMAP
+
+std::byte *ArenaAllocator::MapBuffer(size_t &bytes,
+                                     const ArenaOptions &options) {
+  bytes = RoundUp(std::max<size_t>(bytes, 1),
+                  options.huge_pages ? kHugePageBytes : PageBytes());
+  // Huge pages only back 2 MiB-aligned ranges, so over-reserve and trim.
+  const size_t slack = options.huge_pages ? kHugePageBytes : 0;
+  s32 flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+  // MAP_POPULATE would fault in small pages before madvise could ask for huge
+  // ones, so huge-page arenas are prefaulted after the madvise call instead.
+#ifdef MAP_POPULATE
+  if (options.prefault && !options.huge_pages) flags |= MAP_POPULATE;
+#endif
+  void *mapping =
+      mmap(nullptr, bytes + slack, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (mapping == MAP_FAILED) throw std::bad_alloc();
+  auto *buffer = static_cast<std::byte *>(mapping);
+  if (slack != 0) {
+    const auto address = reinterpret_cast<uintptr_t>(buffer);
+    auto *aligned = reinterpret_cast<std::byte *>(RoundUp(address, slack));
+    if (aligned != buffer) munmap(buffer, aligned - buffer);
+    std::byte *tail = aligned + bytes;
+    std::byte *mapping_end = buffer + bytes + slack;
+    if (tail != mapping_end) munmap(tail, mapping_end - tail);
+    buffer = aligned;
+  }
+#ifdef MADV_HUGEPAGE
+  if (options.huge_pages) madvise(buffer, bytes, MADV_HUGEPAGE);
+#endif
+  if (options.prefault && options.huge_pages) {
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(buffer, bytes, MADV_POPULATE_WRITE) == 0) return buffer;
+#endif
+    // Older kernels: touch one byte per page ourselves.
+    for (size_t i = 0; i < bytes; i += PageBytes()) {
+      *static_cast<volatile std::byte *>(buffer + i) = std::byte{0};
+    }
+  }
+  return buffer;
+}
+
+void ArenaAllocator::UnmapBuffer(std::byte *buffer,
+                                 const size_t bytes) noexcept {
+  munmap(buffer, bytes);
+}
+
+void ArenaAllocator::ReleasePages(std::byte *begin, std::byte *end) noexcept {
+  // madvise needs a page-aligned start; `begin` is the buffer start, which is.
+  const size_t used = RoundUp(end - begin, PageBytes());
+  if (used != 0) madvise(begin, used, MADV_DONTNEED);
+}
+
+#else
+
+std::byte *ArenaAllocator::MapBuffer(size_t &bytes, const ArenaOptions &) {
+  auto *buffer = static_cast<std::byte *>(malloc(bytes));
+  if (!buffer && bytes != 0) throw std::bad_alloc();
+  return buffer;
+}
+
+void ArenaAllocator::UnmapBuffer(std::byte *buffer, size_t) noexcept {
+  free(buffer);
+}
+
+void ArenaAllocator::ReleasePages(std::byte *, std::byte *) noexcept {}
+
+#endif
+
+}  // namespace rose
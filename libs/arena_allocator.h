@@ -2,52 +2,350 @@
 #define BOARD_BEE_LIBS_ARENA_ALLOCATOR_H_
 
 #include "aliases.h"
+#include "arena_stats.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <functional>  // I don't know why they put std::byte here.
+#include <limits>
+#include <memory_resource>
+#include <new>
 #include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 namespace rose {
 
+class ArenaAllocator;
+
+// Controls how a fixed-size ArenaAllocator obtains and gives back its buffer.
+// Long-lived arenas (e.g. the one holding a parsed document) tend to benefit
+// from huge pages and prefaulting; short-lived scratch arenas usually don't.
+struct ArenaOptions {
+  enum class Backing {
+    // One malloc'd buffer. Cheap to create, but page faults happen lazily.
+    kMalloc,
+    // Anonymous mmap'd address space. Falls back to malloc where mmap isn't
+    // available.
+    kMmap
+  };
+
+  Backing backing = Backing::kMalloc;
+  // Ask for transparent huge pages with madvise(MADV_HUGEPAGE) (kMmap only).
+  bool huge_pages = false;
+  // Fault every page in up front, e.g. with MAP_POPULATE (kMmap only).
+  bool prefault = false;
+  // Hand used pages back to the OS with MADV_DONTNEED on Reset (kMmap only).
+  bool release_on_reset = true;
+};
+
+// Exposes an ArenaAllocator as a std::pmr::memory_resource so that pmr
+// containers can draw from it. Deallocation is a no-op; memory is reclaimed
+// all at once when the underlying arena is reset.
+class ArenaResource final : public std::pmr::memory_resource {
+ public:
+  explicit ArenaResource(ArenaAllocator *arena) : arena_(arena) {}
+
+  ArenaAllocator *arena() const { return arena_; }
+
+ private:
+  friend class ArenaAllocator;
+
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *, size_t, size_t) override {}
+  bool do_is_equal(
+      const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+  ArenaAllocator *arena_;
+};
+
+// Bump allocator over either a single fixed-size buffer or a chain of blocks
+// requested from an upstream memory resource.
+// Every allocation is aligned for the requested type, and objects made with
+// Create are destroyed (in reverse order) when the arena is reset.
 class ArenaAllocator {
  public:
-  explicit ArenaAllocator(const size_t bytes) : bytes_(bytes) {
-    buffer_ = static_cast<std::byte *>(malloc(bytes_));
+  // Makes a fixed-size arena over one buffer of at least `bytes` bytes,
+  // obtained as described by `options`.
+  // Allocations that don't fit in what's left of the buffer throw.
+  explicit ArenaAllocator(const size_t bytes, const ArenaOptions &options = {})
+      : bytes_(bytes), options_(options) {
+    if (options_.backing == ArenaOptions::Backing::kMmap) {
+      buffer_ = MapBuffer(bytes_, options_);
+    } else {
+      buffer_ = static_cast<std::byte *>(malloc(bytes_));
+      if (!buffer_ && bytes_ != 0) throw std::bad_alloc();
+    }
     start_ = buffer_;
     end_ = buffer_ + bytes_;
     pos_ = start_;
+    capacity_ = bytes_;
   }
+  // Makes a growable arena that requests blocks of (at least) `block_bytes`
+  // bytes from `upstream` whenever the current block runs out. Blocks are
+  // handed back to `upstream` on Reset. No memory is requested up front.
+  ArenaAllocator(const size_t block_bytes,
+                 std::pmr::memory_resource *upstream)
+      : bytes_(block_bytes), upstream_(upstream) {}
   ArenaAllocator(const ArenaAllocator &other) = delete;
   ArenaAllocator &operator=(const ArenaAllocator &other) = delete;
-  ArenaAllocator(ArenaAllocator &&other) = default;
-  ArenaAllocator &operator=(ArenaAllocator &&other) = default;
-  ~ArenaAllocator() { free(buffer_); }
+  // Containers built on `other.resource()` are NOT redirected to this arena,
+  // so move an arena before handing out its resource, never after.
+  ArenaAllocator(ArenaAllocator &&other) noexcept
+      : bytes_(std::exchange(other.bytes_, 0)),
+        options_(other.options_),
+        upstream_(std::exchange(other.upstream_, nullptr)),
+        buffer_(std::exchange(other.buffer_, nullptr)),
+        blocks_(std::exchange(other.blocks_, nullptr)),
+        start_(std::exchange(other.start_, nullptr)),
+        end_(std::exchange(other.end_, nullptr)),
+        pos_(std::exchange(other.pos_, nullptr)),
+        capacity_(std::exchange(other.capacity_, 0)),
+        retired_bytes_(std::exchange(other.retired_bytes_, 0)),
+        destructors_(std::exchange(other.destructors_, nullptr)),
+        phase_(other.phase_),
+        stats_(std::exchange(other.stats_, {})) {}
+  ArenaAllocator &operator=(ArenaAllocator &&other) noexcept {
+    if (this == &other) return *this;
+    Reset();
+    FreeBuffer();
+    bytes_ = std::exchange(other.bytes_, 0);
+    options_ = other.options_;
+    upstream_ = std::exchange(other.upstream_, nullptr);
+    buffer_ = std::exchange(other.buffer_, nullptr);
+    blocks_ = std::exchange(other.blocks_, nullptr);
+    start_ = std::exchange(other.start_, nullptr);
+    end_ = std::exchange(other.end_, nullptr);
+    pos_ = std::exchange(other.pos_, nullptr);
+    capacity_ = std::exchange(other.capacity_, 0);
+    retired_bytes_ = std::exchange(other.retired_bytes_, 0);
+    destructors_ = std::exchange(other.destructors_, nullptr);
+    phase_ = other.phase_;
+    stats_ = std::exchange(other.stats_, {});
+    return *this;
+  }
+  ~ArenaAllocator() {
+    Reset();
+    FreeBuffer();
+  }
 
+  // Returns a memory resource that allocates from this arena.
+  // Useful for building pmr containers whose storage dies with the arena.
+  std::pmr::memory_resource *resource() { return &resource_; }
+
+  // Returns the total number of bytes this arena currently holds.
+  size_t capacity() const { return capacity_; }
+  // Returns the number of bytes handed out (including alignment padding).
+  size_t used_bytes() const { return retired_bytes_ + (pos_ - start_); }
+  // Returns the number of bytes left in the current buffer or block.
   size_t free_bytes() const { return end_ - pos_; }
 
+  // Returns the phase that new allocations are currently counted against.
+  ArenaPhase phase() const { return phase_; }
+  // Counts every allocation from now on against `phase`.
+  void set_phase(const ArenaPhase phase) { phase_ = phase; }
+  // Returns everything measured since construction or the last ClearStats.
+  ArenaStats stats() const {
+    ArenaStats stats = stats_;
+    stats.bytes_committed = capacity_;
+    return stats;
+  }
+  // Zeroes every counter (the high-water mark restarts from current usage).
+  void ClearStats() {
+    stats_ = {};
+    stats_.high_water_mark = used_bytes();
+  }
+
+  // Returns a pointer to `bytes` bytes of uninitialized memory whose address
+  // is a multiple of `alignment`, which must be a power of two.
+  // Throws a std::runtime_error if the arena doesn't have enough room left.
+  void *AllocateBytes(const size_t bytes, const size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+      std::stringstream error_msg;
+      error_msg << "Alignment " << alignment << " is not a power of two";
+      throw std::runtime_error(error_msg.str());
+    }
+    size_t padding = Padding(pos_, alignment);
+    if ((padding > free_bytes() || bytes > free_bytes() - padding)
+        && upstream_) {
+      Grow(bytes, alignment);
+      padding = Padding(pos_, alignment);
+    }
+    if (padding > free_bytes() || bytes > free_bytes() - padding) {
+      std::stringstream error_msg;
+      error_msg << "Tried to allocate " << bytes << " bytes (plus " << padding
+                << " bytes of padding), but only " << free_bytes()
+                << " bytes are free";
+      throw std::runtime_error(error_msg.str());
+    }
+    std::byte *old_pos = pos_ + padding;
+    pos_ = old_pos + bytes;
+    stats_.phase(phase_).RecordAllocation(bytes, padding);
+    stats_.high_water_mark = std::max<u64>(stats_.high_water_mark,
+                                           used_bytes());
+    return old_pos;
+  }
+
+  // Returns uninitialized, correctly aligned room for `num_objects` Ts.
+  // No constructors are run, so prefer Create for anything but plain data.
   template <typename T>
   T *Allocate(const u64 num_objects = 1) {
     if (num_objects == 0) {
       throw std::runtime_error("Tried to allocate room for 0 objects");
     }
-    if (num_objects * sizeof(T) > free_bytes()) {
-      std::stringstream error_msg("Tried to allocate ");
-      error_msg << sizeof(T) << " bytes, but only " << free_bytes()
-                << "are free";
+    if (num_objects > std::numeric_limits<size_t>::max() / sizeof(T)) {
+      std::stringstream error_msg;
+      error_msg << "Tried to allocate room for " << num_objects
+                << " objects, which overflows size_t";
       throw std::runtime_error(error_msg.str());
     }
-    void *old_pos = pos_;
-    pos_ += num_objects * sizeof(T);
-    return static_cast<T *>(old_pos);
+    void *memory = AllocateBytes(num_objects * sizeof(T), alignof(T));
+    return static_cast<T *>(memory);
+  }
+
+  // Constructs a T in place from `args` and returns a pointer to it.
+  // If T isn't trivially destructible, its destructor is registered and will
+  // run when the arena is reset or destroyed.
+  template <typename T, typename... Args>
+  T *Create(Args &&...args) {
+    if constexpr (std::is_trivially_destructible_v<T>) {
+      return new (Allocate<T>()) T(std::forward<Args>(args)...);
+    } else {
+      // Reserve the registry entry first so a full arena can't leave us with
+      // a live object whose destructor is never run.
+      auto *entry = Allocate<Destructor>();
+      T *object = new (Allocate<T>()) T(std::forward<Args>(args)...);
+      entry->destroy = [](void *ptr) { static_cast<T *>(ptr)->~T(); };
+      entry->object = object;
+      entry->next = destructors_;
+      destructors_ = entry;
+      return object;
+    }
+  }
+
+  // Constructs a T in place from `args` without registering its destructor.
+  // Only use this when everything T owns also lives in this arena (e.g. pmr
+  // containers built on `resource()`), so that skipping the destructor is
+  // harmless and teardown stays O(1).
+  template <typename T, typename... Args>
+  T *CreateUnmanaged(Args &&...args) {
+    return new (Allocate<T>()) T(std::forward<Args>(args)...);
+  }
+
+  // Runs the destructors of every non-trivial object made with Create (most
+  // recent first) and makes the whole buffer available again.
+  // A growable arena also returns all of its blocks to its upstream resource.
+  void Reset() noexcept {
+    while (destructors_) {
+      destructors_->destroy(destructors_->object);
+      destructors_ = destructors_->next;
+    }
+    retired_bytes_ = 0;
+    if (!upstream_) {
+      if (options_.backing == ArenaOptions::Backing::kMmap
+          && options_.release_on_reset) {
+        ReleasePages(start_, pos_);
+      }
+      pos_ = start_;
+      return;
+    }
+    while (blocks_) {
+      Block *previous = blocks_->previous;
+      upstream_->deallocate(blocks_, blocks_->bytes, alignof(Block));
+      blocks_ = previous;
+    }
+    start_ = end_ = pos_ = nullptr;
+    capacity_ = 0;
   }
 
  private:
+  // Intrusive, arena-allocated entry in the destructor registry.
+  struct Destructor {
+    void (*destroy)(void *);
+    void *object;
+    Destructor *next;
+  };
+
+  // Header at the start of every block requested from `upstream_`.
+  struct alignas(std::max_align_t) Block {
+    Block *previous;
+    size_t bytes;
+  };
+
+  // Requests a new block from `upstream_` big enough to hold `bytes` bytes
+  // at `alignment`. Whatever was left of the current block is abandoned.
+  void Grow(const size_t bytes, const size_t alignment) {
+    const size_t needed = sizeof(Block) + bytes + alignment - 1;
+    if (needed < bytes) throw std::bad_alloc();
+    const size_t block_bytes = std::max(bytes_, needed);
+    auto *block = static_cast<Block *>(
+        upstream_->allocate(block_bytes, alignof(Block)));
+    block->previous = blocks_;
+    block->bytes = block_bytes;
+    blocks_ = block;
+    stats_.phase(phase_).chunk_tail_bytes += end_ - pos_;
+    retired_bytes_ += pos_ - start_;
+    capacity_ += block_bytes;
+    start_ = reinterpret_cast<std::byte *>(block) + sizeof(Block);
+    end_ = reinterpret_cast<std::byte *>(block) + block_bytes;
+    pos_ = start_;
+  }
+
+  // Reserves (and, depending on `options`, prefaults) at least `bytes` bytes
+  // of anonymous memory. Rounds `bytes` up to the page size it ends up using.
+  static std::byte *MapBuffer(size_t &bytes, const ArenaOptions &options);
+  // Gives back a buffer obtained from MapBuffer.
+  static void UnmapBuffer(std::byte *buffer, size_t bytes) noexcept;
+  // Tells the OS it may reclaim the pages in [begin, end) of a mapped buffer.
+  static void ReleasePages(std::byte *begin, std::byte *end) noexcept;
+
+  void FreeBuffer() noexcept {
+    if (!buffer_) return;
+    if (options_.backing == ArenaOptions::Backing::kMmap) {
+      UnmapBuffer(buffer_, bytes_);
+    } else {
+      free(buffer_);
+    }
+    buffer_ = nullptr;
+  }
+
+  // Returns the number of bytes needed to align `ptr` to `alignment`.
+  static size_t Padding(const std::byte *ptr, const size_t alignment) {
+    const auto address = reinterpret_cast<uintptr_t>(ptr);
+    return (alignment - (address & (alignment - 1))) & (alignment - 1);
+  }
+
+  // Size of the fixed buffer, or the minimum size of each upstream block.
   size_t bytes_;
-  std::byte *buffer_;
-  std::byte *start_;
-  std::byte *end_;
-  std::byte *pos_;
+  // How the fixed buffer was obtained (unused by growable arenas).
+  ArenaOptions options_;
+  // Source of blocks for a growable arena (nullptr for a fixed-size one).
+  std::pmr::memory_resource *upstream_ = nullptr;
+  // Fixed-size buffer from malloc (nullptr for a growable arena).
+  std::byte *buffer_ = nullptr;
+  // Most recently requested upstream block (singly-linked, newest first).
+  Block *blocks_ = nullptr;
+  std::byte *start_ = nullptr;
+  std::byte *end_ = nullptr;
+  std::byte *pos_ = nullptr;
+  size_t capacity_ = 0;
+  // Bytes used in blocks that have since been abandoned by Grow.
+  size_t retired_bytes_ = 0;
+  // Most recently registered destructor (singly-linked, newest first).
+  Destructor *destructors_ = nullptr;
+  ArenaPhase phase_ = ArenaPhase::kUntagged;
+  ArenaStats stats_;
+  ArenaResource resource_{this};
 };
 
+inline void *ArenaResource::do_allocate(const size_t bytes,
+                                        const size_t alignment) {
+  return arena_->AllocateBytes(bytes, alignment);
+}
+
 }  // namespace rose
 
 #endif  // BOARD_BEE_LIBS_ARENA_ALLOCATOR_H_
@@ -0,0 +1,95 @@
+#ifndef BOARD_BEE_LIBS_ARENA_STATS_H_
+#define BOARD_BEE_LIBS_ARENA_STATS_H_
+
+#include "aliases.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace rose {
+
+// What an arena is being used for. Every allocation is counted against the
+// phase its arena was tagged with at the time.
+enum class ArenaPhase : u8 { kUntagged, kTokenize, kParse, kDomainBuild };
+
+inline constexpr size_t kArenaPhaseCount = 4;
+
+// Returns a short, human-readable name for `phase`.
+constexpr const char *ArenaPhaseName(const ArenaPhase phase) {
+  switch (phase) {
+    case ArenaPhase::kUntagged: return "untagged";
+    case ArenaPhase::kTokenize: return "tokenize";
+    case ArenaPhase::kParse: return "parse";
+    case ArenaPhase::kDomainBuild: return "domain_build";
+  }
+  return "unknown";
+}
+
+// Allocation counters for a single ArenaPhase.
+struct ArenaPhaseStats {
+  // Number of buckets in `size_histogram`.
+  static constexpr size_t kHistogramBuckets = 16;
+
+  // Returns the `size_histogram` bucket that a `bytes`-byte allocation
+  // falls into. Bucket 0 holds allocations of at most 1 byte, bucket i holds
+  // those of (2^(i-1), 2^i] bytes, and the last bucket holds everything else.
+  static constexpr size_t Bucket(const size_t bytes) {
+    if (bytes <= 1) return 0;
+    return std::min<size_t>(std::bit_width(bytes - 1), kHistogramBuckets - 1);
+  }
+
+  // Records one allocation of `bytes` bytes preceded by `padding` bytes of
+  // alignment padding.
+  void RecordAllocation(const size_t bytes, const size_t padding) {
+    ++allocations;
+    bytes_requested += bytes;
+    padding_bytes += padding;
+    ++size_histogram[Bucket(bytes)];
+  }
+
+  u64 allocations = 0;
+  // Sum of the sizes passed to the arena.
+  u64 bytes_requested = 0;
+  // Bytes skipped to satisfy alignment requirements.
+  u64 padding_bytes = 0;
+  // Bytes left unused at the end of a block when the arena had to grow.
+  u64 chunk_tail_bytes = 0;
+  std::array<u64, kHistogramBuckets> size_histogram{};
+};
+
+// Everything an ArenaAllocator has measured since it was made (or since its
+// stats were last cleared). Survives Reset, so it covers a whole run.
+struct ArenaStats {
+  ArenaPhaseStats &phase(const ArenaPhase phase) {
+    return phases[static_cast<size_t>(phase)];
+  }
+  const ArenaPhaseStats &phase(const ArenaPhase phase) const {
+    return phases[static_cast<size_t>(phase)];
+  }
+
+  // Returns the counters of every phase added together.
+  ArenaPhaseStats Total() const {
+    ArenaPhaseStats total;
+    for (const ArenaPhaseStats &stats : phases) {
+      total.allocations += stats.allocations;
+      total.bytes_requested += stats.bytes_requested;
+      total.padding_bytes += stats.padding_bytes;
+      total.chunk_tail_bytes += stats.chunk_tail_bytes;
+      for (size_t i = 0; i < ArenaPhaseStats::kHistogramBuckets; ++i) {
+        total.size_histogram[i] += stats.size_histogram[i];
+      }
+    }
+    return total;
+  }
+
+  // Bytes the arena currently holds (its buffer or all of its blocks).
+  u64 bytes_committed = 0;
+  // Most bytes (including alignment padding) ever in use at once.
+  u64 high_water_mark = 0;
+  std::array<ArenaPhaseStats, kArenaPhaseCount> phases{};
+};
+
+}  // namespace rose
+
+#endif  // BOARD_BEE_LIBS_ARENA_STATS_H_
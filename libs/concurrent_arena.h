@@ -0,0 +1,165 @@
+#ifndef BOARD_BEE_LIBS_CONCURRENT_ARENA_H_
+#define BOARD_BEE_LIBS_CONCURRENT_ARENA_H_
+
+#include "aliases.h"
+#include "arena_allocator.h"
+
+#include <array>
+#include <atomic>
+#include <memory_resource>
+#include <new>
+
+namespace rose {
+
+// Thread-safe arena shared by several threads.
+// Memory is carved out of large slabs with a single atomic add, and new slabs
+// are published with a compare-and-swap, so neither allocating nor growing
+// ever takes a lock. Each thread normally allocates through Local(), which
+// gives it a private ArenaAllocator whose blocks are carved from this pool.
+// Everything is released together when the pool is reset or destroyed.
+class ConcurrentArena final : public std::pmr::memory_resource {
+ public:
+  // Default size of each slab requested from the global heap.
+  static constexpr size_t kDefaultSlabBytes = 4 * 1024 * 1024;  // 4 MiB
+  // Default size of each block handed to a thread-local arena.
+  static constexpr size_t kDefaultRegionBytes = 64 * 1024;  // 64 KiB
+  // Number of (pool, thread-local arena) pairs each thread remembers.
+  static constexpr size_t kLocalCacheSize = 4;
+
+  explicit ConcurrentArena(const size_t slab_bytes = kDefaultSlabBytes,
+                           const size_t region_bytes = kDefaultRegionBytes)
+      : slab_bytes_(slab_bytes), region_bytes_(region_bytes) {}
+  // Thread-local arenas hold pointers into this pool, so it can't move.
+  ConcurrentArena(const ConcurrentArena &other) = delete;
+  ConcurrentArena &operator=(const ConcurrentArena &other) = delete;
+  ~ConcurrentArena() override { Reset(); }
+
+  // Returns the calling thread's arena for this pool, making it on first use.
+  // The returned arena must only be used by the calling thread.
+  ArenaAllocator &Local() {
+    thread_local std::array<LocalCacheEntry, kLocalCacheSize> cache{};
+    thread_local size_t next_victim = 0;
+    const u64 id = id_.load(std::memory_order_acquire);
+    for (const LocalCacheEntry &entry : cache) {
+      if (entry.pool_id == id) return *entry.arena;
+    }
+    auto *local = static_cast<LocalArena *>(
+        Carve(sizeof(LocalArena), alignof(LocalArena)));
+    new (local) LocalArena{ArenaAllocator(region_bytes_, this), nullptr};
+    local->next = locals_.load(std::memory_order_relaxed);
+    while (!locals_.compare_exchange_weak(local->next, local,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed)) {}
+    cache[next_victim] = {id, &local->arena};
+    next_victim = (next_victim + 1) % kLocalCacheSize;
+    return local->arena;
+  }
+
+  // Returns `bytes` bytes aligned to `alignment` (a power of two).
+  // Safe to call from any number of threads at once.
+  void *Carve(const size_t bytes, const size_t alignment) {
+    const size_t reserved = bytes + alignment - 1;
+    if (reserved < bytes) throw std::bad_alloc();
+    Slab *slab = head_.load(std::memory_order_acquire);
+    while (true) {
+      if (slab) {
+        const size_t offset =
+            slab->offset.fetch_add(reserved, std::memory_order_relaxed);
+        if (offset <= slab->capacity && reserved <= slab->capacity - offset) {
+          const auto address = reinterpret_cast<uintptr_t>(slab->data())
+                             + offset;
+          const uintptr_t aligned = (address + alignment - 1)
+                                  & ~static_cast<uintptr_t>(alignment - 1);
+          return reinterpret_cast<void *>(aligned);
+        }
+      }
+      slab = Grow(slab, reserved);
+    }
+  }
+
+  // Destroys every thread-local arena and frees every slab.
+  // Must not run concurrently with any other use of this pool, and
+  // invalidates every reference previously returned by Local().
+  void Reset() noexcept {
+    LocalArena *local = locals_.exchange(nullptr, std::memory_order_acquire);
+    while (local) {
+      LocalArena *next = local->next;
+      local->~LocalArena();
+      local = next;
+    }
+    Slab *slab = head_.exchange(nullptr, std::memory_order_acquire);
+    while (slab) {
+      Slab *next = slab->next;
+      ::operator delete(slab, std::align_val_t{alignof(Slab)});
+      slab = next;
+    }
+    // Threads may still cache arenas made under the old id, so retire it.
+    id_.store(NextId(), std::memory_order_release);
+  }
+
+ private:
+  // Header at the start of every slab; the usable bytes follow it.
+  struct alignas(std::max_align_t) Slab {
+    Slab *next;
+    size_t capacity;
+    std::atomic<size_t> offset;
+
+    std::byte *data() { return reinterpret_cast<std::byte *>(this + 1); }
+  };
+
+  // A thread-local arena along with the next one made from this pool.
+  struct LocalArena {
+    ArenaAllocator arena;
+    LocalArena *next;
+  };
+
+  struct LocalCacheEntry {
+    u64 pool_id = 0;
+    ArenaAllocator *arena = nullptr;
+  };
+
+  // Returns an id that no pool (or earlier generation of one) has used.
+  static u64 NextId() {
+    static std::atomic<u64> next_id = 1;
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Publishes a new slab with room for at least `bytes` bytes, unless some
+  // other thread has already replaced `expected`. Returns the current head.
+  Slab *Grow(Slab *expected, const size_t bytes) {
+    const size_t capacity = std::max(slab_bytes_, bytes);
+    void *memory = ::operator new(sizeof(Slab) + capacity,
+                                  std::align_val_t{alignof(Slab)});
+    auto *slab = new (memory) Slab{expected, capacity, 0};
+    if (head_.compare_exchange_strong(expected, slab,
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+      return slab;
+    }
+    // Somebody else grew the pool first; use their slab instead.
+    ::operator delete(memory, std::align_val_t{alignof(Slab)});
+    return expected;
+  }
+
+  void *do_allocate(const size_t bytes, const size_t alignment) override {
+    return Carve(bytes, alignment);
+  }
+  void do_deallocate(void *, size_t, size_t) override {}
+  bool do_is_equal(
+      const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+  size_t slab_bytes_;
+  size_t region_bytes_;
+  // Most recently published slab (singly-linked, newest first).
+  std::atomic<Slab *> head_ = nullptr;
+  // Every thread-local arena made from this pool.
+  std::atomic<LocalArena *> locals_ = nullptr;
+  // Identifies this generation of the pool in each thread's Local() cache.
+  std::atomic<u64> id_ = NextId();
+};
+
+}  // namespace rose
+
+#endif  // BOARD_BEE_LIBS_CONCURRENT_ARENA_H_
@@ -0,0 +1,171 @@
+#ifndef BOARD_BEE_LIBS_INDEXED_HEAP_H_
+#define BOARD_BEE_LIBS_INDEXED_HEAP_H_
+
+#include "aliases.h"
+
+#include <algorithm>
+#include <limits>
+#include <memory_resource>
+#include <utility>
+
+namespace rose {
+
+// Min-heap of (Key, Value) pairs that hands out a Handle for each one, so
+// entries can be erased or given a new key in O(log n) as well as pushed
+// and popped.
+// Each node has `kArity` children, so the heap is shallower than a binary
+// one and a node's children share a cache line or two. Keys sit in the heap
+// array itself; values and positions live in a separate slot table that
+// handles index into.
+template <typename Key, typename Value, u32 kArity = 4>
+class IndexedHeap {
+ public:
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+  using Handle = u32;
+
+  explicit IndexedHeap(const allocator_type &alloc = {})
+      : heap_(alloc), slots_(alloc), free_(alloc) {}
+
+  allocator_type get_allocator() const { return heap_.get_allocator(); }
+
+  u64 size() const { return heap_.size(); }
+  bool empty() const { return heap_.empty(); }
+
+  void reserve(const u64 n) {
+    heap_.reserve(n);
+    slots_.reserve(n);
+  }
+  void clear() {
+    heap_.clear();
+    slots_.clear();
+    free_.clear();
+  }
+
+  // Returns the handle of the entry with the smallest key. Must not be
+  // empty.
+  Handle top() const { return heap_.front().handle; }
+  const Key &top_key() const { return heap_.front().key; }
+
+  const Key &key(const Handle handle) const {
+    return heap_[slots_[handle].position].key;
+  }
+  Value &value(const Handle handle) { return slots_[handle].value; }
+  const Value &value(const Handle handle) const {
+    return slots_[handle].value;
+  }
+
+  // Adds `value` with `key` and returns a handle to it, valid until it's
+  // popped or erased.
+  Handle Push(const Key &key, Value value) {
+    Handle handle;
+    if (free_.empty()) {
+      handle = static_cast<Handle>(slots_.size());
+      slots_.emplace_back();
+    } else {
+      handle = free_.back();
+      free_.pop_back();
+    }
+    slots_[handle].value = std::move(value);
+    heap_.push_back({key, handle});
+    SiftUp(heap_.size() - 1);
+    return handle;
+  }
+
+  // Removes the entry with the smallest key and returns its value.
+  Value Pop() {
+    const Handle handle = top();
+    Value value = std::move(slots_[handle].value);
+    Erase(handle);
+    return value;
+  }
+
+  // Removes the entry `handle` refers to.
+  void Erase(const Handle handle) {
+    const u64 position = slots_[handle].position;
+    slots_[handle].position = kNil;
+    free_.push_back(handle);
+    const u64 last = heap_.size() - 1;
+    if (position != last) {
+      heap_[position] = heap_[last];
+      slots_[heap_[position].handle].position = static_cast<u32>(position);
+      heap_.pop_back();
+      Restore(position);
+    } else {
+      heap_.pop_back();
+    }
+  }
+
+  // Gives the entry `handle` refers to a new key.
+  void Update(const Handle handle, const Key &key) {
+    const u64 position = slots_[handle].position;
+    heap_[position].key = key;
+    Restore(position);
+  }
+
+ private:
+  static constexpr u32 kNil = std::numeric_limits<u32>::max();
+
+  struct Entry {
+    Key key;
+    Handle handle;
+  };
+
+  struct Slot {
+    Value value{};
+    // Index of this slot's entry in `heap_`, or kNil once it's gone.
+    u32 position = kNil;
+  };
+
+  // Moves the entry at `position` to wherever its key now belongs.
+  void Restore(const u64 position) {
+    if (position > 0
+        && heap_[position].key < heap_[(position - 1) / kArity].key) {
+      SiftUp(position);
+    } else {
+      SiftDown(position);
+    }
+  }
+
+  void SiftUp(u64 position) {
+    const Entry entry = heap_[position];
+    while (position > 0) {
+      const u64 parent = (position - 1) / kArity;
+      if (!(entry.key < heap_[parent].key)) break;
+      Place(position, heap_[parent]);
+      position = parent;
+    }
+    Place(position, entry);
+  }
+
+  void SiftDown(u64 position) {
+    const Entry entry = heap_[position];
+    const u64 size = heap_.size();
+    while (true) {
+      const u64 first = position * kArity + 1;
+      if (first >= size) break;
+      const u64 end = std::min<u64>(first + kArity, size);
+      u64 smallest = first;
+      for (u64 child = first + 1; child < end; ++child) {
+        if (heap_[child].key < heap_[smallest].key) smallest = child;
+      }
+      if (!(heap_[smallest].key < entry.key)) break;
+      Place(position, heap_[smallest]);
+      position = smallest;
+    }
+    Place(position, entry);
+  }
+
+  void Place(const u64 position, const Entry &entry) {
+    heap_[position] = entry;
+    slots_[entry.handle].position = static_cast<u32>(position);
+  }
+
+  std::pmr::vector<Entry> heap_;
+  std::pmr::vector<Slot> slots_;
+  // Handles of erased entries, ready for reuse.
+  std::pmr::vector<Handle> free_;
+};
+
+}  // namespace rose
+
+#endif  // BOARD_BEE_LIBS_INDEXED_HEAP_H_
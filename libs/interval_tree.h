@@ -0,0 +1,246 @@
+#ifndef BOARD_BEE_LIBS_INTERVAL_TREE_H_
+#define BOARD_BEE_LIBS_INTERVAL_TREE_H_
+
+#include "aliases.h"
+
+#include <algorithm>
+#include <limits>
+#include <memory_resource>
+#include <utility>
+
+namespace rose {
+
+// Closed intervals [start, end] with a Value each, indexed for overlap,
+// stabbing and "next k" queries. With k intervals reported, "next k" takes
+// O(log n + k) expected time. Overlap and stabbing queries take
+// O(min(n, (k + 1) log n)): each interval reported can cost a path of its
+// own, since subtrees are only skipped once they end too early.
+// A treap ordered by start, where each node also knows the latest end in
+// its subtree, so queries skip subtrees that end too early. Nodes live in
+// one vector and refer to each other by index, and erased nodes are reused.
+// Handles returned by Insert stay valid until their interval is erased.
+template <typename Key, typename Value>
+class IntervalTree {
+ public:
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+  using Handle = u32;
+
+  explicit IntervalTree(const allocator_type &alloc = {})
+      : nodes_(alloc), free_(alloc) {}
+
+  allocator_type get_allocator() const { return nodes_.get_allocator(); }
+
+  u64 size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  void reserve(const u64 n) { nodes_.reserve(n); }
+  void clear() {
+    nodes_.clear();
+    free_.clear();
+    root_ = kNil;
+    size_ = 0;
+  }
+
+  const Key &start(const Handle handle) const { return nodes_[handle].start; }
+  const Key &end(const Handle handle) const { return nodes_[handle].end; }
+  Value &value(const Handle handle) { return nodes_[handle].value; }
+  const Value &value(const Handle handle) const {
+    return nodes_[handle].value;
+  }
+
+  // Adds [start, end] and returns a handle to it.
+  Handle Insert(const Key &start, const Key &end, Value value) {
+    Handle handle;
+    if (free_.empty()) {
+      handle = static_cast<Handle>(nodes_.size());
+      nodes_.emplace_back();
+    } else {
+      handle = free_.back();
+      free_.pop_back();
+    }
+    Node &node = nodes_[handle];
+    node.start = start;
+    node.end = end;
+    node.max_end = end;
+    node.value = std::move(value);
+    node.left = kNil;
+    node.right = kNil;
+    node.priority = Priority(handle);
+    root_ = Insert(root_, handle);
+    ++size_;
+    return handle;
+  }
+
+  // Removes the interval `handle` refers to.
+  void Erase(const Handle handle) {
+    root_ = Erase(root_, handle);
+    free_.push_back(handle);
+    --size_;
+  }
+
+  // Calls `visit(handle)` for every interval that overlaps [from, to), in
+  // order of start.
+  template <typename Visitor>
+  void ForEachOverlapping(const Key &from, const Key &to,
+                          Visitor &&visit) const {
+    Overlapping<false>(root_, from, to, visit);
+  }
+
+  // Calls `visit(handle)` for every interval that contains `point`, in
+  // order of start.
+  template <typename Visitor>
+  void ForEachContaining(const Key &point, Visitor &&visit) const {
+    Overlapping<true>(root_, point, point, visit);
+  }
+
+  // Calls `visit(handle)` for the first `limit` intervals (in order of
+  // start) that start at or after `from`.
+  template <typename Visitor>
+  void ForEachStartingFrom(const Key &from, const u64 limit,
+                           Visitor &&visit) const {
+    u64 remaining = limit;
+    StartingFrom(root_, from, remaining, visit);
+  }
+
+ private:
+  static constexpr u32 kNil = std::numeric_limits<u32>::max();
+
+  struct Node {
+    Key start{};
+    Key end{};
+    // Latest end in this node's subtree.
+    Key max_end{};
+    Value value{};
+    u32 left = kNil;
+    u32 right = kNil;
+    u32 priority = 0;
+  };
+
+  // Heap priority for a node; a hash of its handle keeps trees deterministic.
+  static u32 Priority(const Handle handle) {
+    u64 x = (handle + 1) * 0x9E3779B97F4A7C15;
+    x ^= x >> 31;
+    x *= 0xBF58476D1CE4E5B9;
+    return static_cast<u32>(x >> 32);
+  }
+
+  // Nodes are ordered by start, then handle, so every node has one place.
+  bool Before(const u32 a, const u32 b) const {
+    const Node &x = nodes_[a];
+    const Node &y = nodes_[b];
+    if (x.start < y.start) return true;
+    if (y.start < x.start) return false;
+    return a < b;
+  }
+
+  void Update(const u32 index) {
+    Node &node = nodes_[index];
+    node.max_end = node.end;
+    if (node.left != kNil) {
+      node.max_end = std::max(node.max_end, nodes_[node.left].max_end);
+    }
+    if (node.right != kNil) {
+      node.max_end = std::max(node.max_end, nodes_[node.right].max_end);
+    }
+  }
+
+  // Splits `tree` into the nodes before `key` and the rest.
+  std::pair<u32, u32> Split(const u32 tree, const u32 key) {
+    if (tree == kNil) return {kNil, kNil};
+    if (Before(tree, key)) {
+      const auto [left, right] = Split(nodes_[tree].right, key);
+      nodes_[tree].right = left;
+      Update(tree);
+      return {tree, right};
+    }
+    const auto [left, right] = Split(nodes_[tree].left, key);
+    nodes_[tree].left = right;
+    Update(tree);
+    return {left, tree};
+  }
+
+  // Joins two trees, where every node of `left` is before every node of
+  // `right`.
+  u32 Merge(const u32 left, const u32 right) {
+    if (left == kNil) return right;
+    if (right == kNil) return left;
+    if (nodes_[left].priority > nodes_[right].priority) {
+      nodes_[left].right = Merge(nodes_[left].right, right);
+      Update(left);
+      return left;
+    }
+    nodes_[right].left = Merge(left, nodes_[right].left);
+    Update(right);
+    return right;
+  }
+
+  u32 Insert(const u32 tree, const u32 node) {
+    if (tree == kNil) return node;
+    if (nodes_[node].priority > nodes_[tree].priority) {
+      const auto [left, right] = Split(tree, node);
+      nodes_[node].left = left;
+      nodes_[node].right = right;
+      Update(node);
+      return node;
+    }
+    if (Before(node, tree)) {
+      nodes_[tree].left = Insert(nodes_[tree].left, node);
+    } else {
+      nodes_[tree].right = Insert(nodes_[tree].right, node);
+    }
+    Update(tree);
+    return tree;
+  }
+
+  u32 Erase(const u32 tree, const u32 node) {
+    if (tree == node) return Merge(nodes_[tree].left, nodes_[tree].right);
+    if (Before(node, tree)) {
+      nodes_[tree].left = Erase(nodes_[tree].left, node);
+    } else {
+      nodes_[tree].right = Erase(nodes_[tree].right, node);
+    }
+    Update(tree);
+    return tree;
+  }
+
+  // Visits the nodes of `tree` that start before `to` (or at it, if
+  // `kClosed`) and end at or after `from`.
+  template <bool kClosed, typename Visitor>
+  void Overlapping(const u32 tree, const Key &from, const Key &to,
+                   Visitor &visit) const {
+    if (tree == kNil) return;
+    const Node &node = nodes_[tree];
+    if (node.max_end < from) return;
+    Overlapping<kClosed>(node.left, from, to, visit);
+    // Everything to the right starts no earlier than this node.
+    if (kClosed ? to < node.start : !(node.start < to)) return;
+    if (!(node.end < from)) visit(static_cast<Handle>(tree));
+    Overlapping<kClosed>(node.right, from, to, visit);
+  }
+
+  template <typename Visitor>
+  void StartingFrom(const u32 tree, const Key &from, u64 &remaining,
+                    Visitor &visit) const {
+    if (tree == kNil || remaining == 0) return;
+    const Node &node = nodes_[tree];
+    if (node.start < from) {
+      StartingFrom(node.right, from, remaining, visit);
+      return;
+    }
+    StartingFrom(node.left, from, remaining, visit);
+    if (remaining == 0) return;
+    visit(static_cast<Handle>(tree));
+    --remaining;
+    StartingFrom(node.right, from, remaining, visit);
+  }
+
+  std::pmr::vector<Node> nodes_;
+  // Erased nodes, ready for reuse.
+  std::pmr::vector<u32> free_;
+  u32 root_ = kNil;
+  u64 size_ = 0;
+};
+
+}  // namespace rose
+
+#endif  // BOARD_BEE_LIBS_INTERVAL_TREE_H_
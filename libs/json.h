@@ -5,6 +5,7 @@
 #include <libs/json/parser.h>
 #include <libs/json/structure.h>
 #include <libs/json/tokenizer.h>
+#include <libs/json/validation_cache.h>
 #include <libs/json/writer.h>
 
 #endif  // BOARD_BEE_LIBS_JSON_H_
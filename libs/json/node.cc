@@ -1,5 +1,6 @@
 #include "node.h"
 
+#include <cstring>
 #include <sstream>
 
 #include "exceptions.h"
@@ -30,6 +31,14 @@ Node::Node(const Object &object) : type_(Type::kObject) {
   value_.object = new Object(object);
 }
 
+Node::Node(Array *array) : type_(Type::kArray) {
+  value_.array = array;
+}
+
+Node::Node(Object *object) : type_(Type::kObject) {
+  value_.object = object;
+}
+
 const char *Node::type_name() const {
   switch (type_) {
     case Type::kNull: return "null";
@@ -45,46 +54,46 @@ const char *Node::type_name() const {
   throw UndefinedTypeError(error_msg.str());
 }
 
-opt<bool> Node::as_bool() const {
+opt<bool> Node::as_bool() const noexcept {
   return is_bool() ? mk_opt<bool>(value_.boolean) : std::nullopt;
 }
 
-opt<s64> Node::as_s64() const {
+opt<s64> Node::as_s64() const noexcept {
   return is_s64() ? mk_opt<s64>(value_.n) : std::nullopt;
 }
 
-opt<f64> Node::as_f64() const {
+opt<f64> Node::as_f64() const noexcept {
   return is_f64() ? mk_opt<f64>(value_.x) : std::nullopt;
 }
 
-opt<const char *> Node::as_string() const {
+opt<const char *> Node::as_string() const noexcept {
   return is_string() ? mk_opt<const char *>(value_.string) : std::nullopt;
 }
 
-opt<Array *> Node::as_array() const {
+opt<Array *> Node::as_array() const noexcept {
   return is_array() ? mk_opt<Array *>(value_.array) : std::nullopt;
 }
 
-opt<Object *> Node::as_object() const {
+opt<Object *> Node::as_object() const noexcept {
   return is_object() ? mk_opt<Object *>(value_.object) : std::nullopt;
 }
 
-void Node::set_value(const bool boolean) {
+void Node::set_value(const bool boolean) noexcept {
   type_ = Type::kBool;
   value_.boolean = boolean;
 }
 
-void Node::set_value(const s64 n) {
+void Node::set_value(const s64 n) noexcept {
   type_ = Type::kS64;
   value_.n = n;
 }
 
-void Node::set_value(const f64 x) {
+void Node::set_value(const f64 x) noexcept {
   type_ = Type::kF64;
   value_.x = x;
 }
 
-void Node::set_value(const char *string) {
+void Node::set_value(const char *string) noexcept {
   type_ = Type::kString;
   value_.string = string;
 }
@@ -99,4 +108,45 @@ void Node::set_value(const Object &object) {
   value_.object = new Object(object);
 }
 
+bool Equal(const Node &a, const Node &b) {
+  if (a.type() != b.type()) return false;
+  switch (a.type()) {
+    case Node::Type::kNull:
+      return true;
+    case Node::Type::kBool:
+      return a.as_bool() == b.as_bool();
+    case Node::Type::kS64:
+      return a.as_s64() == b.as_s64();
+    case Node::Type::kF64:
+      return a.as_f64() == b.as_f64();
+    case Node::Type::kString:
+      return strcmp(*a.as_string(), *b.as_string()) == 0;
+    case Node::Type::kArray: {
+      const Array &x = **a.as_array();
+      const Array &y = **b.as_array();
+      if (x.size() != y.size()) return false;
+      for (u64 i = 0; i < x.size(); ++i) {
+        if (!Equal(*x[i], *y[i])) return false;
+      }
+      return true;
+    }
+    case Node::Type::kObject: {
+      const Object &x = **a.as_object();
+      const Object &y = **b.as_object();
+      if (x.size() != y.size()) return false;
+      for (const auto &[key, value] : x) {
+        bool found = false;
+        for (const auto &[other_key, other_value] : y) {
+          if (strcmp(key, other_key) != 0) continue;
+          found = Equal(*value, *other_value);
+          break;
+        }
+        if (!found) return false;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
 }  // namespace rose::json
@@ -6,6 +6,8 @@
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 
+#include <memory_resource>
+
 #include "../aliases.h"
 
 namespace rose::json {
@@ -25,13 +27,15 @@ using namespace boost::multi_index;
 
 // Represents a JSON object. Can mostly be used as a std::map, but uses
 // boost::multi_index::multi_index_container to keep properties in order.
+// Storage comes from a std::pmr::memory_resource (the default heap unless
+// one is given at construction).
 using Object = multi_index_container<
     Property, indexed_by<
         ordered_unique<identity<Property>>,
         ordered_unique<member<Property, const char *, &Property::name>>
-    >>;
+    >, std::pmr::polymorphic_allocator<Property>>;
 // Represents a JSON array.
-using Array = std::vector<Node *>;
+using Array = pmr::vector<Node *>;
 
 // Reperesents an arbitrary JSON node with a type and a value.
 class Node {
@@ -58,7 +62,12 @@ class Node {
   explicit Node(const Array &array);
   // Makes a copy of `object` on the heap.
   explicit Node(const Object &object);
+  // Refers to `array` without copying it. The caller keeps ownership.
+  explicit Node(Array *array);
+  // Refers to `object` without copying it. The caller keeps ownership.
+  explicit Node(Object *object);
 
+  Type type() const noexcept { return type_; }
   // Returns a human-readable string to represent the type of this node.
   // Can throw if `type_` is invalid, but that generally shouldn't happen.
   const char *type_name() const;
@@ -106,6 +115,10 @@ class Node {
   Values value_;
 };
 
+// Returns true if `a` and `b` are equal JSON values. Objects are equal if
+// they have the same properties, in any order.
+bool Equal(const Node &a, const Node &b);
+
 } // namespace rose::json
 
 #endif  // BOARD_BEE_LIBS_JSON_NODE_H_
@@ -50,7 +50,10 @@ Node *Parser::ParseObject() {
     throw WrongTokenTypeError("Expected '{' at start of object Node");
   }
   Consume();
-  Object object;
+  // The container and its storage both live in the arena, so it never needs
+  // to be destroyed explicitly.
+  auto *object = allocator_->CreateUnmanaged<Object>(
+      Object::allocator_type(allocator_->resource()));
   opt<Token> token = Peek();
   if (!token) throw MissingTokenError("Expected Token after '{'");
   while (token.value().type != Token::Type::kRCurly) {
@@ -71,7 +74,7 @@ Node *Parser::ParseObject() {
     }
     Consume();
     Node *value = ParseValue();
-    object.emplace(token.value().value, value);
+    object->emplace(token.value().value, value);
     token = Peek();
     if (!token) throw MissingTokenError("Expected Token after key-value pair");
     if (token.value().type == Token::Type::kComma) {
@@ -87,9 +90,7 @@ Node *Parser::ParseObject() {
     }
   }
   Consume();
-  auto *object_node = allocator_->Allocate<Node>();
-  object_node->set_value(object);
-  return object_node;
+  return allocator_->Create<Node>(object);
 }
 
 Node *Parser::ParseArray() {
@@ -99,14 +100,14 @@ Node *Parser::ParseArray() {
     throw WrongTokenTypeError("Expected '[' at start of array Node");
   }
   Consume();
-  Array array;
+  auto *array = allocator_->CreateUnmanaged<Array>(allocator_->resource());
   opt<Token> token = Peek();
   if (!token) throw MissingTokenError("Expected Token after '['");
   while (token.value().type != Token::Type::kRSquare) {
     if (!token.value().IsValue()) {
       throw WrongTokenTypeError("Expected ']' or value after '['");
     }
-    array.emplace_back(ParseValue());
+    array->emplace_back(ParseValue());
     token = Peek();
     if (!token) throw MissingTokenError("Expected token after value");
     if (token.value().type == Token::Type::kComma) {
@@ -122,49 +123,39 @@ Node *Parser::ParseArray() {
     }
   }
   Consume();
-  auto *array_node = allocator_->Allocate<Node>();
-  array_node->set_value(array);
-  return array_node;
+  return allocator_->Create<Node>(array);
 }
 
 Node *Parser::ParseString() {
   const opt<Token> token = Peek();
   if (!token || token.value().type != Token::Type::kString) return nullptr;
   Consume();
-  auto *string_node = allocator_->Allocate<Node>();
-  string_node->set_value(token.value().value);
-  return string_node;
+  return allocator_->Create<Node>(token.value().value);
 }
 
 Node *Parser::ParseNumber() {
   const opt<Token> token = Peek();
   if (!token || token.value().type != Token::Type::kNumber) return nullptr;
   Consume();
-  auto *num_node = allocator_->Allocate<Node>();
   if (Contains(token.value().value, '.')) {
-    num_node->set_value(std::stod(token.value().value));
-  } else {
-    num_node->set_value(static_cast<s64>(std::stoi(token.value().value)));
+    return allocator_->Create<Node>(std::stod(token.value().value));
   }
-  return num_node;
+  const s64 n = std::stoll(token.value().value);
+  return allocator_->Create<Node>(n);
 }
 
 Node *Parser::ParseBoolean() {
   const opt<Token> token = Peek();
   if (!token || token.value().type != Token::Type::kBoolean) return nullptr;
   Consume();
-  auto *bool_node = allocator_->Allocate<Node>();
-  bool_node->set_value(*token.value().value == 't');
-  return bool_node;
+  return allocator_->Create<Node>(*token.value().value == 't');
 }
 
 Node *Parser::ParseNull() {
   const opt<Token> token = Peek();
   if (!token || token.value().type != Token::Type::kNull) return nullptr;
   Consume();
-  auto *null_node = allocator_->Allocate<Node>();
-  null_node->set_value();
-  return null_node;
+  return allocator_->Create<Node>();
 }
 
 }  // namespace rose::json
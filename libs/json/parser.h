@@ -12,8 +12,11 @@ namespace rose::json {
 class Parser {
  public:
   // `allocator` is used to allocate Nodes contiguously on the heap.
-  Parser(vector<Token> &&tokens, const sptr<ArenaAllocator> &allocator)
-      : tokens_(tokens), allocator_(allocator) {}
+  // Arrays and Objects (and their elements) are allocated there as well.
+  // It must outlive the parse tree, and must not be used by other threads
+  // while parsing (give each thread its own, e.g. via ConcurrentArena::Local).
+  Parser(vector<Token> &&tokens, ArenaAllocator &allocator)
+      : tokens_(tokens), allocator_(&allocator) {}
   Parser(const Parser &other) = default;
   Parser &operator=(const Parser &other) = default;
   Parser(Parser &&other) = default;
@@ -62,7 +65,7 @@ class Parser {
   // Current index into `tokens_`.
   u64 i_ = 0;
   // Pointer to an ArenaAllocator used for allocating Nodes on the heap.
-  sptr<ArenaAllocator> allocator_;
+  ArenaAllocator *allocator_;
 };
 
 }  // namespace rose::json
@@ -1,5 +1,6 @@
 #include "tokenizer.h"
 
+#include <cstring>
 #include <exception>
 #include <sstream>
 
@@ -76,17 +77,8 @@ bool Tokenizer::ReadKeyword(const str_view keyword) {
   return true;
 }
 
-#define ALLOCATE_NEW_CHUNK_IF_FULL                                \
-if (chars_written >= buffer_capacity) {                           \
-  static_cast<void>(allocator_->Allocate<char>(kCharChunkSize));  \
-  buffer_capacity += kCharChunkSize;                              \
-}
-
 const char *Tokenizer::ReadNumericLiteral() {
-  static constexpr u64 kCharChunkSize = 4;
-  char *string_buffer = allocator_->Allocate<char>(kCharChunkSize);
-  size_t buffer_capacity = kCharChunkSize;
-  u64 chars_written = 0;
+  scratch_.clear();
   opt<char> c = Peek();
   if (c == '0') {
     const opt<char> next = Peek(2);
@@ -99,54 +91,49 @@ const char *Tokenizer::ReadNumericLiteral() {
     if (!next || !std::isdigit(next.value())) {
       throw TokenizationError("Negative numbers must have a digit after '-'");
     }
-    string_buffer[chars_written++] = '-';
-    ALLOCATE_NEW_CHUNK_IF_FULL;
+    scratch_.push_back('-');
     Consume();
     c = Peek();
   }
   while (c) {
     if (std::isdigit(c.value())) {
-      string_buffer[chars_written++] = c.value();
-      ALLOCATE_NEW_CHUNK_IF_FULL;
+      scratch_.push_back(c.value());
     } else if (c == '.') {
       const opt<char> next = Peek(2);
       if (!next || !std::isdigit(next.value())) {
         throw TokenizationError("Decimals must be followed by a digit");
       }
-      string_buffer[chars_written++] = '.';
-      ALLOCATE_NEW_CHUNK_IF_FULL;
+      scratch_.push_back('.');
     } else {
       break;
     }
     Consume();
     c = Peek();
   }
-  string_buffer[chars_written] = '\0';
-  return string_buffer;
+  return CopyScratchToArena();
 }
 
 const char *Tokenizer::ReadStringLiteral() {
-  static constexpr u64 kCharChunkSize = 8;
-  char *string_buffer = allocator_->Allocate<char>(kCharChunkSize);
-  size_t buffer_capacity = kCharChunkSize;
-  u64 chars_written = 0;
+  scratch_.clear();
   while (const opt<char> c = Peek()) {
     Consume();
-    if (c == '"') {
-      string_buffer[chars_written] = '\0';
-      return string_buffer;
-    }
-    string_buffer[chars_written++] = c.value();
-    ALLOCATE_NEW_CHUNK_IF_FULL;
+    if (c == '"') return CopyScratchToArena();
+    scratch_.push_back(c.value());
     if (c == '\\') {
       opt<char> escaped = Peek();
       if (!escaped.has_value()) break;
       Consume();
-      string_buffer[chars_written++] = escaped.value();
-      ALLOCATE_NEW_CHUNK_IF_FULL;
+      scratch_.push_back(escaped.value());
     }
   }
   throw TokenizationError("Hit EOF before end of string literal");
 }
 
+const char *Tokenizer::CopyScratchToArena() {
+  char *string = allocator_->Allocate<char>(scratch_.size() + 1);
+  std::memcpy(string, scratch_.data(), scratch_.size());
+  string[scratch_.size()] = '\0';
+  return string;
+}
+
 } // namespace rose::json
@@ -29,8 +29,10 @@ struct Token {
 class Tokenizer {
  public:
   // `allocator` is used to allocate strings contigously on the heap.
-  Tokenizer(std::istream &input, const sptr<ArenaAllocator> &allocator)
-      : input_(input), allocator_(allocator) {}
+  // It must outlive the Tokens, and must not be used by other threads while
+  // tokenizing (give each thread its own, e.g. via ConcurrentArena::Local).
+  Tokenizer(std::istream &input, ArenaAllocator &allocator)
+      : input_(input), allocator_(&allocator) {}
 
   // Tokenizes `input_` and returns the resulting vector of Tokens.
   vector<Token> Tokenize();
@@ -51,10 +53,15 @@ class Tokenizer {
   // Data is read from the current stream position onwards, and the result will
   // not contain any unescaped '"' characters.
   const char *ReadStringLiteral();
+  // Copies the contents of `scratch_` into the arena as a C-string.
+  const char *CopyScratchToArena();
 
   std::istream &input_;
   // Pointer to an ArenaAllocator used for allocating strings on the heap.
-  sptr<ArenaAllocator> allocator_;
+  ArenaAllocator *allocator_;
+  // Reused buffer that literals are read into before being copied to the
+  // arena in one piece.
+  str scratch_;
 };
 
 }  // namespace rose::json
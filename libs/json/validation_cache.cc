@@ -0,0 +1,195 @@
+#include "validation_cache.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <functional>
+
+#include "../aliases.h"
+#include "node.h"
+
+namespace rose::json {
+
+namespace {
+
+// Type tags, so that e.g. 1 and true don't hash the same.
+enum class Tag : u64 { kNull = 1, kBool, kS64, kF64, kString, kArray, kObject };
+
+// Finalizer from SplitMix64; spreads every input bit over the output.
+u64 Mix(u64 x) {
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EB;
+  return x ^ (x >> 31);
+}
+
+// Finalizer from MurmurHash3, for the second hash.
+u64 Mix2(u64 x) {
+  x ^= x >> 33;
+  x *= 0xFF51AFD7ED558CCD;
+  x ^= x >> 33;
+  x *= 0xC4CEB9FE1A85EC53;
+  return x ^ (x >> 33);
+}
+
+u64 Combine2(const u64 seed, const u64 value) {
+  return Mix2(seed * 0x100000001B3 + Mix2(value ^ 0x2545F4914F6CDD1D));
+}
+
+u64 HashString(const char *string) {
+  return std::hash<str_view>{}(string);
+}
+
+// FNV-1a, for the second hash.
+u64 HashString2(const char *string) {
+  u64 hash = 0xCBF29CE484222325;
+  for (; *string != '\0'; ++string) {
+    hash = (hash ^ static_cast<u8>(*string)) * 0x100000001B3;
+  }
+  return hash;
+}
+
+}  // namespace
+
+u64 ValidationCache::Combine(const u64 seed, const u64 value) {
+  return Mix(seed ^ (value + 0x9E3779B97F4A7C15 + (seed << 6) + (seed >> 2)));
+}
+
+u64 ValidationCache::Hash(const Node &node) { return DigestOf(node).hash; }
+
+ValidationCache::Digest ValidationCache::DigestOf(const Node &node) {
+  // Each scalar is hashed as its tag combined with its bits.
+  const auto scalar = [](const Tag tag, const u64 bits) {
+    return Digest{Combine(static_cast<u64>(tag), bits),
+                  Combine2(static_cast<u64>(tag), bits)};
+  };
+  switch (node.type()) {
+    case Node::Type::kNull:
+      return {Mix(static_cast<u64>(Tag::kNull)),
+              Mix2(static_cast<u64>(Tag::kNull))};
+    case Node::Type::kBool:
+      return scalar(Tag::kBool, *node.as_bool());
+    case Node::Type::kS64:
+      return scalar(Tag::kS64, std::bit_cast<u64>(*node.as_s64()));
+    case Node::Type::kF64:
+      return scalar(Tag::kF64, std::bit_cast<u64>(*node.as_f64()));
+    case Node::Type::kString:
+      return {Combine(static_cast<u64>(Tag::kString),
+                      HashString(*node.as_string())),
+              Combine2(static_cast<u64>(Tag::kString),
+                       HashString2(*node.as_string()))};
+    case Node::Type::kArray:
+    case Node::Type::kObject:
+      break;
+  }
+  if (const auto it = digests_.find(&node); it != digests_.end()) {
+    return it->second;
+  }
+  Digest digest;
+  if (node.is_array()) {
+    const Array &array = **node.as_array();
+    digest = scalar(Tag::kArray, array.size());
+    for (const Node *element : array) {
+      const Digest element_digest = DigestOf(*element);
+      digest.hash = Combine(digest.hash, element_digest.hash);
+      digest.verify = Combine2(digest.verify, element_digest.verify);
+    }
+  } else {
+    // Properties aren't ordered, so their hashes are summed.
+    const Object &object = **node.as_object();
+    Digest sum = {0, 0};
+    for (const auto &[key, value] : object) {
+      const Digest value_digest = DigestOf(*value);
+      sum.hash += Combine(HashString(key), value_digest.hash);
+      sum.verify += Combine2(HashString2(key), value_digest.verify);
+    }
+    digest = scalar(Tag::kObject, object.size());
+    digest.hash = Combine(digest.hash, sum.hash);
+    digest.verify = Combine2(digest.verify, sum.verify);
+  }
+  digests_.emplace(&node, digest);
+  return digest;
+}
+
+void ValidationCache::MarkDirty(const Node &root,
+                                const vector<PathStep> &path) {
+  const Node *node = &root;
+  for (const PathStep &step : path) {
+    digests_.erase(node);
+    if (const u64 *index = std::get_if<u64>(&step)) {
+      if (!node->is_array()) return;
+      const Array &array = **node->as_array();
+      if (const auto it = arrays_.find(&array); it != arrays_.end()) {
+        for (ArrayState &state : it->second) {
+          if (std::ranges::find(state.dirty, *index) == state.dirty.end()) {
+            state.dirty.push_back(*index);
+          }
+        }
+      }
+      if (*index >= array.size()) return;
+      node = array[*index];
+    } else {
+      if (!node->is_object()) return;
+      const char *key = std::get<const char *>(step);
+      const Node *next = nullptr;
+      for (const auto &[name, value] : **node->as_object()) {
+        if (strcmp(name, key) == 0) {
+          next = value;
+          break;
+        }
+      }
+      // A new property: everything above it has already been marked.
+      if (!next) return;
+      node = next;
+    }
+  }
+  digests_.erase(node);
+  if (node->is_array()) arrays_.erase(*node->as_array());
+}
+
+bool ValidationCache::Passed(const Node &node, const u64 check,
+                             const u64 context) {
+  const Digest key = PassKey(DigestOf(node), check, context);
+  const auto it = passes_.find(key.hash);
+  return it != passes_.end() && it->second == key.verify;
+}
+
+void ValidationCache::RecordPass(const Node &node, const u64 check,
+                                 const u64 context) {
+  const Digest key = PassKey(DigestOf(node), check, context);
+  passes_.insert_or_assign(key.hash, key.verify);
+}
+
+void ValidationCache::Clear() {
+  digests_.clear();
+  passes_.clear();
+  arrays_.clear();
+}
+
+ValidationCache::ArrayState *ValidationCache::FindState(const Array &array,
+                                                         const u64 check) {
+  const auto it = arrays_.find(&array);
+  if (it == arrays_.end()) return nullptr;
+  for (ArrayState &state : it->second) {
+    if (state.check == check) return &state;
+  }
+  return nullptr;
+}
+
+void ValidationCache::MarkClean(const Array &array, const u64 check) {
+  if (ArrayState *state = FindState(array, check)) {
+    state->dirty.clear();
+    return;
+  }
+  arrays_[&array].push_back({check, {}});
+}
+
+ValidationCache::Digest ValidationCache::PassKey(const Digest &content,
+                                                 const u64 check,
+                                                 const u64 context) {
+  return {Combine(Combine(content.hash, check), context),
+          Combine2(Combine2(content.verify, check), context)};
+}
+
+}  // namespace rose::json
@@ -0,0 +1,123 @@
+#ifndef BOARD_BEE_LIBS_JSON_VALIDATION_CACHE_H_
+#define BOARD_BEE_LIBS_JSON_VALIDATION_CACHE_H_
+
+#include <variant>
+
+#include "../aliases.h"
+#include "node.h"
+
+namespace rose::json {
+
+// Remembers which parts of a document passed validation, so that after an
+// edit only the path down to the change has to be checked again.
+//
+// Passes are recorded against a Node's content hash together with an id for
+// the check that was run (which should change whenever the schema behind it
+// does) and the context it ran in, so any Node with the same content as one
+// that already passed is accepted without running the check again, even if
+// it's a different Node (an undone edit, say). On top of that, an array that
+// passed as a whole remembers which of its elements have changed since, so
+// checking it again only looks at those.
+//
+// Content is hashed twice, with independent functions: the first hash finds
+// a recorded pass and the second must agree with it before the pass counts.
+// A Node is only wrongly accepted if both 64-bit hashes collide at once.
+// (Check ids and contexts are taken as given; one built from Hash has the
+// usual 1 in 2^64 odds of a collision.)
+//
+// The first check of a document costs far more than checking it without a
+// cache, since every Node is hashed and every pass recorded as well: on a
+// Board of 20k Tasks and 20k Events, about 80 ms against 13 ms. Checking it
+// again after an edit takes microseconds, so that's where it pays off.
+//
+// The cache identifies Nodes by address, so Clear it before the document it
+// describes is freed.
+class ValidationCache {
+ public:
+  // One step down from a Node: an index into an array or a key into an
+  // object.
+  using PathStep = std::variant<u64, const char *>;
+
+  // Returns a hash of everything in `node`. Hashes of arrays and objects are
+  // remembered until MarkDirty says they've changed.
+  u64 Hash(const Node &node);
+
+  // Notes that the Node reached from `root` by following `path` changed,
+  // either in place or by being replaced in its parent. Every Node on the way
+  // down is treated as changed through it. Nodes inside the changed one are
+  // assumed to be unchanged unless they're new or get a MarkDirty of their
+  // own. Mark an array itself when elements are added or removed.
+  void MarkDirty(const Node &root, const vector<PathStep> &path);
+
+  // Returns true if a Node with the same content as `node` passed `check`
+  // in `context` (a hash of anything else the check depends on).
+  bool Passed(const Node &node, u64 check, u64 context = 0);
+  // Records that `node` passed `check` in `context`.
+  void RecordPass(const Node &node, u64 check, u64 context = 0);
+
+  // Returns true if every element of `array` passes `check`, for which
+  // `passes(element)` runs the check itself. Elements known to pass are
+  // skipped, and if `array` already passed `check` as a whole, only the
+  // elements changed since are looked at.
+  template <typename Passes>
+  bool CheckElements(const Array &array, u64 check, const Passes &passes);
+
+  // Forgets everything.
+  void Clear();
+
+  // Combines two hashes into one.
+  static u64 Combine(u64 seed, u64 value);
+
+ private:
+  // Two independent hashes of a Node's content.
+  struct Digest {
+    u64 hash;
+    u64 verify;
+  };
+
+  // Which elements of an array have changed since it passed one check.
+  struct ArrayState {
+    u64 check;
+    vector<u64> dirty;
+  };
+
+  // Returns the state of `array` for `check`, or nullptr if it hasn't
+  // passed `check` as a whole.
+  ArrayState *FindState(const Array &array, u64 check);
+  void MarkClean(const Array &array, u64 check);
+  // Returns both hashes of `node`; Hash returns the first.
+  Digest DigestOf(const Node &node);
+  // Returns the key and the verifier a pass of `content` is recorded under.
+  static Digest PassKey(const Digest &content, u64 check, u64 context);
+
+  HashMap<const Node *, Digest> digests_;
+  // From each pass's key to its verifier.
+  HashMap<u64, u64> passes_;
+  HashMap<const Array *, vector<ArrayState>> arrays_;
+};
+
+template <typename Passes>
+bool ValidationCache::CheckElements(const Array &array, const u64 check,
+                                    const Passes &passes) {
+  const auto check_element = [&](const Node &element) {
+    if (Passed(element, check)) return true;
+    if (!passes(element)) return false;
+    RecordPass(element, check);
+    return true;
+  };
+  if (const ArrayState *state = FindState(array, check)) {
+    for (const u64 index : state->dirty) {
+      if (index < array.size() && !check_element(*array[index])) return false;
+    }
+  } else {
+    for (const Node *element : array) {
+      if (!check_element(*element)) return false;
+    }
+  }
+  MarkClean(array, check);
+  return true;
+}
+
+}  // namespace rose::json
+
+#endif  // BOARD_BEE_LIBS_JSON_VALIDATION_CACHE_H_
@@ -0,0 +1,381 @@
+#include "roaring_bitmap.h"
+
+#include <algorithm>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+
+#include "aliases.h"
+
+namespace rose {
+
+namespace {
+
+// Returns the number of bits set in `words`.
+// Counted in parallel within each word rather than with std::popcount,
+// which is a library call per word unless POPCNT is enabled.
+u32 CountBits(const pmr::vector<u64> &words) {
+  u64 count = 0;
+  for (u64 word : words) {
+    word -= (word >> 1) & 0x5555555555555555;
+    word = (word & 0x3333333333333333) + ((word >> 2) & 0x3333333333333333);
+    word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0f;
+    count += (word * 0x0101010101010101) >> 56;
+  }
+  return count;
+}
+
+template <typename T>
+void WriteRaw(std::ostream &out, const T *data, const u64 count) {
+  out.write(reinterpret_cast<const char *>(data), count * sizeof(T));
+}
+
+template <typename T>
+void ReadRaw(std::istream &in, T *data, const u64 count) {
+  if (!in.read(reinterpret_cast<char *>(data), count * sizeof(T))) {
+    throw std::runtime_error("Truncated RoaringBitmap");
+  }
+}
+
+}  // namespace
+
+bool RoaringBitmap::Chunk::Contains(const u16 low) const {
+  if (is_bitmap()) return bits[low / 64] >> (low % 64) & 1;
+  return std::binary_search(values.begin(), values.end(), low);
+}
+
+void RoaringBitmap::Chunk::Normalize() {
+  if (is_bitmap() && size <= kMaxArraySize) {
+    ToArray();
+  } else if (!is_bitmap() && size > kMaxArraySize) {
+    ToBitmap();
+  }
+}
+
+void RoaringBitmap::Chunk::ToBitmap() {
+  bits.assign(kBitmapWords, 0);
+  for (const u16 low : values) bits[low / 64] |= u64{1} << (low % 64);
+  values.clear();
+  values.shrink_to_fit();
+}
+
+void RoaringBitmap::Chunk::ToArray() {
+  values.clear();
+  values.reserve(size);
+  for (u32 i = 0; i < kBitmapWords; ++i) {
+    for (u64 word = bits[i]; word != 0; word &= word - 1) {
+      values.push_back(i * 64 + std::countr_zero(word));
+    }
+  }
+  bits.clear();
+  bits.shrink_to_fit();
+}
+
+bool RoaringBitmap::Contains(const u32 value) const {
+  const u64 i = LowerBound(value >> 16);
+  return i < chunks_.size() && chunks_[i].key == value >> 16
+      && chunks_[i].Contains(value & 0xffff);
+}
+
+bool RoaringBitmap::Add(const u32 value) {
+  Chunk &chunk = ChunkFor(value >> 16);
+  const u16 low = value & 0xffff;
+  if (chunk.is_bitmap()) {
+    u64 &word = chunk.bits[low / 64];
+    const u64 bit = u64{1} << (low % 64);
+    if (word & bit) return false;
+    word |= bit;
+  } else {
+    const auto it =
+        std::lower_bound(chunk.values.begin(), chunk.values.end(), low);
+    if (it != chunk.values.end() && *it == low) return false;
+    chunk.values.insert(it, low);
+  }
+  ++chunk.size;
+  ++size_;
+  chunk.Normalize();
+  return true;
+}
+
+bool RoaringBitmap::Remove(const u32 value) {
+  const u64 i = LowerBound(value >> 16);
+  if (i == chunks_.size() || chunks_[i].key != value >> 16) return false;
+  Chunk &chunk = chunks_[i];
+  const u16 low = value & 0xffff;
+  if (chunk.is_bitmap()) {
+    u64 &word = chunk.bits[low / 64];
+    const u64 bit = u64{1} << (low % 64);
+    if (!(word & bit)) return false;
+    word &= ~bit;
+  } else {
+    const auto it =
+        std::lower_bound(chunk.values.begin(), chunk.values.end(), low);
+    if (it == chunk.values.end() || *it != low) return false;
+    chunk.values.erase(it);
+  }
+  --size_;
+  if (--chunk.size == 0) {
+    chunks_.erase(chunks_.begin() + i);
+  } else {
+    chunk.Normalize();
+  }
+  return true;
+}
+
+void RoaringBitmap::AddRange(const u32 from, const u32 to) {
+  if (from >= to) return;
+  for (u32 key = from >> 16; key <= (to - 1) >> 16; ++key) {
+    const u32 begin = key == from >> 16 ? from & 0xffff : 0;
+    const u32 end = key == (to - 1) >> 16 ? ((to - 1) & 0xffff) + 1 : 1 << 16;
+    Chunk &chunk = ChunkFor(key);
+    if (!chunk.is_bitmap()) chunk.ToBitmap();
+    for (u32 low = begin; low < end;) {
+      if (low % 64 == 0 && low + 64 <= end) {
+        chunk.bits[low / 64] = ~u64{0};
+        low += 64;
+      } else {
+        chunk.bits[low / 64] |= u64{1} << (low % 64);
+        ++low;
+      }
+    }
+    size_ -= chunk.size;
+    chunk.size = CountBits(chunk.bits);
+    size_ += chunk.size;
+    chunk.Normalize();
+  }
+}
+
+RoaringBitmap &RoaringBitmap::operator&=(const RoaringBitmap &other) {
+  // Chunks are intersected in place and the survivors packed to the front.
+  u64 kept = 0;
+  u64 j = 0;
+  for (u64 i = 0; i < chunks_.size(); ++i) {
+    while (j < other.chunks_.size() && other.chunks_[j].key < chunks_[i].key) {
+      ++j;
+    }
+    if (j == other.chunks_.size()) break;
+    if (other.chunks_[j].key != chunks_[i].key) continue;
+    And(chunks_[i], other.chunks_[j]);
+    if (chunks_[i].size == 0) continue;
+    if (kept != i) chunks_[kept] = std::move(chunks_[i]);
+    ++kept;
+  }
+  chunks_.erase(chunks_.begin() + kept, chunks_.end());
+  Recount();
+  return *this;
+}
+
+RoaringBitmap &RoaringBitmap::operator|=(const RoaringBitmap &other) {
+  pmr::vector<Chunk> out(get_allocator());
+  out.reserve(chunks_.size() + other.chunks_.size());
+  u64 i = 0;
+  u64 j = 0;
+  while (i < chunks_.size() || j < other.chunks_.size()) {
+    if (j == other.chunks_.size()
+        || (i < chunks_.size() && chunks_[i].key < other.chunks_[j].key)) {
+      out.push_back(std::move(chunks_[i++]));
+    } else if (i == chunks_.size() || chunks_[i].key > other.chunks_[j].key) {
+      out.push_back(other.chunks_[j++]);
+    } else {
+      Or(chunks_[i], other.chunks_[j++]);
+      out.push_back(std::move(chunks_[i++]));
+    }
+  }
+  chunks_ = std::move(out);
+  Recount();
+  return *this;
+}
+
+RoaringBitmap &RoaringBitmap::operator-=(const RoaringBitmap &other) {
+  u64 kept = 0;
+  u64 j = 0;
+  for (u64 i = 0; i < chunks_.size(); ++i) {
+    while (j < other.chunks_.size() && other.chunks_[j].key < chunks_[i].key) {
+      ++j;
+    }
+    if (j < other.chunks_.size() && other.chunks_[j].key == chunks_[i].key) {
+      AndNot(chunks_[i], other.chunks_[j]);
+      if (chunks_[i].size == 0) continue;
+    }
+    if (kept != i) chunks_[kept] = std::move(chunks_[i]);
+    ++kept;
+  }
+  chunks_.erase(chunks_.begin() + kept, chunks_.end());
+  Recount();
+  return *this;
+}
+
+bool RoaringBitmap::operator==(const RoaringBitmap &other) const {
+  // Both forms are canonical for a chunk's size, so equal sets have equal
+  // chunks.
+  if (size_ != other.size_ || chunks_.size() != other.chunks_.size()) {
+    return false;
+  }
+  for (u64 i = 0; i < chunks_.size(); ++i) {
+    const Chunk &a = chunks_[i];
+    const Chunk &b = other.chunks_[i];
+    if (a.key != b.key || a.size != b.size || a.values != b.values
+        || a.bits != b.bits) {
+      return false;
+    }
+  }
+  return true;
+}
+
+vector<u32> RoaringBitmap::ToVector() const {
+  vector<u32> values;
+  values.reserve(size_);
+  ForEach([&](const u32 value) { values.push_back(value); });
+  return values;
+}
+
+opt<u32> RoaringBitmap::Max() const {
+  if (chunks_.empty()) return std::nullopt;
+  const Chunk &chunk = chunks_.back();
+  const u32 high = u32{chunk.key} << 16;
+  if (!chunk.is_bitmap()) return high | chunk.values.back();
+  for (u32 i = kBitmapWords; i-- > 0;) {
+    if (chunk.bits[i] != 0) {
+      return high | (i * 64 + 63 - std::countl_zero(chunk.bits[i]));
+    }
+  }
+  return std::nullopt;
+}
+
+void RoaringBitmap::Save(std::ostream &out) const {
+  const u32 count = chunks_.size();
+  WriteRaw(out, &count, 1);
+  for (const Chunk &chunk : chunks_) {
+    WriteRaw(out, &chunk.key, 1);
+    WriteRaw(out, &chunk.size, 1);
+    // The form follows from the size, so only the contents are written.
+    if (chunk.is_bitmap()) {
+      WriteRaw(out, chunk.bits.data(), kBitmapWords);
+    } else {
+      WriteRaw(out, chunk.values.data(), chunk.size);
+    }
+  }
+}
+
+RoaringBitmap RoaringBitmap::Load(std::istream &in,
+                                  const allocator_type &alloc) {
+  RoaringBitmap bitmap(alloc);
+  u32 count;
+  ReadRaw(in, &count, 1);
+  // Keys are distinct u16s, so there can't be more chunks than that.
+  if (count > 1 << 16) throw std::runtime_error("Malformed RoaringBitmap");
+  bitmap.chunks_.reserve(count);
+  for (u32 i = 0; i < count; ++i) {
+    u16 key;
+    u32 size;
+    ReadRaw(in, &key, 1);
+    ReadRaw(in, &size, 1);
+    if (size == 0 || size > 1 << 16
+        || (i > 0 && key <= bitmap.chunks_.back().key)) {
+      throw std::runtime_error("Malformed RoaringBitmap");
+    }
+    Chunk &chunk = bitmap.chunks_.emplace_back(key);
+    chunk.size = size;
+    if (size > kMaxArraySize) {
+      chunk.bits.resize(kBitmapWords);
+      ReadRaw(in, chunk.bits.data(), kBitmapWords);
+      if (CountBits(chunk.bits) != size) {
+        throw std::runtime_error("Malformed RoaringBitmap");
+      }
+    } else {
+      chunk.values.resize(size);
+      ReadRaw(in, chunk.values.data(), size);
+      if (std::adjacent_find(chunk.values.begin(), chunk.values.end(),
+                             std::greater_equal<>())
+          != chunk.values.end()) {
+        throw std::runtime_error("Malformed RoaringBitmap");
+      }
+    }
+    bitmap.size_ += size;
+  }
+  return bitmap;
+}
+
+u64 RoaringBitmap::LowerBound(const u16 key) const {
+  return std::lower_bound(chunks_.begin(), chunks_.end(), key,
+                          [](const Chunk &chunk, const u16 key) {
+                            return chunk.key < key;
+                          })
+       - chunks_.begin();
+}
+
+RoaringBitmap::Chunk &RoaringBitmap::ChunkFor(const u16 key) {
+  const u64 i = LowerBound(key);
+  if (i == chunks_.size() || chunks_[i].key != key) {
+    chunks_.emplace(chunks_.begin() + i, key);
+  }
+  return chunks_[i];
+}
+
+void RoaringBitmap::Recount() {
+  size_ = 0;
+  for (const Chunk &chunk : chunks_) size_ += chunk.size;
+}
+
+// The word loops below are over whole bitmaps, so they vectorize.
+
+void RoaringBitmap::And(Chunk &a, const Chunk &b) {
+  if (a.is_bitmap() && b.is_bitmap()) {
+    for (u32 i = 0; i < kBitmapWords; ++i) a.bits[i] &= b.bits[i];
+    a.size = CountBits(a.bits);
+  } else if (a.is_bitmap()) {
+    // The result is no bigger than `b`, so it's an array.
+    pmr::vector<u16> values(a.values.get_allocator());
+    for (const u16 low : b.values) {
+      if (a.Contains(low)) values.push_back(low);
+    }
+    a.values = std::move(values);
+    a.bits.clear();
+    a.bits.shrink_to_fit();
+    a.size = a.values.size();
+  } else {
+    std::erase_if(a.values, [&](const u16 low) { return !b.Contains(low); });
+    a.size = a.values.size();
+  }
+  a.Normalize();
+}
+
+void RoaringBitmap::Or(Chunk &a, const Chunk &b) {
+  if (!a.is_bitmap() && !b.is_bitmap()) {
+    pmr::vector<u16> values(a.values.get_allocator());
+    values.reserve(a.values.size() + b.values.size());
+    std::set_union(a.values.begin(), a.values.end(), b.values.begin(),
+                   b.values.end(), std::back_inserter(values));
+    a.values = std::move(values);
+    a.size = a.values.size();
+  } else {
+    if (!a.is_bitmap()) a.ToBitmap();
+    if (b.is_bitmap()) {
+      for (u32 i = 0; i < kBitmapWords; ++i) a.bits[i] |= b.bits[i];
+    } else {
+      for (const u16 low : b.values) a.bits[low / 64] |= u64{1} << (low % 64);
+    }
+    a.size = CountBits(a.bits);
+  }
+  a.Normalize();
+}
+
+void RoaringBitmap::AndNot(Chunk &a, const Chunk &b) {
+  if (a.is_bitmap() && b.is_bitmap()) {
+    for (u32 i = 0; i < kBitmapWords; ++i) a.bits[i] &= ~b.bits[i];
+    a.size = CountBits(a.bits);
+  } else if (a.is_bitmap()) {
+    for (const u16 low : b.values) {
+      a.bits[low / 64] &= ~(u64{1} << (low % 64));
+    }
+    a.size = CountBits(a.bits);
+  } else {
+    std::erase_if(a.values, [&](const u16 low) { return b.Contains(low); });
+    a.size = a.values.size();
+  }
+  a.Normalize();
+}
+
+}  // namespace rose
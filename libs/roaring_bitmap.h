@@ -0,0 +1,156 @@
+#ifndef BOARD_BEE_LIBS_ROARING_BITMAP_H_
+#define BOARD_BEE_LIBS_ROARING_BITMAP_H_
+
+#include "aliases.h"
+
+#include <bit>
+#include <iosfwd>
+#include <memory_resource>
+
+namespace rose {
+
+// A compressed set of u32s, after Roaring bitmaps (Chambi et al.): values
+// are split by their top 16 bits into chunks, and each chunk is stored as a
+// sorted array of its low 16 bits while it has at most kMaxArraySize of
+// them, or as a 2^16-bit bitmap once it's denser. Sparse and dense sets
+// both stay small, and set operations work a chunk at a time with merges
+// or word-wide ANDs and ORs.
+class RoaringBitmap {
+ public:
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  // Chunks with more values than this are stored as bitmaps, which are then
+  // smaller than the array would be.
+  static constexpr u32 kMaxArraySize = 4096;
+
+  explicit RoaringBitmap(const allocator_type &alloc = {})
+      : chunks_(alloc) {}
+  RoaringBitmap(const RoaringBitmap &other, const allocator_type &alloc)
+      : chunks_(other.chunks_, alloc), size_(other.size_) {}
+  RoaringBitmap(RoaringBitmap &&other, const allocator_type &alloc)
+      : chunks_(std::move(other.chunks_), alloc), size_(other.size_) {}
+  RoaringBitmap(const RoaringBitmap &other) = default;
+  RoaringBitmap &operator=(const RoaringBitmap &other) = default;
+  RoaringBitmap(RoaringBitmap &&other) = default;
+  RoaringBitmap &operator=(RoaringBitmap &&other) = default;
+
+  allocator_type get_allocator() const { return chunks_.get_allocator(); }
+
+  u64 Cardinality() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  bool Contains(u32 value) const;
+  // Each returns true if the set changed.
+  bool Add(u32 value);
+  bool Remove(u32 value);
+  // Adds every value in [from, to).
+  void AddRange(u32 from, u32 to);
+  void clear() {
+    chunks_.clear();
+    size_ = 0;
+  }
+
+  // Intersection, union and difference.
+  RoaringBitmap &operator&=(const RoaringBitmap &other);
+  RoaringBitmap &operator|=(const RoaringBitmap &other);
+  RoaringBitmap &operator-=(const RoaringBitmap &other);
+  friend RoaringBitmap operator&(RoaringBitmap a, const RoaringBitmap &b) {
+    return a &= b;
+  }
+  friend RoaringBitmap operator|(RoaringBitmap a, const RoaringBitmap &b) {
+    return a |= b;
+  }
+  friend RoaringBitmap operator-(RoaringBitmap a, const RoaringBitmap &b) {
+    return a -= b;
+  }
+  bool operator==(const RoaringBitmap &other) const;
+
+  // Calls `visit(value)` for every value, in increasing order.
+  template <typename Visitor>
+  void ForEach(Visitor &&visit) const {
+    for (const Chunk &chunk : chunks_) {
+      const u32 high = u32{chunk.key} << 16;
+      if (chunk.is_bitmap()) {
+        for (u32 i = 0; i < kBitmapWords; ++i) {
+          for (u64 word = chunk.bits[i]; word != 0; word &= word - 1) {
+            visit(high | (i * 64 + std::countr_zero(word)));
+          }
+        }
+      } else {
+        for (const u16 low : chunk.values) visit(high | low);
+      }
+    }
+  }
+  // Returns every value, in increasing order.
+  vector<u32> ToVector() const;
+  // Returns the largest value, or nullopt if there are none.
+  opt<u32> Max() const;
+
+  // Writes the chunks to `out` as they are, in native byte order, so Load
+  // doesn't have to rebuild them.
+  void Save(std::ostream &out) const;
+  // Reads a RoaringBitmap written by Save. Throws a std::runtime_error if
+  // `in` doesn't hold one.
+  static RoaringBitmap Load(std::istream &in, const allocator_type &alloc = {});
+
+ private:
+  static constexpr u32 kBitmapWords = (1 << 16) / 64;
+
+  // The values sharing top 16 bits `key`, as their low 16 bits: in `values`,
+  // sorted, or as bits of `bits` (exactly kBitmapWords words) if it isn't
+  // empty.
+  struct Chunk {
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit Chunk(const u16 key, const allocator_type &alloc = {})
+        : key(key), values(alloc), bits(alloc) {}
+    Chunk(const Chunk &other, const allocator_type &alloc)
+        : key(other.key),
+          size(other.size),
+          values(other.values, alloc),
+          bits(other.bits, alloc) {}
+    Chunk(Chunk &&other, const allocator_type &alloc)
+        : key(other.key),
+          size(other.size),
+          values(std::move(other.values), alloc),
+          bits(std::move(other.bits), alloc) {}
+    Chunk(const Chunk &other) = default;
+    Chunk &operator=(const Chunk &other) = default;
+    Chunk(Chunk &&other) = default;
+    Chunk &operator=(Chunk &&other) = default;
+
+    bool is_bitmap() const { return !bits.empty(); }
+    bool Contains(u16 low) const;
+    // Switches to whichever form suits `size`.
+    void Normalize();
+    void ToBitmap();
+    void ToArray();
+
+    u16 key;
+    u32 size = 0;
+    pmr::vector<u16> values;
+    pmr::vector<u64> bits;
+  };
+
+  // Returns the index in `chunks_` of the first chunk whose key is at least
+  // `key`.
+  u64 LowerBound(u16 key) const;
+  // Returns the chunk for `key`, adding an empty one if there's none.
+  Chunk &ChunkFor(u16 key);
+
+  // Sets `size_` from the chunks' sizes.
+  void Recount();
+
+  // Each sets `a` to `a` op `b`, for chunks with the same key.
+  static void And(Chunk &a, const Chunk &b);
+  static void Or(Chunk &a, const Chunk &b);
+  static void AndNot(Chunk &a, const Chunk &b);
+
+  // Sorted by key, none of them empty.
+  pmr::vector<Chunk> chunks_;
+  u64 size_ = 0;
+};
+
+}  // namespace rose
+
+#endif  // BOARD_BEE_LIBS_ROARING_BITMAP_H_
@@ -2,5 +2,8 @@
 #define BOARD_BEE_LIBS_ROSE_TIME_H_
 
 #include <libs/time/date_time.h>
+#include <libs/time/duration.h>
+#include <libs/time/recurrence_rule.h>
+#include <libs/time/time_zone.h>
 
 #endif  // BOARD_BEE_LIBS_ROSE_TIME_H_
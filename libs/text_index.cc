@@ -0,0 +1,456 @@
+#include "text_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+#include "aliases.h"
+#include "roaring_bitmap.h"
+
+namespace rose {
+
+namespace {
+
+// BM25's usual parameters: how quickly repeats of a token stop counting,
+// and how much a document's length discounts them.
+constexpr f64 kK1 = 1.2;
+constexpr f64 kB = 0.75;
+
+// Written first by Save, then the format version.
+constexpr char kMagic[4] = {'B', 'T', 'X', 'I'};
+constexpr u32 kFormatVersion = 1;
+
+char Fold(const char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+// Appends `text` to `out`, folded.
+void FoldInto(const str_view text, pmr::str &out) {
+  const u64 start = out.size();
+  out.resize(start + text.size());
+  for (u64 i = 0; i < text.size(); ++i) out[start + i] = Fold(text[i]);
+}
+
+bool IsTokenByte(const char c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z')
+      || static_cast<u8>(c) >= 0x80;
+}
+
+// Calls `visit(token)` for every token of the folded text `text`.
+template <typename Visitor>
+void ForEachToken(const str_view text, Visitor &&visit) {
+  u64 i = 0;
+  while (i < text.size()) {
+    while (i < text.size() && !IsTokenByte(text[i])) ++i;
+    const u64 start = i;
+    while (i < text.size() && IsTokenByte(text[i])) ++i;
+    if (i > start) visit(text.substr(start, i - start));
+  }
+}
+
+// Appends the key of every trigram of `text` to `keys`.
+void AddTrigrams(const str_view text, vector<u32> &keys) {
+  for (u64 i = 0; i + 3 <= text.size(); ++i) {
+    keys.push_back(u32{static_cast<u8>(text[i])} << 16
+                   | u32{static_cast<u8>(text[i + 1])} << 8
+                   | static_cast<u8>(text[i + 2]));
+  }
+}
+
+// Returns the distinct trigram keys of a Doc's title and body. Trigrams
+// don't span the two.
+vector<u32> Trigrams(const str_view title, const str_view body) {
+  vector<u32> keys;
+  AddTrigrams(title, keys);
+  AddTrigrams(body, keys);
+  std::ranges::sort(keys);
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  return keys;
+}
+
+// Keeps the best `limit` of `hits`, best first: highest score, then lowest
+// id.
+vector<TextIndex::Hit> Best(vector<TextIndex::Hit> hits, const u64 limit) {
+  const u64 kept = std::min<u64>(limit, hits.size());
+  std::partial_sort(hits.begin(), hits.begin() + kept, hits.end(),
+                    [](const TextIndex::Hit &a, const TextIndex::Hit &b) {
+                      return a.score != b.score ? a.score > b.score
+                                                : a.doc < b.doc;
+                    });
+  hits.resize(kept);
+  return hits;
+}
+
+template <typename T>
+void WriteRaw(std::ostream &out, const T *data, const u64 count) {
+  out.write(reinterpret_cast<const char *>(data), count * sizeof(T));
+}
+
+template <typename T>
+void ReadRaw(std::istream &in, T *data, const u64 count) {
+  if (!in.read(reinterpret_cast<char *>(data), count * sizeof(T))) {
+    throw std::runtime_error("Truncated TextIndex");
+  }
+}
+
+void WriteString(std::ostream &out, const str_view string) {
+  const u32 size = string.size();
+  WriteRaw(out, &size, 1);
+  WriteRaw(out, string.data(), size);
+}
+
+[[noreturn]] void Malformed() {
+  throw std::runtime_error("Malformed TextIndex");
+}
+
+void ReadString(std::istream &in, pmr::str &string) {
+  u32 size;
+  ReadRaw(in, &size, 1);
+  // A piece at a time, so a bad size runs out of input rather than
+  // allocating gigabytes first.
+  constexpr u64 kPiece = 1 << 16;
+  string.clear();
+  while (string.size() < size) {
+    const u64 offset = string.size();
+    const u64 piece = std::min<u64>(size - offset, kPiece);
+    string.resize(offset + piece);
+    ReadRaw(in, string.data() + offset, piece);
+  }
+}
+
+}  // namespace
+
+TextIndex::TextIndex(const allocator_type &alloc)
+    : docs_(alloc),
+      live_(alloc),
+      terms_(alloc),
+      term_ids_(alloc),
+      term_docs_(alloc),
+      trigram_docs_(alloc) {}
+
+TextIndex::TextIndex(const TextIndex &other, const allocator_type &alloc)
+    : docs_(other.docs_, alloc),
+      live_(other.live_, alloc),
+      total_length_(other.total_length_),
+      terms_(other.terms_, alloc),
+      term_ids_(other.term_ids_, alloc),
+      term_docs_(other.term_docs_, alloc),
+      trigram_docs_(other.trigram_docs_, alloc) {}
+
+TextIndex::TextIndex(TextIndex &&other, const allocator_type &alloc)
+    : docs_(std::move(other.docs_), alloc),
+      live_(std::move(other.live_), alloc),
+      total_length_(other.total_length_),
+      terms_(std::move(other.terms_), alloc),
+      term_ids_(std::move(other.term_ids_), alloc),
+      term_docs_(std::move(other.term_docs_), alloc),
+      trigram_docs_(std::move(other.trigram_docs_), alloc) {}
+
+void TextIndex::Set(const u32 doc, const str_view title, const str_view body) {
+  if (Contains(doc)) {
+    Unindex(doc);
+  } else {
+    if (doc >= docs_.size()) docs_.resize(u64{doc} + 1);
+    live_.Add(doc);
+  }
+  Doc &d = docs_[doc];
+  d.text.clear();
+  FoldInto(title, d.text);
+  d.title_size = title.size();
+  FoldInto(body, d.text);
+
+  // One Occurrence per token, then merged per term.
+  vector<Occurrence> terms;
+  ForEachToken(d.title(), [&](const str_view token) {
+    terms.push_back({Intern(token), 1, 0});
+  });
+  ForEachToken(d.body(), [&](const str_view token) {
+    terms.push_back({Intern(token), 0, 1});
+  });
+  std::ranges::sort(terms, {}, &Occurrence::term);
+  d.terms.clear();
+  d.length = 0;
+  for (const Occurrence &term : terms) {
+    if (d.terms.empty() || d.terms.back().term != term.term) {
+      d.terms.push_back({term.term, 0, 0});
+    }
+    d.terms.back().title_count += term.title_count;
+    d.terms.back().body_count += term.body_count;
+    d.length += kTitleWeight * term.title_count + term.body_count;
+  }
+  Index(doc);
+}
+
+bool TextIndex::Remove(const u32 doc) {
+  if (!Contains(doc)) return false;
+  Unindex(doc);
+  live_.Remove(doc);
+  docs_[doc] = Doc(get_allocator());
+  return true;
+}
+
+void TextIndex::Renumber(const u32 from, const u32 to) {
+  Unindex(from);
+  live_.Remove(from);
+  if (to >= docs_.size()) docs_.resize(u64{to} + 1);
+  docs_[to] = std::move(docs_[from]);
+  docs_[from] = Doc(get_allocator());
+  live_.Add(to);
+  Index(to);
+}
+
+vector<TextIndex::Hit> TextIndex::Search(const str_view query,
+                                         const u64 limit) const {
+  pmr::str folded;
+  FoldInto(query, folded);
+  vector<u32> terms;
+  bool unknown = false;
+  ForEachToken(folded, [&](const str_view token) {
+    const auto it = term_ids_.find(token);
+    if (it == term_ids_.end()) {
+      unknown = true;
+    } else {
+      terms.push_back(it->second);
+    }
+  });
+  if (unknown || terms.empty()) return {};
+  std::ranges::sort(terms);
+  terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+  vector<const RoaringBitmap *> bitmaps;
+  vector<f64> idfs;
+  const f64 n = size();
+  for (const u32 term : terms) {
+    bitmaps.push_back(&term_docs_[term]);
+    const f64 df = term_docs_[term].Cardinality();
+    idfs.push_back(std::log(1 + (n - df + 0.5) / (df + 0.5)));
+  }
+  const f64 average_length = total_length_ / n;
+  vector<Hit> hits;
+  Intersect(std::move(bitmaps)).ForEach([&](const u32 doc) {
+    const Doc &d = docs_[doc];
+    const f64 discount = kK1 * (1 - kB + kB * d.length / average_length);
+    f64 score = 0;
+    for (u64 i = 0; i < terms.size(); ++i) {
+      const auto occurrence =
+          std::ranges::lower_bound(d.terms, terms[i], {}, &Occurrence::term);
+      // Every term's bitmap agrees with its documents' terms (Load makes
+      // sure of it), but a miss shouldn't read past the end.
+      if (occurrence == d.terms.end() || occurrence->term != terms[i]) {
+        continue;
+      }
+      const f64 tf =
+          kTitleWeight * occurrence->title_count + occurrence->body_count;
+      score += idfs[i] * tf * (kK1 + 1) / (tf + discount);
+    }
+    hits.push_back({doc, score});
+  });
+  return Best(std::move(hits), limit);
+}
+
+vector<TextIndex::Hit> TextIndex::SearchSubstring(const str_view needle,
+                                                  const u64 limit) const {
+  if (needle.empty()) return {};
+  pmr::str folded;
+  FoldInto(needle, folded);
+  RoaringBitmap candidates(get_allocator());
+  if (folded.size() >= 3) {
+    vector<const RoaringBitmap *> bitmaps;
+    for (const u32 key : Trigrams(folded, {})) {
+      const auto it = trigram_docs_.find(key);
+      if (it == trigram_docs_.end()) return {};
+      bitmaps.push_back(&it->second);
+    }
+    candidates = Intersect(std::move(bitmaps));
+  } else {
+    candidates = live_;
+  }
+  // Having every trigram doesn't mean having them in a row, so each
+  // candidate is checked.
+  vector<Hit> hits;
+  candidates.ForEach([&](const u32 doc) {
+    const Doc &d = docs_[doc];
+    if (const u64 at = d.title().find(folded); at != str_view::npos) {
+      hits.push_back({doc, 1 + 1.0 / (2 + at)});
+    } else if (const u64 at = d.body().find(folded); at != str_view::npos) {
+      hits.push_back({doc, 1.0 / (2 + at)});
+    }
+  });
+  return Best(std::move(hits), limit);
+}
+
+void TextIndex::Save(std::ostream &out, const u64 stamp) const {
+  WriteRaw(out, kMagic, sizeof(kMagic));
+  WriteRaw(out, &kFormatVersion, 1);
+  WriteRaw(out, &stamp, 1);
+
+  const u32 term_count = terms_.size();
+  WriteRaw(out, &term_count, 1);
+  for (u32 term = 0; term < term_count; ++term) {
+    WriteString(out, terms_[term]);
+    term_docs_[term].Save(out);
+  }
+  const u32 trigram_count = trigram_docs_.size();
+  WriteRaw(out, &trigram_count, 1);
+  for (const auto &[key, docs] : trigram_docs_) {
+    WriteRaw(out, &key, 1);
+    docs.Save(out);
+  }
+
+  const u32 slots = docs_.size();
+  WriteRaw(out, &slots, 1);
+  live_.Save(out);
+  WriteRaw(out, &total_length_, 1);
+  live_.ForEach([&](const u32 doc) {
+    const Doc &d = docs_[doc];
+    WriteString(out, d.text);
+    WriteRaw(out, &d.title_size, 1);
+    WriteRaw(out, &d.length, 1);
+    const u32 occurrences = d.terms.size();
+    WriteRaw(out, &occurrences, 1);
+    WriteRaw(out, d.terms.data(), occurrences);
+  });
+}
+
+TextIndex TextIndex::Load(std::istream &in, u64 *stamp,
+                          const allocator_type &alloc) {
+  char magic[sizeof(kMagic)];
+  ReadRaw(in, magic, sizeof(magic));
+  if (memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+    throw std::runtime_error("Not a TextIndex");
+  }
+  u32 version;
+  ReadRaw(in, &version, 1);
+  if (version != kFormatVersion) {
+    throw std::runtime_error("Unsupported TextIndex version "
+                             + std::to_string(version));
+  }
+  u64 saved_stamp;
+  ReadRaw(in, &saved_stamp, 1);
+  if (stamp) *stamp = saved_stamp;
+
+  TextIndex index(alloc);
+  u32 term_count;
+  ReadRaw(in, &term_count, 1);
+  // Grown one term at a time, so a bad count runs out of input rather than
+  // allocating it all up front.
+  for (u32 term = 0; term < term_count; ++term) {
+    ReadString(in, index.terms_.emplace_back());
+    if (!index.term_ids_.emplace(index.terms_[term], term).second) {
+      Malformed();
+    }
+    index.term_docs_.push_back(RoaringBitmap::Load(in, alloc));
+  }
+  u32 trigram_count;
+  ReadRaw(in, &trigram_count, 1);
+  for (u32 i = 0; i < trigram_count; ++i) {
+    u32 key;
+    ReadRaw(in, &key, 1);
+    index.trigram_docs_.emplace(key, RoaringBitmap::Load(in, alloc));
+  }
+
+  u32 slots;
+  ReadRaw(in, &slots, 1);
+  index.live_ = RoaringBitmap::Load(in, alloc);
+  // Slots past the last live document hold nothing, so only as many as it
+  // needs are made, however many the file claims.
+  const opt<u32> last = index.live_.Max();
+  if (last && *last >= slots) Malformed();
+  index.docs_.resize(last ? u64{*last} + 1 : 0);
+  // Substring search reads the text of every document a trigram has.
+  for (const auto &[key, docs] : index.trigram_docs_) {
+    if ((docs & index.live_).Cardinality() != docs.Cardinality()) Malformed();
+  }
+  ReadRaw(in, &index.total_length_, 1);
+  u64 total_length = 0;
+  u64 total_occurrences = 0;
+  index.live_.ForEach([&](const u32 doc) {
+    Doc &d = index.docs_[doc];
+    ReadString(in, d.text);
+    ReadRaw(in, &d.title_size, 1);
+    ReadRaw(in, &d.length, 1);
+    u32 occurrences;
+    ReadRaw(in, &occurrences, 1);
+    if (occurrences > term_count) Malformed();
+    d.terms.resize(occurrences);
+    ReadRaw(in, d.terms.data(), occurrences);
+    if (d.title_size > d.text.size()) Malformed();
+    // Terms must be sorted and distinct, each a known term whose bitmap
+    // has this document, with counts adding up to the length.
+    u64 length = 0;
+    for (u32 i = 0; i < occurrences; ++i) {
+      const Occurrence &occurrence = d.terms[i];
+      if (occurrence.term >= term_count
+          || (i > 0 && occurrence.term <= d.terms[i - 1].term)
+          || !index.term_docs_[occurrence.term].Contains(doc)) {
+        Malformed();
+      }
+      length += u64{kTitleWeight} * occurrence.title_count
+              + occurrence.body_count;
+    }
+    if (length != d.length) Malformed();
+    total_length += length;
+    total_occurrences += occurrences;
+  });
+  // With every (term, document) pair above in a bitmap, equal totals mean
+  // the bitmaps hold nothing else.
+  u64 total_postings = 0;
+  for (const RoaringBitmap &docs : index.term_docs_) {
+    total_postings += docs.Cardinality();
+  }
+  if (total_postings != total_occurrences
+      || total_length != index.total_length_) {
+    Malformed();
+  }
+  return index;
+}
+
+u32 TextIndex::Intern(const str_view token) {
+  // Most tokens are already known, so look before building a key.
+  if (const auto it = term_ids_.find(token); it != term_ids_.end()) {
+    return it->second;
+  }
+  const u32 id = terms_.size();
+  term_ids_.emplace(token, id);
+  terms_.emplace_back(token);
+  term_docs_.emplace_back();
+  return id;
+}
+
+void TextIndex::Index(const u32 doc) {
+  const Doc &d = docs_[doc];
+  total_length_ += d.length;
+  for (const Occurrence &occurrence : d.terms) {
+    term_docs_[occurrence.term].Add(doc);
+  }
+  for (const u32 key : Trigrams(d.title(), d.body())) {
+    trigram_docs_[key].Add(doc);
+  }
+}
+
+void TextIndex::Unindex(const u32 doc) {
+  const Doc &d = docs_[doc];
+  total_length_ -= d.length;
+  for (const Occurrence &occurrence : d.terms) {
+    term_docs_[occurrence.term].Remove(doc);
+  }
+  for (const u32 key : Trigrams(d.title(), d.body())) {
+    const auto it = trigram_docs_.find(key);
+    it->second.Remove(doc);
+    if (it->second.empty()) trigram_docs_.erase(it);
+  }
+}
+
+RoaringBitmap TextIndex::Intersect(
+    vector<const RoaringBitmap *> bitmaps) const {
+  // Smallest first, so every intersection after it is cheap.
+  std::ranges::sort(bitmaps, {}, &RoaringBitmap::Cardinality);
+  RoaringBitmap docs(*bitmaps[0], get_allocator());
+  for (u64 i = 1; i < bitmaps.size() && !docs.empty(); ++i) {
+    docs &= *bitmaps[i];
+  }
+  return docs;
+}
+
+}  // namespace rose
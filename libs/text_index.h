@@ -0,0 +1,137 @@
+#ifndef BOARD_BEE_LIBS_TEXT_INDEX_H_
+#define BOARD_BEE_LIBS_TEXT_INDEX_H_
+
+#include "aliases.h"
+
+#include <iosfwd>
+#include <memory_resource>
+
+#include "roaring_bitmap.h"
+
+namespace rose {
+
+// A full-text index over short documents, each a title and an optional body
+// under a caller-chosen u32 id. Text is folded to lower case (ASCII only)
+// and split into tokens at every byte that isn't a letter or a digit; bytes
+// of multi-byte UTF-8 characters count as letters, so they stay in tokens.
+// Two indexes map to RoaringBitmaps of ids: one from each token, for word
+// queries ranked by BM25, and one from each trigram of folded text, for
+// substring queries. Documents can be set and removed at any time, and the
+// whole index can be saved and loaded without rebuilding anything.
+class TextIndex {
+ public:
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  // A token in a title counts as this many in a body.
+  static constexpr u32 kTitleWeight = 3;
+
+  struct Hit {
+    u32 doc;
+    f64 score;
+  };
+
+  explicit TextIndex(const allocator_type &alloc = {});
+  TextIndex(const TextIndex &other, const allocator_type &alloc);
+  TextIndex(TextIndex &&other, const allocator_type &alloc);
+  TextIndex(const TextIndex &other) = default;
+  TextIndex &operator=(const TextIndex &other) = default;
+  TextIndex(TextIndex &&other) = default;
+  TextIndex &operator=(TextIndex &&other) = default;
+
+  allocator_type get_allocator() const { return docs_.get_allocator(); }
+
+  // Number of documents.
+  u64 size() const { return live_.Cardinality(); }
+  bool Contains(const u32 doc) const { return live_.Contains(doc); }
+
+  // Adds document `doc`, replacing it if it's already there.
+  void Set(u32 doc, str_view title, str_view body = {});
+  // Removes document `doc`. Returns false if there's no such document.
+  bool Remove(u32 doc);
+  // Moves document `from` to the unused id `to`.
+  void Renumber(u32 from, u32 to);
+
+  // Returns the documents containing every token of `query`, best first
+  // and at most `limit` of them. Scores are BM25 over the title and body
+  // together, with title tokens counted kTitleWeight times.
+  vector<Hit> Search(str_view query, u64 limit) const;
+  // Returns the documents whose folded title or body contains `needle`
+  // folded, at most `limit` of them. Title matches come first, then earlier
+  // matches. Needles of 3 or more bytes only look at documents with all
+  // their trigrams; shorter ones check every document.
+  vector<Hit> SearchSubstring(str_view needle, u64 limit) const;
+
+  // Writes the index to `out` in native byte order, along with `stamp`,
+  // which callers can use to tell whether it's still up to date (e.g. a
+  // hash of the file it indexes).
+  void Save(std::ostream &out, u64 stamp) const;
+  // Reads an index written by Save, setting `*stamp` (if given) to the one
+  // it was saved with. Throws a std::runtime_error if `in` doesn't hold one.
+  static TextIndex Load(std::istream &in, u64 *stamp = nullptr,
+                        const allocator_type &alloc = {});
+
+ private:
+  // Times a token appears in a document's title and body.
+  struct Occurrence {
+    u32 term;
+    u32 title_count;
+    u32 body_count;
+  };
+
+  // A document's folded text, title then body, and its tokens, sorted by
+  // term id. `length` is the number of tokens, weighted like their counts.
+  struct Doc {
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit Doc(const allocator_type &alloc = {})
+        : text(alloc), terms(alloc) {}
+    Doc(const Doc &other, const allocator_type &alloc)
+        : text(other.text, alloc),
+          title_size(other.title_size),
+          length(other.length),
+          terms(other.terms, alloc) {}
+    Doc(Doc &&other, const allocator_type &alloc)
+        : text(std::move(other.text), alloc),
+          title_size(other.title_size),
+          length(other.length),
+          terms(std::move(other.terms), alloc) {}
+    Doc(const Doc &other) = default;
+    Doc &operator=(const Doc &other) = default;
+    Doc(Doc &&other) = default;
+    Doc &operator=(Doc &&other) = default;
+
+    str_view title() const { return str_view(text).substr(0, title_size); }
+    str_view body() const { return str_view(text).substr(title_size); }
+
+    pmr::str text;
+    u32 title_size = 0;
+    u32 length = 0;
+    pmr::vector<Occurrence> terms;
+  };
+
+  // Returns the id of `token`, giving it the next one if it has none.
+  u32 Intern(str_view token);
+  // Adds `doc` to, or removes it from, the bitmap of each of its tokens and
+  // trigrams.
+  void Index(u32 doc);
+  void Unindex(u32 doc);
+  // Returns the intersection of `bitmaps`, smallest first.
+  RoaringBitmap Intersect(vector<const RoaringBitmap *> bitmaps) const;
+
+  // Indexed by id; only those in `live_` mean anything.
+  pmr::vector<Doc> docs_;
+  RoaringBitmap live_;
+  // Sum of every live Doc's length.
+  u64 total_length_ = 0;
+  // Each token gets the next id the first time it's seen, and keeps it after
+  // the last document using it is gone.
+  pmr::vector<pmr::str> terms_;
+  pmr::StrHashMap<u32> term_ids_;
+  pmr::vector<RoaringBitmap> term_docs_;
+  // Keyed by three bytes of folded text, packed into the low 24 bits.
+  pmr::HashMap<u32, RoaringBitmap> trigram_docs_;
+};
+
+}  // namespace rose
+
+#endif  // BOARD_BEE_LIBS_TEXT_INDEX_H_
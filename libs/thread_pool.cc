@@ -0,0 +1,88 @@
+#include "thread_pool.h"
+
+#include "aliases.h"
+
+namespace rose {
+
+ThreadPool::ThreadPool(const u32 threads) {
+  workers_.reserve(threads > 1 ? threads - 1 : 0);
+  for (u32 id = 1; id < threads; ++id) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this, id);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &worker : workers_) worker.join();
+}
+
+bool ThreadPool::PopFront(ChunkRange &range, u64 &chunk) {
+  u64 bounds = range.bounds.load(std::memory_order_relaxed);
+  while (true) {
+    const u64 front = bounds >> 32;
+    const u64 back = bounds & 0xFFFF'FFFF;
+    if (front >= back) return false;
+    if (range.bounds.compare_exchange_weak(bounds, Pack(front + 1, back),
+                                           std::memory_order_relaxed)) {
+      chunk = front;
+      return true;
+    }
+  }
+}
+
+bool ThreadPool::PopBack(ChunkRange &range, u64 &chunk) {
+  u64 bounds = range.bounds.load(std::memory_order_relaxed);
+  while (true) {
+    const u64 front = bounds >> 32;
+    const u64 back = bounds & 0xFFFF'FFFF;
+    if (front >= back) return false;
+    if (range.bounds.compare_exchange_weak(bounds, Pack(front, back - 1),
+                                           std::memory_order_relaxed)) {
+      chunk = back - 1;
+      return true;
+    }
+  }
+}
+
+void ThreadPool::Run(const u32 threads,
+                     const std::function<void(u32)> &task) {
+  std::lock_guard run_lock(run_mutex_);
+  const u32 helpers = std::min<u32>(threads, size()) - 1;
+  {
+    std::lock_guard lock(mutex_);
+    task_ = &task;
+    task_threads_ = helpers + 1;
+    running_ = static_cast<u32>(workers_.size());
+    ++generation_;
+  }
+  wake_.notify_all();
+  task(0);
+  std::unique_lock lock(mutex_);
+  done_.wait(lock, [this] { return running_ == 0; });
+  task_ = nullptr;
+}
+
+void ThreadPool::WorkerLoop(const u32 id) {
+  u64 seen = 0;
+  while (true) {
+    const std::function<void(u32)> *task;
+    bool participate;
+    {
+      std::unique_lock lock(mutex_);
+      wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+      if (stopping_) return;
+      seen = generation_;
+      task = task_;
+      participate = id < task_threads_;
+    }
+    if (participate) (*task)(id);
+    std::lock_guard lock(mutex_);
+    if (--running_ == 0) done_.notify_one();
+  }
+}
+
+}  // namespace rose
@@ -0,0 +1,129 @@
+#ifndef BOARD_BEE_LIBS_THREAD_POOL_H_
+#define BOARD_BEE_LIBS_THREAD_POOL_H_
+
+#include "aliases.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace rose {
+
+// Fixed set of worker threads for splitting independent work into pieces.
+// The thread that hands the pool some work joins in, so a pool of size n
+// runs n - 1 threads of its own.
+class ThreadPool {
+ public:
+  // Number of indices each thread claims at a time in FindFirst.
+  static constexpr u64 kDefaultChunkSize = 64;
+
+  explicit ThreadPool(u32 threads = DefaultSize());
+  ThreadPool(const ThreadPool &other) = delete;
+  ThreadPool &operator=(const ThreadPool &other) = delete;
+  ~ThreadPool();
+
+  // Returns the number of threads that share work, including the caller.
+  u32 size() const { return static_cast<u32>(workers_.size()) + 1; }
+
+  // Returns the lowest index i on [0, count) for which `predicate(i)` is
+  // true, or std::nullopt if there isn't one. The result is the same as a
+  // serial loop's, however the work ends up being split.
+  //
+  // Indices are handed out `chunk_size` at a time. Each thread starts with
+  // an even share of the chunks, takes them from the front of its share, and
+  // once it runs out steals from the back of the others'. Chunks past the
+  // lowest hit found so far are skipped, so work stops soon after a hit.
+  // `predicate` is called from several threads at once and must not throw.
+  template <typename Predicate>
+  opt<u64> FindFirst(u64 count, const Predicate &predicate,
+                     u64 chunk_size = kDefaultChunkSize);
+
+ private:
+  // A thread's remaining chunks as [front, back), packed into one word so
+  // both ends can be claimed with a single compare-and-swap. Each sits on its
+  // own cache line so owners and thieves of different ranges don't collide.
+  struct alignas(64) ChunkRange {
+    std::atomic<u64> bounds;
+  };
+
+  static u32 DefaultSize() {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  static u64 Pack(const u64 front, const u64 back) {
+    return front << 32 | back;
+  }
+  // Claims the chunk at the front of `range`; false if it's empty.
+  static bool PopFront(ChunkRange &range, u64 &chunk);
+  // Claims the chunk at the back of `range`; false if it's empty.
+  static bool PopBack(ChunkRange &range, u64 &chunk);
+
+  // Calls `task(id)` once on each of the first `threads` threads (the caller
+  // is id 0) and returns once they've all finished.
+  void Run(u32 threads, const std::function<void(u32)> &task);
+  void WorkerLoop(u32 id);
+
+  vector<std::thread> workers_;
+  // Held for the whole of Run, so only one caller uses the workers at once.
+  std::mutex run_mutex_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(u32)> *task_ = nullptr;
+  u32 task_threads_ = 0;
+  u64 generation_ = 0;
+  u32 running_ = 0;
+  bool stopping_ = false;
+};
+
+template <typename Predicate>
+opt<u64> ThreadPool::FindFirst(const u64 count, const Predicate &predicate,
+                               u64 chunk_size) {
+  chunk_size = std::max<u64>(chunk_size, 1);
+  const u64 chunks = (count + chunk_size - 1) / chunk_size;
+  if (chunks <= 1 || workers_.empty() || chunks >> 32) {
+    for (u64 i = 0; i < count; ++i) {
+      if (predicate(i)) return i;
+    }
+    return std::nullopt;
+  }
+  const auto threads = static_cast<u32>(std::min<u64>(size(), chunks));
+  vector<ChunkRange> ranges(threads);
+  for (u32 t = 0; t < threads; ++t) {
+    const u64 front = chunks * t / threads;
+    const u64 back = chunks * (t + 1) / threads;
+    ranges[t].bounds.store(Pack(front, back), std::memory_order_relaxed);
+  }
+  std::atomic<u64> first = count;
+  const auto run_chunk = [&](const u64 chunk) {
+    const u64 begin = chunk * chunk_size;
+    const u64 end = std::min(begin + chunk_size, count);
+    for (u64 i = begin; i < end; ++i) {
+      // Anything past an earlier hit can't change the answer.
+      u64 lowest = first.load(std::memory_order_relaxed);
+      if (i >= lowest) return;
+      if (!predicate(i)) continue;
+      while (i < lowest && !first.compare_exchange_weak(
+                               lowest, i, std::memory_order_relaxed)) {}
+      return;
+    }
+  };
+  Run(threads, [&](const u32 id) {
+    u64 chunk;
+    while (PopFront(ranges[id], chunk)) run_chunk(chunk);
+    // Steal from the others, starting with the next thread along.
+    for (u32 k = 1; k < threads; ++k) {
+      ChunkRange &victim = ranges[(id + k) % threads];
+      while (PopBack(victim, chunk)) run_chunk(chunk);
+    }
+  });
+  const u64 result = first.load(std::memory_order_relaxed);
+  return result == count ? std::nullopt : mk_opt<u64>(result);
+}
+
+}  // namespace rose
+
+#endif  // BOARD_BEE_LIBS_THREAD_POOL_H_
@@ -1,175 +1,198 @@
 #include "date_time.h"
 
+#include <bit>
 #include <cstring>
-#include <regex>
-#include <sstream>
 
 #include "../aliases.h"
 #include "exceptions.h"
 
 namespace rose::time {
 
-DateTime::DateTime(const str &iso_string) {
-  std::smatch match_results;
-  if (!std::regex_match(iso_string, match_results, kSimpleIso8601)) {
-    std::stringstream error_msg;
-    error_msg << "String \"" << iso_string
-              << "\" is not compliant with ISO 8601";
-    throw BadDateTimeException(error_msg.str());
+u64 DateTime::ParseAll(const std::span<const str_view> iso_strings,
+                       const std::span<opt<DateTime>> out) {
+  // One string at a time. Parse has no branches on valid input, so the
+  // CPU can overlap neighbouring iterations, but nothing here is SIMD.
+  u64 parsed = 0;
+  for (u64 i = 0; i < iso_strings.size(); ++i) {
+    out[i] = Parse(iso_strings[i]);
+    parsed += out[i].has_value();
   }
-  year_ = atoi(match_results[1].str().c_str());
-  month_ = atoi(match_results[2].str().c_str());
-  if (month_ == 0 || month_ > 12) {
-    std::stringstream error_msg;
-    error_msg << "Month " << month_ << " is not on the interval [1, 12]";
-    throw BadDateTimeException(error_msg.str());
-  }
-  day_ = atoi(match_results[3].str().c_str());
-  const u8 days_in_month = DaysInMonth(year_, month_);
-  if (day_ == 0 || day_ > days_in_month) {
-    std::stringstream error_msg;
-    error_msg << "Day " << day_ << " is not on the interval [1, "
-              << days_in_month << ']';
-    throw BadDateTimeException(error_msg.str());
-  }
-  hour_ = atoi(match_results[4].str().c_str());
-  if (hour_ > 23) {
-    std::stringstream error_msg;
-    error_msg << "Hour " << hour_ << " is not on the interval [0, 23]";
-    throw BadDateTimeException(error_msg.str());
-  }
-  minute_ = atoi(match_results[5].str().c_str());
-  if (minute_ > 59) {
-    std::stringstream error_msg;
-    error_msg << "Minute " << minute_ << " is not on the interval [0, 59]";
-    throw BadDateTimeException(error_msg.str());
-  }
-  second_ = atoi(match_results[6].str().c_str());
-  if (second_ > 60) {
-    std::stringstream error_msg;
-    error_msg << "Second " << second_ << " is not on the interval [0, 60]";
-    throw BadDateTimeException(error_msg.str());
+  return parsed;
+}
+
+str DateTime::ErrorMessage(const str_view iso_string,
+                           const ParseError error) {
+  const internal::Fields fields = internal::ReadFields(iso_string);
+  const auto interval = [](const char *field, const u32 value,
+                           const u32 min, const u32 max) {
+    return str(field) + ' ' + std::to_string(value)
+         + " is not on the interval [" + std::to_string(min) + ", "
+         + std::to_string(max) + ']';
+  };
+  switch (error) {
+    case ParseError::kNone:
+      return "No error";
+    case ParseError::kLayout:
+      return str("String \"") + str(iso_string)
+           + "\" is not compliant with ISO 8601";
+    case ParseError::kMonth:
+      return interval("Month", fields.month, 1, 12);
+    case ParseError::kDay:
+      return interval("Day", fields.day, 1,
+                      DaysInMonth(fields.year, fields.month));
+    case ParseError::kHour:
+      return interval("Hour", fields.hour, 0, 23);
+    case ParseError::kMinute:
+      return interval("Minute", fields.minute, 0, 59);
+    case ParseError::kSecond:
+      return interval("Second", fields.second, 0, 60);
+    case ParseError::kLeapSecond:
+      return str(iso_string.substr(0, 10)) + " did not have a leap second";
+    case ParseError::kOffset:
+      return "Offset " + str(iso_string.substr(19))
+           + " is not on the interval [-23:59, +23:59]";
+    case ParseError::kRange:
+      return str(iso_string)
+           + " is not between 0000-01-01T00:00:00Z and 9999-12-31T23:59:60Z";
   }
-  if (hour_ != 23 || minute_ != 59 || second_ != 60 || HasLeapSecond()) return;
-  std::stringstream error_msg;
-  error_msg << NiceDateString() << " did not have a leap second";
-  throw BadDateTimeException(error_msg.str());
+  return "Unknown error";
 }
 
-bool DateTime::IsValidDateTime(const str &string) {
-  try {
-    static_cast<void>(DateTime(string));
-  } catch (const BadDateTimeException &_) {
-    return false;
+namespace {
+
+// Writes the low `n` bytes of `word` to `out`, lowest first whatever the
+// host's byte order.
+void Store(char *out, u64 word, const u64 n) {
+  if constexpr (std::endian::native == std::endian::big) {
+    word = std::byteswap(word);
   }
-  return true;
+  std::memcpy(out, &word, n);
+}
+
+// Returns the ASCII digits of four values below 100, one per 16-bit lane of
+// `lanes`, as eight characters with the first lane's first.
+u64 PairDigits(const u64 lanes) {
+  // x * 103 >> 10 is x / 10 for every x below 100, and can't leave its lane.
+  const u64 tens = (lanes * 103 >> 10) & 0x000F000F000F000F;
+  const u64 ones = lanes - tens * 10;
+  return tens | ones << 8 | 0x3030303030303030;
+}
+
+// The digits of a DateTime: "YYYYMMDD" and "HHMMSS" (in the low six bytes).
+struct Digits {
+  u64 date;
+  u64 time;
+};
+
+Digits ToDigits(const DateTime &date_time) {
+  const CivilDate civil = date_time.date();
+  const u32 second_of_day = date_time.second_of_day();
+  const u64 year = civil.year;
+  const u64 date_lanes = year / 100 | (year % 100) << 16
+                       | static_cast<u64>(civil.month) << 32
+                       | static_cast<u64>(civil.day) << 48;
+  const u64 time_lanes =
+      second_of_day / 3600 | static_cast<u64>(second_of_day / 60 % 60) << 16
+      | static_cast<u64>(second_of_day % 60 + date_time.is_leap_second())
+            << 32;
+  return {PairDigits(date_lanes), PairDigits(time_lanes)};
 }
 
-bool DateTime::IsLeapYear(const u16 year) {
-  const bool a = year % 4;
-  const bool b = year % 100;
-  const bool c = year % 400;
-  return !(a || b ^ c);
+// Writes `date_time` to `out`, which has room for `format`.
+void Format(const DateTime &date_time, const DateTimeFormat format,
+            char *out) {
+  const auto [date, time] = ToDigits(date_time);
+  switch (format) {
+    case DateTimeFormat::kIso:
+      Store(out, (date & 0xFFFFFFFF) | u64{'-'} << 32
+                     | (date >> 32 & 0xFFFF) << 40 | u64{'-'} << 56,
+            8);
+      Store(out + 8, (date >> 48) | u64{'T'} << 16 | (time & 0xFFFF) << 24
+                         | u64{':'} << 40 | (time >> 16 & 0xFFFF) << 48,
+            8);
+      Store(out + 16, ':' | (time >> 32 & 0xFFFF) << 8 | u64{'Z'} << 24, 4);
+      return;
+    case DateTimeFormat::kCompact:
+      Store(out, date, 8);
+      Store(out + 8, 'T' | (time & 0xFFFFFFFFFFFF) << 8 | u64{'Z'} << 56, 8);
+      return;
+    case DateTimeFormat::kIsoDate:
+      Store(out, (date & 0xFFFFFFFF) | u64{'-'} << 32
+                     | (date >> 32 & 0xFFFF) << 40 | u64{'-'} << 56,
+            8);
+      Store(out + 8, date >> 48, 2);
+      return;
+    case DateTimeFormat::kCompactDate:
+      Store(out, date, 8);
+      return;
+    case DateTimeFormat::kIsoTime:
+      Store(out, 'T' | (time & 0xFFFF) << 8 | u64{':'} << 24
+                     | (time >> 16 & 0xFFFF) << 32 | u64{':'} << 48
+                     | (time >> 32 & 0xFF) << 56,
+            8);
+      Store(out + 8, (time >> 40 & 0xFF) | u64{'Z'} << 8, 2);
+      return;
+    case DateTimeFormat::kCompactTime:
+      Store(out, 'T' | (time & 0xFFFFFFFFFFFF) << 8 | u64{'Z'} << 56, 8);
+      return;
+  }
 }
 
-bool DateTime::HasLeapSecond(const u16 year, const u8 month, const u8 day) {
-  const bool is_jun_30 = month == 6 && day == 30;
-  const bool is_dec_31 = month == 12 && day == 31;
-  if (!(is_jun_30 || is_dec_31)) return false;
-  if (year < 1972 || year > 2016) return false;
-  if (year == 1972) return true;
-  if (year < 1980) return is_dec_31;
-  if (year == 1980 || year == 1984 || year == 1986) return false;
-  if (year < 1986) return is_jun_30;
-  if (year == 1988 || year == 1991) return false;
-  if (year < 1991) return is_dec_31;
-  if (year < 1995) return is_jun_30;
-  if (year == 1995) return is_dec_31;
-  if (year == 1996) return false;
-  if (year == 1997) return is_jun_30;
-  if (year == 1998) return is_dec_31;
-  if (year == 2005 || year == 2008 || year == 2016) return is_dec_31;
-  if (year == 2012 || year == 2015) return is_jun_30;
-  return false;
+}  // namespace
+
+std::to_chars_result DateTime::ToChars(const std::span<char> out,
+                                       const DateTimeFormat format) const {
+  const u64 length = FormattedLength(format);
+  if (out.size() < length) {
+    return {out.data() + out.size(), std::errc::value_too_large};
+  }
+  Format(*this, format, out.data());
+  return {out.data() + length, std::errc()};
 }
 
-u8 DateTime::DaysInMonth(const u16 year, const u8 month) {
-  if (month == 0 || month > 12) return 0;
-  if (month == 2) return IsLeapYear(year) ? 29 : 28;
-  const u8 kDays[12] = {31, 0, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-  return kDays[month - 1];
+u64 DateTime::FormatAll(const std::span<const DateTime> date_times,
+                        const std::span<char> out,
+                        const DateTimeFormat format) {
+  const u64 length = FormattedLength(format);
+  if (out.size() < date_times.size() * length) return 0;
+  // Every record has the same width, so each iteration's stores are
+  // independent of the others'.
+  char *next = out.data();
+  for (const DateTime &date_time : date_times) {
+    Format(date_time, format, next);
+    next += length;
+  }
+  return next - out.data();
 }
 
 str DateTime::DateString() const {
-  char out[9] = "00000000";
-  out[0] += year_ / 1000;          // NOLINT(*-narrowing-conversions)
-  out[1] += (year_ % 1000) / 100;  // NOLINT(*-narrowing-conversions)
-  out[2] += (year_ % 100) / 10;    // NOLINT(*-narrowing-conversions)
-  out[3] += year_ % 10;            // NOLINT(*-narrowing-conversions)
-  const auto &[month_quotient, month_remainder] = std::div(month_, 10);
-  out[4] += month_quotient;   // NOLINT(*-narrowing-conversions)
-  out[5] += month_remainder;  // NOLINT(*-narrowing-conversions)
-  const auto &[day_quotient, day_remainder] = std::div(day_, 10);
-  out[6] += day_quotient;   // NOLINT(*-narrowing-conversions)
-  out[7] += day_remainder;  // NOLINT(*-narrowing-conversions)
-  return out;
+  char out[8];
+  return str(out, ToChars(out, DateTimeFormat::kCompactDate).ptr);
 }
 
 str DateTime::NiceDateString() const {
-  char out[11] = "0000-00-00";
-  out[0] += year_ / 1000;          // NOLINT(*-narrowing-conversions)
-  out[1] += (year_ % 1000) / 100;  // NOLINT(*-narrowing-conversions)
-  out[2] += (year_ % 100) / 10;    // NOLINT(*-narrowing-conversions)
-  out[3] += year_ % 10;            // NOLINT(*-narrowing-conversions)
-  const auto &[month_quotient, month_remainder] = std::div(month_, 10);
-  out[5] += month_quotient;   // NOLINT(*-narrowing-conversions)
-  out[6] += month_remainder;  // NOLINT(*-narrowing-conversions)
-  const auto &[day_quotient, day_remainder] = std::div(day_, 10);
-  out[8] += day_quotient;   // NOLINT(*-narrowing-conversions)
-  out[9] += day_remainder;  // NOLINT(*-narrowing-conversions)
-  return out;
+  char out[10];
+  return str(out, ToChars(out, DateTimeFormat::kIsoDate).ptr);
 }
 
 str DateTime::TimeString() const {
-  char out[9] = "T000000Z";
-  const auto &[hour_quotient, hour_remainder] = std::div(hour_, 10);
-  out[1] += hour_quotient;   // NOLINT(*-narrowing-conversions)
-  out[2] += hour_remainder;  // NOLINT(*-narrowing-conversions)
-  const auto &[minute_quotient, minute_remainder] = std::div(minute_, 10);
-  out[3] += minute_quotient;   // NOLINT(*-narrowing-conversions)
-  out[4] += minute_remainder;  // NOLINT(*-narrowing-conversions)
-  const auto &[second_quotient, second_remainder] = std::div(second_, 10);
-  out[5] += second_quotient;   // NOLINT(*-narrowing-conversions)
-  out[6] += second_remainder;  // NOLINT(*-narrowing-conversions)
-  return out;
+  char out[8];
+  return str(out, ToChars(out, DateTimeFormat::kCompactTime).ptr);
 }
 
 str DateTime::NiceTimeString() const {
-  char out[11] = "T00:00:00Z";
-  const auto &[hour_quotient, hour_remainder] = std::div(hour_, 10);
-  out[1] += hour_quotient;   // NOLINT(*-narrowing-conversions)
-  out[2] += hour_remainder;  // NOLINT(*-narrowing-conversions)
-  const auto &[minute_quotient, minute_remainder] = std::div(minute_, 10);
-  out[4] += minute_quotient;   // NOLINT(*-narrowing-conversions)
-  out[5] += minute_remainder;  // NOLINT(*-narrowing-conversions)
-  const auto &[second_quotient, second_remainder] = std::div(second_, 10);
-  out[7] += second_quotient;   // NOLINT(*-narrowing-conversions)
-  out[8] += second_remainder;  // NOLINT(*-narrowing-conversions)
-  return out;
+  char out[10];
+  return str(out, ToChars(out, DateTimeFormat::kIsoTime).ptr);
 }
 
 str DateTime::AsString() const {
-  char out[17];
-  strncpy(out, DateString().c_str(), 8);
-  strncat(out, TimeString().c_str(), 8);
-  return out;
+  char out[16];
+  return str(out, ToChars(out, DateTimeFormat::kCompact).ptr);
 }
 
 str DateTime::AsNiceString() const {
-  char out[21];
-  strncpy(out, NiceDateString().c_str(), 10);
-  strncat(out, NiceTimeString().c_str(), 10);
-  return out;
+  char out[20];
+  return str(out, ToChars(out, DateTimeFormat::kIso).ptr);
 }
 
-}  // namespace bee
+}  // namespace rose::time
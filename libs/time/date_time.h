@@ -1,38 +1,267 @@
 #ifndef BOARD_BEE_LIBS_TIME_DATE_TIME_H_
 #define BOARD_BEE_LIBS_TIME_DATE_TIME_H_
 
-#include <regex>
+#include <charconv>
+#include <compare>
+#include <initializer_list>
+#include <span>
 
 #include "../aliases.h"
 #include "../json/node.h"
+#include "duration.h"
+#include "exceptions.h"
 
 namespace rose::time {
 
-static const std::regex kSimpleIso8601(
-    R"~~(^(\d{4})-([0-1]\d)-([0-3]\d)T([0-2]\d):([0-5]\d):([0-6]\d)Z$)~~");
+// Why a string couldn't be parsed as a DateTime.
+enum class ParseError : u8 {
+  kNone,
+  // Not of the form YYYY-MM-DDTHH:MM:SSZ or YYYY-MM-DDTHH:MM:SS+HH:MM.
+  kLayout,
+  kMonth,
+  kDay,
+  kHour,
+  kMinute,
+  kSecond,
+  // A second of 60 anywhere but 23:59:60 UTC on a day that ended with a
+  // leap second. Before the regex-free parser, :60 was let through at any
+  // minute other than 23:59; rejecting it there too is intended, since no
+  // such time exists.
+  kLeapSecond,
+  // An offset whose hours or minutes are out of range.
+  kOffset,
+  // A time whose offset moves it outside years 0 through 9999 in UTC.
+  kRange
+};
+
+// Ways to print a DateTime. All are fixed-width.
+enum class DateTimeFormat : u8 {
+  // YYYY-MM-DDTHH:MM:SSZ
+  kIso,
+  // YYYYMMDDTHHMMSSZ
+  kCompact,
+  // YYYY-MM-DD
+  kIsoDate,
+  // YYYYMMDD
+  kCompactDate,
+  // THH:MM:SSZ
+  kIsoTime,
+  // THHMMSSZ
+  kCompactTime
+};
+
+// Returns the number of characters `format` always produces.
+constexpr u64 FormattedLength(const DateTimeFormat format) {
+  switch (format) {
+    case DateTimeFormat::kIso: return 20;
+    case DateTimeFormat::kCompact: return 16;
+    case DateTimeFormat::kIsoDate: return 10;
+    case DateTimeFormat::kCompactDate: return 8;
+    case DateTimeFormat::kIsoTime: return 10;
+    case DateTimeFormat::kCompactTime: return 8;
+  }
+  return 0;
+}
+
+enum class Weekday : u8 {
+  kSunday,
+  kMonday,
+  kTuesday,
+  kWednesday,
+  kThursday,
+  kFriday,
+  kSaturday
+};
+
+// A date in the proleptic Gregorian calendar.
+struct CivilDate {
+  s64 year;
+  u8 month;
+  u8 day;
+};
+
+// Returns floor(a / b) for b > 0.
+constexpr s64 FloorDiv(const s64 a, const s64 b) {
+  return (a >= 0 ? a : a - b + 1) / b;
+}
+
+// Returns the number of days from 1970-01-01 to the given date.
+// Howard Hinnant's days_from_civil: exact for every representable year.
+constexpr s64 DaysFromCivil(s64 year, const u32 month, const u32 day) {
+  // Years start in March so the leap day comes last.
+  year -= month <= 2;
+  const s64 era = FloorDiv(year, 400);
+  // [0, 399], [0, 365] and [0, 146096] respectively.
+  const u32 year_of_era = year - era * 400;
+  const u32 day_of_year =
+      (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  const u32 day_of_era = year_of_era * 365 + year_of_era / 4
+                       - year_of_era / 100 + day_of_year;
+  return era * 146097 + static_cast<s64>(day_of_era) - 719468;
+}
+
+// Inverse of DaysFromCivil.
+constexpr CivilDate CivilFromDays(s64 days) {
+  days += 719468;
+  const s64 era = FloorDiv(days, 146097);
+  const u32 day_of_era = days - era * 146097;
+  const u32 year_of_era = (day_of_era - day_of_era / 1460
+                           + day_of_era / 36524 - day_of_era / 146096)
+                        / 365;
+  const u32 day_of_year =
+      day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  // Counting from March.
+  const u32 shifted_month = (5 * day_of_year + 2) / 153;
+  const u8 day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+  const u8 month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+  return {year_of_era + era * 400 + (month <= 2), month, day};
+}
+
+// Leap seconds inserted at the end of June 30th and December 31st, as bit
+// (year - kFirstLeapSecondYear) of each mask. None have been scheduled since
+// 2016.
+inline constexpr u16 kFirstLeapSecondYear = 1972;
+
+// Returns a mask with the bit for every year in `years` set.
+constexpr u64 LeapSecondYears(const std::initializer_list<u16> years) {
+  u64 mask = 0;
+  for (const u16 year : years) mask |= u64{1} << (year - kFirstLeapSecondYear);
+  return mask;
+}
 
+inline constexpr u64 kJuneLeapSeconds = LeapSecondYears(
+    {1972, 1981, 1982, 1983, 1985, 1992, 1993, 1994, 1997, 2012, 2015});
+inline constexpr u64 kDecemberLeapSeconds =
+    LeapSecondYears({1972, 1973, 1974, 1975, 1976, 1977, 1978, 1979, 1987,
+                     1989, 1990, 1995, 1998, 2005, 2008, 2016});
+
+// An instant in UTC, stored as one integer so comparing, sorting and
+// offsetting DateTimes is plain integer work. The civil fields are computed
+// from it on demand.
+// Follows POSIX time, where every day has 86,400 seconds. A leap second
+// (23:59:60) is kept as 23:59:59 plus a flag that orders it just after, and
+// arithmetic treats it as 23:59:59.
 class DateTime {
  public:
   static DateTime FromJson(const json::Node &node);
 
-  explicit DateTime(const str &iso_string);
-
-  u16 year() const { return year_; }
-  u8 month() const { return month_; }
-  u8 day() const { return day_; }
-  u8 hour() const { return hour_; }
-  u8 minute() const { return minute_; }
-  u8 second() const { return second_; }
-
-  static bool IsValidDateTime(const str &string);
-  static bool IsLeapYear(u16 year);
-  static bool HasLeapSecond(u16 year, u8 month, u8 day);
-  static u8 DaysInMonth(u16 year, u8 month);
-  bool IsLeapYear() const { return IsLeapYear(year_); }
-  bool HasLeapSecond() const { return HasLeapSecond(year_, month_, day_); }
-  u8 DaysInMonth() const { return DaysInMonth(year_, month_); }
+  // 1970-01-01T00:00:00Z.
+  constexpr DateTime() = default;
+
+  // Parses `iso_string`, which must be exactly YYYY-MM-DDTHH:MM:SSZ, or
+  // YYYY-MM-DDTHH:MM:SS followed by an offset from UTC like +02:00 or
+  // -05:30. Times with an offset are converted to UTC, which must still be
+  // in years 0 through 9999.
+  // Throws BadDateTimeException if it isn't a valid date and time.
+  constexpr explicit DateTime(str_view iso_string);
+
+  // Parses `iso_string` like the constructor, but without throwing.
+  // On failure, returns nullopt and sets `*error` if it's given.
+  static constexpr opt<DateTime> Parse(str_view iso_string,
+                                       ParseError *error = nullptr);
+  // Parses every string in `iso_strings` into the matching element of
+  // `out`, which must be at least as long. Strings that fail to parse leave
+  // nullopt behind. Returns how many strings parsed. It's a plain scalar
+  // loop over Parse, not vectorized across strings; it only saves the
+  // caller the loop.
+  static u64 ParseAll(std::span<const str_view> iso_strings,
+                      std::span<opt<DateTime>> out);
+  // Returns a human-readable description of why `iso_string` failed to
+  // parse with `error`.
+  static str ErrorMessage(str_view iso_string, ParseError error);
+
+  // Returns the DateTime `seconds` seconds after 1970-01-01T00:00:00Z,
+  // not counting leap seconds.
+  static constexpr DateTime FromSecondsSinceEpoch(const s64 seconds) {
+    DateTime date_time;
+    date_time.packed_ = seconds * 2;
+    return date_time;
+  }
+
+  // Seconds since 1970-01-01T00:00:00Z, not counting leap seconds.
+  constexpr s64 seconds_since_epoch() const { return packed_ >> 1; }
+  // Days since 1970-01-01; negative before then.
+  constexpr s64 days_since_epoch() const {
+    return FloorDiv(seconds_since_epoch(), Duration::kSecondsPerDay);
+  }
+  // Seconds since the start of the day, without the leap second.
+  constexpr u32 second_of_day() const {
+    return seconds_since_epoch()
+         - days_since_epoch() * Duration::kSecondsPerDay;
+  }
+  constexpr bool is_leap_second() const { return packed_ & 1; }
+
+  constexpr CivilDate date() const { return CivilFromDays(days_since_epoch()); }
+  // Only years 0 through 9999 can be parsed or printed.
+  constexpr u16 year() const { return date().year; }
+  constexpr u8 month() const { return date().month; }
+  constexpr u8 day() const { return date().day; }
+  constexpr u8 hour() const { return second_of_day() / 3600; }
+  constexpr u8 minute() const { return second_of_day() / 60 % 60; }
+  constexpr u8 second() const {
+    return second_of_day() % 60 + is_leap_second();
+  }
+  constexpr Weekday weekday() const {
+    // 1970-01-01 was a Thursday.
+    const s64 days = days_since_epoch() + 4;
+    return static_cast<Weekday>(days - FloorDiv(days, 7) * 7);
+  }
+  // Day of the year, starting from 1 on January 1st.
+  constexpr u16 day_of_year() const {
+    return days_since_epoch() - DaysFromCivil(date().year, 1, 1) + 1;
+  }
+
+  constexpr auto operator<=>(const DateTime &other) const = default;
+
+  // Leap seconds aren't counted, so the result is never one.
+  constexpr DateTime operator+(const Duration duration) const {
+    return FromSecondsSinceEpoch(seconds_since_epoch() + duration.seconds());
+  }
+  constexpr DateTime operator-(const Duration duration) const {
+    return FromSecondsSinceEpoch(seconds_since_epoch() - duration.seconds());
+  }
+  constexpr DateTime &operator+=(const Duration duration) {
+    return *this = *this + duration;
+  }
+  constexpr DateTime &operator-=(const Duration duration) {
+    return *this = *this - duration;
+  }
+  // Leap seconds aren't counted, so 23:59:60 - 23:59:59 is zero.
+  constexpr Duration operator-(const DateTime other) const {
+    return Duration::Seconds(seconds_since_epoch()
+                             - other.seconds_since_epoch());
+  }
+
+  static constexpr bool IsValidDateTime(str_view string);
+  static constexpr bool IsLeapYear(u16 year);
+  static constexpr bool HasLeapSecond(u16 year, u8 month, u8 day);
+  static constexpr u8 DaysInMonth(u16 year, u8 month);
+  constexpr bool IsLeapYear() const { return IsLeapYear(year()); }
+  constexpr bool HasLeapSecond() const {
+    const CivilDate civil = date();
+    return HasLeapSecond(civil.year, civil.month, civil.day);
+  }
+  constexpr u8 DaysInMonth() const {
+    const CivilDate civil = date();
+    return DaysInMonth(civil.year, civil.month);
+  }
   json::Node ToJson() const;
 
+  // Writes this DateTime to `out` in `format`, like std::to_chars: on
+  // success, `ptr` is one past the last character written. If `out` is too
+  // short, nothing is written and `ec` is std::errc::value_too_large.
+  // Never allocates, and doesn't add a null terminator.
+  std::to_chars_result ToChars(
+      std::span<char> out,
+      DateTimeFormat format = DateTimeFormat::kIso) const;
+  // Writes each of `date_times` to `out` in `format`, back to back with
+  // nothing between them, so the i-th starts at i * FormattedLength(format).
+  // Returns the number of characters written, or 0 if `out` is too short.
+  static u64 FormatAll(std::span<const DateTime> date_times,
+                       std::span<char> out,
+                       DateTimeFormat format = DateTimeFormat::kIso);
+
+  // Each of these returns ToChars' output in a new string.
   str DateString() const;
   str NiceDateString() const;
   str TimeString() const;
@@ -41,14 +270,262 @@ class DateTime {
   str AsNiceString() const;
 
  private:
-  u16 year_ : 14;
-  u8 month_ : 4;
-  u8 day_ : 5;
-  u8 hour_ : 5;
-  u8 minute_ : 6;
-  u8 second_ : 6;
+  // (seconds since the epoch << 1) | is_leap_second
+  s64 packed_ = 0;
 };
 
+// Implementation details of DateTime parsing, here so it can run at compile
+// time.
+namespace internal {
+
+// Lengths of YYYY-MM-DDTHH:MM:SSZ and YYYY-MM-DDTHH:MM:SS+HH:MM.
+inline constexpr u64 kUtcLength = 20;
+inline constexpr u64 kOffsetLength = 25;
+
+inline constexpr u64 kLowNibbles = 0x0F0F0F0F0F0F0F0F;
+
+// Returns a word with byte i set to 0xFF if `layout[i]` is 'D' (a digit).
+template <u64 N>
+constexpr u64 DigitMask(const char (&layout)[N]) {
+  u64 mask = 0;
+  for (u64 i = 0; i + 1 < N; ++i) {
+    if (layout[i] == 'D') mask |= u64{0xFF} << (8 * i);
+  }
+  return mask;
+}
+
+// Returns a word with byte i set to `layout[i]` wherever it isn't a digit.
+template <u64 N>
+constexpr u64 SeparatorBytes(const char (&layout)[N]) {
+  u64 bytes = 0;
+  for (u64 i = 0; i + 1 < N; ++i) {
+    if (layout[i] != 'D') bytes |= static_cast<u64>(layout[i]) << (8 * i);
+  }
+  return bytes;
+}
+
+// The string is checked as three words up to the seconds, then the Z or
+// offset is checked on its own.
+inline constexpr char kLayout0[] = "DDDD-DD-";
+inline constexpr char kLayout1[] = "DDTDD:DD";
+inline constexpr char kLayout2[] = ":DD";
+// The offset after its sign.
+inline constexpr char kOffsetLayout[] = "DD:DD";
+
+// Indexed by month; February gains a day in leap years.
+inline constexpr u8 kDaysInMonth[16] = {0,  31, 28, 31, 30, 31, 30, 31,
+                                        31, 30, 31, 30, 31, 0,  0,  0};
+
+// Reads `n` (at most 8) bytes of `string` starting at `offset` into a word,
+// first byte lowest whatever the host's byte order. Compilers turn this into
+// a single load.
+constexpr u64 Load(const str_view string, const u64 offset, const u64 n) {
+  u64 word = 0;
+  for (u64 i = 0; i < n; ++i) {
+    word |= static_cast<u64>(static_cast<u8>(string[offset + i])) << (8 * i);
+  }
+  return word;
+}
+
+// Returns true if every byte of `word` is an ASCII digit where `digits` is
+// 0xFF and matches `separators` everywhere else.
+constexpr bool MatchesLayout(const u64 word, const u64 digits,
+                             const u64 separators) {
+  // A byte is a digit if its high nibble is 3 both before and after adding 6.
+  // Carries out of a non-digit byte only reach bytes that already fail.
+  constexpr u64 kHighNibbles = ~kLowNibbles;
+  const u64 nibbles = (word & kHighNibbles)
+                    | (((word + 0x0606060606060606) & kHighNibbles) >> 4);
+  return ((nibbles & digits) == (0x3333333333333333 & digits))
+       & ((word & ~digits) == separators);
+}
+
+// Returns `word` with byte i of each two-digit field starting at byte i
+// replaced by the field's value. `word` must match `digits`.
+constexpr u64 PairValues(const u64 word, const u64 digits) {
+  const u64 values = word & digits & kLowNibbles;
+  // Neither step can carry between bytes, since 10 * 9 + 9 < 256.
+  return values * 10 + (values >> 8);
+}
+
+constexpr u8 Byte(const u64 word, const u32 i) { return word >> (8 * i); }
+
+// The fields of an ISO 8601 string, and the first thing wrong with them.
+struct Fields {
+  u16 year;
+  u8 month;
+  u8 day;
+  u8 hour;
+  u8 minute;
+  u8 second;
+  // East of UTC.
+  s16 offset_minutes;
+  ParseError error;
+};
+
+// Splits `iso_string` into its fields. Every check runs regardless of the
+// others and they're only told apart once something has failed, so valid
+// strings are parsed without branching on their contents.
+constexpr Fields ReadFields(const str_view iso_string) {
+  Fields fields{};
+  const bool has_offset = iso_string.size() == kOffsetLength;
+  if (!has_offset && iso_string.size() != kUtcLength) {
+    fields.error = ParseError::kLayout;
+    return fields;
+  }
+  const u64 word0 = Load(iso_string, 0, 8);
+  const u64 word1 = Load(iso_string, 8, 8);
+  const u64 word2 = Load(iso_string, 16, 3);
+  constexpr u64 kDigits0 = DigitMask(kLayout0);
+  constexpr u64 kDigits1 = DigitMask(kLayout1);
+  constexpr u64 kDigits2 = DigitMask(kLayout2);
+  bool layout_ok = MatchesLayout(word0, kDigits0, SeparatorBytes(kLayout0))
+                 & MatchesLayout(word1, kDigits1, SeparatorBytes(kLayout1))
+                 & MatchesLayout(word2, kDigits2, SeparatorBytes(kLayout2));
+  const u64 pairs0 = PairValues(word0, kDigits0);
+  const u64 pairs1 = PairValues(word1, kDigits1);
+  const u64 pairs2 = PairValues(word2, kDigits2);
+  fields.year = Byte(pairs0, 0) * 100 + Byte(pairs0, 2);
+  fields.month = Byte(pairs0, 5);
+  fields.day = Byte(pairs1, 0);
+  fields.hour = Byte(pairs1, 3);
+  fields.minute = Byte(pairs1, 6);
+  fields.second = Byte(pairs2, 1);
+
+  // Z, or an offset of the form +HH:MM or -HH:MM.
+  const char designator = iso_string[19];
+  bool offset_ok = true;
+  if (has_offset) {
+    const u64 word3 = Load(iso_string, 20, 5);
+    constexpr u64 kDigits3 = DigitMask(kOffsetLayout);
+    layout_ok &= ((designator == '+') | (designator == '-'))
+               & MatchesLayout(word3, kDigits3, SeparatorBytes(kOffsetLayout));
+    const u64 pairs3 = PairValues(word3, kDigits3);
+    const u8 offset_hours = Byte(pairs3, 0);
+    const u8 offset_minutes = Byte(pairs3, 3);
+    offset_ok = (offset_hours < 24) & (offset_minutes < 60);
+    const s16 offset = offset_hours * 60 + offset_minutes;
+    fields.offset_minutes = designator == '-' ? -offset : offset;
+  } else {
+    layout_ok &= designator == 'Z';
+  }
+
+  const u8 days_in_month =
+      // Out-of-range months fail their own check first.
+      kDaysInMonth[fields.month & 15]
+      + ((fields.month == 2) & DateTime::IsLeapYear(fields.year));
+  const bool month_ok = (fields.month - 1u) < 12u;
+  const bool day_ok = (fields.day - 1u) < days_in_month;
+  const bool hour_ok = fields.hour < 24;
+  const bool minute_ok = fields.minute < 60;
+  const bool second_ok = fields.second < 61;
+  if (layout_ok & month_ok & day_ok & hour_ok & minute_ok & second_ok
+      & offset_ok) [[likely]] {
+    if (fields.second == 60) {
+      // Leap seconds happen at 23:59:60 UTC, whatever the local time.
+      const s64 minutes =
+          DaysFromCivil(fields.year, fields.month, fields.day) * 1440
+          + fields.hour * 60 + fields.minute - fields.offset_minutes;
+      const s64 days = FloorDiv(minutes, 1440);
+      const CivilDate utc = CivilFromDays(days);
+      if (minutes - days * 1440 != 1439
+          || !DateTime::HasLeapSecond(utc.year, utc.month, utc.day)) {
+        fields.error = ParseError::kLeapSecond;
+      }
+    }
+    return fields;
+  }
+  if (!layout_ok) {
+    fields.error = ParseError::kLayout;
+  } else if (!month_ok) {
+    fields.error = ParseError::kMonth;
+  } else if (!day_ok) {
+    fields.error = ParseError::kDay;
+  } else if (!hour_ok) {
+    fields.error = ParseError::kHour;
+  } else if (!minute_ok) {
+    fields.error = ParseError::kMinute;
+  } else if (!second_ok) {
+    fields.error = ParseError::kSecond;
+  } else {
+    fields.error = ParseError::kOffset;
+  }
+  return fields;
+}
+
+}  // namespace internal
+
+constexpr DateTime::DateTime(const str_view iso_string) {
+  ParseError error;
+  const opt<DateTime> parsed = Parse(iso_string, &error);
+  if (!parsed) throw BadDateTimeException(ErrorMessage(iso_string, error));
+  *this = *parsed;
+}
+
+constexpr opt<DateTime> DateTime::Parse(const str_view iso_string,
+                                        ParseError *error) {
+  const internal::Fields fields = internal::ReadFields(iso_string);
+  if (error) *error = fields.error;
+  if (fields.error != ParseError::kNone) return std::nullopt;
+  const s64 days = DaysFromCivil(fields.year, fields.month, fields.day);
+  // A leap second is stored as 23:59:59 plus the flag.
+  const bool leap = fields.second == 60;
+  const s64 seconds = days * Duration::kSecondsPerDay + fields.hour * 3600
+                    + (fields.minute - fields.offset_minutes) * 60
+                    + fields.second - leap;
+  // Only years 0 through 9999 can be printed, so the offset mustn't carry
+  // the time past either end.
+  constexpr s64 kFirst = DaysFromCivil(0, 1, 1) * Duration::kSecondsPerDay;
+  constexpr s64 kLast =
+      DaysFromCivil(10000, 1, 1) * Duration::kSecondsPerDay - 1;
+  if (seconds < kFirst || seconds > kLast) {
+    if (error) *error = ParseError::kRange;
+    return std::nullopt;
+  }
+  DateTime date_time;
+  date_time.packed_ = seconds * 2 + leap;
+  return date_time;
+}
+
+constexpr bool DateTime::IsValidDateTime(const str_view string) {
+  return Parse(string).has_value();
+}
+
+constexpr bool DateTime::IsLeapYear(const u16 year) {
+  const bool a = year % 4;
+  const bool b = year % 100;
+  const bool c = year % 400;
+  return !(a || b ^ c);
+}
+
+constexpr bool DateTime::HasLeapSecond(const u16 year, const u8 month,
+                                       const u8 day) {
+  // Wraps around for years before the first, which then miss the masks.
+  const u32 bit = static_cast<u16>(year - kFirstLeapSecondYear);
+  if (bit >= 64) return false;
+  const u64 years = month == 6 && day == 30    ? kJuneLeapSeconds
+                  : month == 12 && day == 31 ? kDecemberLeapSeconds
+                                             : 0;
+  return years >> bit & 1;
+}
+
+constexpr u8 DateTime::DaysInMonth(const u16 year, const u8 month) {
+  if (month == 0 || month > 12) return 0;
+  return internal::kDaysInMonth[month] + (month == 2 && IsLeapYear(year));
+}
+
+namespace literals {
+
+// "YYYY-MM-DDTHH:MM:SSZ"_dt is a DateTime made at compile time. Invalid
+// strings fail to compile.
+consteval DateTime operator""_dt(const char *iso_string, const size_t size) {
+  const opt<DateTime> date_time = DateTime::Parse(str_view(iso_string, size));
+  if (!date_time) throw "Invalid DateTime literal";
+  return *date_time;
+}
+
+}  // namespace literals
+
 }  // namespace rose::time
 
 #endif  // BOARD_BEE_LIBS_TIME_DATE_TIME_H_
@@ -0,0 +1,71 @@
+#ifndef BOARD_BEE_LIBS_TIME_DURATION_H_
+#define BOARD_BEE_LIBS_TIME_DURATION_H_
+
+#include <compare>
+
+#include "../aliases.h"
+
+namespace rose::time {
+
+// A signed span of time, counted in whole seconds.
+class Duration {
+ public:
+  static constexpr s64 kSecondsPerMinute = 60;
+  static constexpr s64 kSecondsPerHour = 60 * kSecondsPerMinute;
+  static constexpr s64 kSecondsPerDay = 24 * kSecondsPerHour;
+  static constexpr s64 kSecondsPerWeek = 7 * kSecondsPerDay;
+
+  constexpr Duration() = default;
+
+  static constexpr Duration Seconds(const s64 n) { return Duration(n); }
+  static constexpr Duration Minutes(const s64 n) {
+    return Duration(n * kSecondsPerMinute);
+  }
+  static constexpr Duration Hours(const s64 n) {
+    return Duration(n * kSecondsPerHour);
+  }
+  static constexpr Duration Days(const s64 n) {
+    return Duration(n * kSecondsPerDay);
+  }
+  static constexpr Duration Weeks(const s64 n) {
+    return Duration(n * kSecondsPerWeek);
+  }
+
+  constexpr s64 seconds() const { return seconds_; }
+  // Whole days in this duration, rounded toward zero.
+  constexpr s64 days() const { return seconds_ / kSecondsPerDay; }
+
+  constexpr auto operator<=>(const Duration &other) const = default;
+
+  constexpr Duration operator-() const { return Duration(-seconds_); }
+  constexpr Duration operator+(const Duration other) const {
+    return Duration(seconds_ + other.seconds_);
+  }
+  constexpr Duration operator-(const Duration other) const {
+    return Duration(seconds_ - other.seconds_);
+  }
+  constexpr Duration operator*(const s64 factor) const {
+    return Duration(seconds_ * factor);
+  }
+  // Rounds toward zero.
+  constexpr Duration operator/(const s64 divisor) const {
+    return Duration(seconds_ / divisor);
+  }
+  constexpr Duration &operator+=(const Duration other) {
+    seconds_ += other.seconds_;
+    return *this;
+  }
+  constexpr Duration &operator-=(const Duration other) {
+    seconds_ -= other.seconds_;
+    return *this;
+  }
+
+ private:
+  explicit constexpr Duration(const s64 seconds) : seconds_(seconds) {}
+
+  s64 seconds_ = 0;
+};
+
+}  // namespace rose::time
+
+#endif  // BOARD_BEE_LIBS_TIME_DURATION_H_
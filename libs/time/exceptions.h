@@ -3,6 +3,8 @@
 
 #include <exception>
 
+#include "../aliases.h"
+
 namespace rose::time {
 
 class BadDateTimeException final : public std::exception {
@@ -10,12 +12,33 @@ class BadDateTimeException final : public std::exception {
   BadDateTimeException()
       : what_("DateTime constructor given non-ISO-8601 string") {}
   explicit BadDateTimeException(const char *what) : what_(what) {}
-  explicit BadDateTimeException(const str &string) : what_(string.c_str()) {}
+  explicit BadDateTimeException(str string) : what_(std::move(string)) {}
+
+  const char *what() const noexcept override { return what_.c_str(); }
+
+ private:
+  // Owned, since messages are usually built on the fly.
+  str what_;
+};
+
+class BadTimeZoneException final : public std::exception {
+ public:
+  explicit BadTimeZoneException(str what) : what_(std::move(what)) {}
+
+  const char *what() const noexcept override { return what_.c_str(); }
+
+ private:
+  str what_;
+};
+
+class BadRecurrenceRuleException final : public std::exception {
+ public:
+  explicit BadRecurrenceRuleException(str what) : what_(std::move(what)) {}
 
-  const char *what() const noexcept override { return what_; }
+  const char *what() const noexcept override { return what_.c_str(); }
 
  private:
-  const char *what_;
+  str what_;
 };
 
 }  // namespace rose::time
@@ -0,0 +1,341 @@
+#include "recurrence_rule.h"
+
+#include <algorithm>
+#include <bit>
+#include <bitset>
+
+#include "../aliases.h"
+#include "exceptions.h"
+
+namespace rose::time {
+
+namespace {
+
+constexpr s64 kSecondsPerDay = Duration::kSecondsPerDay;
+constexpr u16 kAllMonths = 0x1FFE;
+constexpr u8 kAllWeekdays = 0x7F;
+constexpr u32 kAllMonthDays = 0x7FFFFFFF;
+
+// The calendar repeats every 400 years (146097 days, 4800 months), so a
+// rule that hasn't matched within a cycle's worth of its periods never
+// will. Returns how many chunks those periods span. Daily rules are walked
+// by month, and `interval` days a cycle apart span `interval` cycles.
+constexpr s64 CycleChunks(const Frequency frequency, const u32 interval) {
+  switch (frequency) {
+    case Frequency::kYearly: return s64{400} * interval;
+    case Frequency::kMonthly: return s64{4800} * interval;
+    case Frequency::kWeekly: return s64{146097 / 7} * interval;
+    case Frequency::kDaily: return s64{4800} * interval;
+  }
+  return 0;
+}
+
+// Chunks NextChunk skips before handing back one that may be empty anyway,
+// so it never spins on a rule that can't match.
+constexpr u32 kMaxSkips = 64;
+
+// Returns a mod b for b > 0, on [0, b).
+constexpr s64 FloorMod(const s64 a, const s64 b) {
+  return a - FloorDiv(a, b) * b;
+}
+
+constexpr u32 WeekdayOf(const s64 day) {
+  // 1970-01-01 was a Thursday.
+  return FloorMod(day + 4, 7);
+}
+
+constexpr u32 DaysIn(const s64 year, const u32 month) {
+  const bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+  return internal::kDaysInMonth[month] + (month == 2 && leap);
+}
+
+[[noreturn]] void Fail(const str &what) {
+  throw BadRecurrenceRuleException(what);
+}
+
+}  // namespace
+
+RecurrenceRule::RecurrenceRule(const DateTime start, const Frequency frequency,
+                               const u32 interval, const Filters &filters,
+                               const opt<u64> count, const opt<DateTime> until)
+    : start_(start),
+      start_day_(start.days_since_epoch()),
+      time_of_day_(start.second_of_day()),
+      frequency_(frequency),
+      interval_(interval),
+      count_(count),
+      until_(until) {
+  if (interval == 0) Fail("Interval must be at least 1");
+  for (const u8 month : filters.months) {
+    if (month < 1 || month > 12) {
+      Fail("Month " + std::to_string(month) + " is not on [1, 12]");
+    }
+    months_ |= 1 << month;
+  }
+  for (const Weekday weekday : filters.weekdays) {
+    if (static_cast<u8>(weekday) > 6) Fail("Unknown weekday");
+    weekdays_ |= 1 << static_cast<u8>(weekday);
+  }
+  for (const s8 day : filters.month_days) {
+    if (day == 0 || day < -31 || day > 31) {
+      Fail("Month day " + std::to_string(day)
+           + " is not on [-31, -1] or [1, 31]");
+    }
+    if (day > 0) {
+      month_days_ |= u32{1} << (day - 1);
+    } else {
+      last_month_days_ |= u32{1} << (-day - 1);
+    }
+  }
+  for (const s16 position : filters.set_positions) {
+    if (position == 0 || position < -366 || position > 366) {
+      Fail("Set position " + std::to_string(position)
+           + " is not on [-366, -1] or [1, 366]");
+    }
+  }
+  set_positions_ = filters.set_positions;
+
+  // Without filters, a rule keeps the start's place in each period.
+  const CivilDate date = start.date();
+  const bool weekdays_given = !filters.weekdays.empty();
+  const bool month_days_given = !filters.month_days.empty();
+  if (filters.months.empty()) {
+    months_ = frequency == Frequency::kYearly && !weekdays_given
+                      && !month_days_given
+                ? 1 << date.month
+                : kAllMonths;
+  }
+  if (!weekdays_given) {
+    weekdays_ = frequency == Frequency::kWeekly
+                  ? 1 << static_cast<u8>(start.weekday())
+                  : kAllWeekdays;
+  }
+  if (!month_days_given) {
+    const bool by_day = (frequency == Frequency::kYearly
+                         || frequency == Frequency::kMonthly)
+                      && !weekdays_given;
+    month_days_ = by_day ? u32{1} << (date.day - 1) : kAllMonthDays;
+  }
+  for (u32 first = 0; first < 7; ++first) {
+    for (u32 i = 0; i < 31; ++i) {
+      if (weekdays_ >> (first + i) % 7 & 1) {
+        weekday_days_[first] |= u32{1} << i;
+      }
+    }
+  }
+
+  switch (frequency) {
+    case Frequency::kYearly: start_chunk_ = date.year; break;
+    case Frequency::kWeekly: start_chunk_ = FloorDiv(start_day_ + 3, 7); break;
+    default: start_chunk_ = date.year * 12 + date.month - 1; break;
+  }
+
+  // Each day of a daily rule is a period of its own.
+  if (frequency == Frequency::kDaily && !set_positions_.empty()) {
+    matches_ = std::ranges::find(set_positions_, 1) != set_positions_.end()
+            || std::ranges::find(set_positions_, -1) != set_positions_.end();
+  }
+  if (matches_) {
+    matches_ = false;
+    std::array<s32, 366> days;
+    const s64 end_chunk = start_chunk_ + CycleChunks(frequency, interval);
+    s64 chunk = start_chunk_;
+    while (!matches_ && (chunk = NextChunk(chunk)) < end_chunk) {
+      const u16 size = Expand(chunk, days);
+      matches_ = size > 0 && days[size - 1] >= start_day_;
+      ++chunk;
+    }
+  }
+}
+
+u64 RecurrenceRule::Between(const DateTime from, const DateTime to,
+                            vector<DateTime> &out) const {
+  u64 count = 0;
+  for (Iterator it = From(from); it != end() && *it < to; ++it) {
+    out.push_back(*it);
+    ++count;
+  }
+  return count;
+}
+
+s64 RecurrenceRule::ChunkOf(const s64 day) const {
+  if (frequency_ == Frequency::kWeekly) return FloorDiv(day + 3, 7);
+  const CivilDate date = CivilFromDays(day);
+  if (frequency_ == Frequency::kYearly) return date.year;
+  return date.year * 12 + date.month - 1;
+}
+
+s64 RecurrenceRule::FirstDayOf(const s64 chunk) const {
+  switch (frequency_) {
+    case Frequency::kYearly: return DaysFromCivil(chunk, 1, 1);
+    case Frequency::kWeekly: return chunk * 7 - 3;
+    default: {
+      const s64 year = FloorDiv(chunk, 12);
+      return DaysFromCivil(year, chunk - year * 12 + 1, 1);
+    }
+  }
+}
+
+s64 RecurrenceRule::NextChunk(s64 chunk) const {
+  if (chunk < start_chunk_) chunk = start_chunk_;
+  if (frequency_ == Frequency::kDaily) {
+    // Straight to the month of the next day the interval allows, then on to
+    // the next month the rule keeps.
+    for (u32 i = 0; i < kMaxSkips; ++i) {
+      const s64 first = std::max(FirstDayOf(chunk), start_day_);
+      const s64 day = first + FloorMod(start_day_ - first, interval_);
+      chunk = ChunkOf(day);
+      if (months_ >> (FloorMod(chunk, 12) + 1) & 1) break;
+      ++chunk;
+    }
+    return chunk;
+  }
+  // Round up to a chunk the interval doesn't skip.
+  chunk += FloorMod(start_chunk_ - chunk, interval_);
+  if (frequency_ == Frequency::kMonthly) {
+    for (u32 i = 0; i < kMaxSkips; ++i) {
+      if (months_ >> (FloorMod(chunk, 12) + 1) & 1) break;
+      chunk += interval_;
+    }
+  } else if (frequency_ == Frequency::kWeekly && months_ != kAllMonths) {
+    for (u32 i = 0; i < kMaxSkips; ++i) {
+      const s64 first = FirstDayOf(chunk);
+      if (months_ >> CivilFromDays(first).month & 1
+          || months_ >> CivilFromDays(first + 6).month & 1) {
+        break;
+      }
+      chunk += interval_;
+    }
+  }
+  return chunk;
+}
+
+u16 RecurrenceRule::Expand(const s64 chunk, std::array<s32, 366> &days) const {
+  u16 size = 0;
+  const auto add_month = [&](const s64 year, const u32 month, u32 keep) {
+    const s64 first = DaysFromCivil(year, month, 1);
+    keep &= MonthDays(year, month, first);
+    for (; keep != 0; keep &= keep - 1) {
+      days[size++] = static_cast<s32>(first + std::countr_zero(keep));
+    }
+  };
+  switch (frequency_) {
+    case Frequency::kYearly:
+      for (u32 months = months_; months != 0; months &= months - 1) {
+        add_month(chunk, std::countr_zero(months), kAllMonthDays);
+      }
+      break;
+    case Frequency::kMonthly: {
+      const s64 year = FloorDiv(chunk, 12);
+      const u32 month = chunk - year * 12 + 1;
+      if (months_ >> month & 1) add_month(year, month, kAllMonthDays);
+      break;
+    }
+    case Frequency::kWeekly: {
+      const s64 first = FirstDayOf(chunk);
+      for (s64 day = first; day < first + 7; ++day) {
+        if (Keeps(day)) days[size++] = static_cast<s32>(day);
+      }
+      break;
+    }
+    case Frequency::kDaily: {
+      const s64 year = FloorDiv(chunk, 12);
+      const u32 month = chunk - year * 12 + 1;
+      if (!(months_ >> month & 1)) break;
+      // Only every `interval_`th day from the start.
+      const s64 first = DaysFromCivil(year, month, 1);
+      u32 allowed = 0;
+      for (s64 i = FloorMod(start_day_ - first, interval_); i < 31;
+           i += interval_) {
+        allowed |= u32{1} << i;
+      }
+      add_month(year, month, allowed);
+      return size;
+    }
+  }
+  return SelectPositions(days, size);
+}
+
+u32 RecurrenceRule::MonthDays(const s64 year, const u32 month,
+                              const s64 first_day) const {
+  const u32 length = DaysIn(year, month);
+  u32 days = month_days_;
+  for (u32 last = last_month_days_; last != 0; last &= last - 1) {
+    const u32 from_end = std::countr_zero(last) + 1;
+    if (from_end <= length) days |= u32{1} << (length - from_end);
+  }
+  return days & weekday_days_[WeekdayOf(first_day)]
+       & ((u32{1} << length) - 1);
+}
+
+bool RecurrenceRule::Keeps(const s64 day) const {
+  const CivilDate date = CivilFromDays(day);
+  if (!(months_ >> date.month & 1) || !(weekdays_ >> WeekdayOf(day) & 1)) {
+    return false;
+  }
+  const u32 length = DaysIn(date.year, date.month);
+  return (month_days_ >> (date.day - 1) & 1)
+      || (last_month_days_ >> (length - date.day) & 1);
+}
+
+u16 RecurrenceRule::SelectPositions(std::array<s32, 366> &days,
+                                    const u16 size) const {
+  if (set_positions_.empty()) return size;
+  std::bitset<366> keep;
+  for (const s16 position : set_positions_) {
+    const s32 index = position > 0 ? position - 1 : size + position;
+    if (index >= 0 && index < size) keep.set(index);
+  }
+  u16 kept = 0;
+  for (u16 i = 0; i < size; ++i) {
+    if (keep[i]) days[kept++] = days[i];
+  }
+  return kept;
+}
+
+RecurrenceRule::Iterator::Iterator(const RecurrenceRule *rule,
+                                   const DateTime from, const opt<u64> seen)
+    : rule_(rule),
+      visited_(seen.value_or(0)),
+      resumed_(seen.has_value()),
+      from_(from) {
+  done_ = !rule->matches_ || (rule->count_ && visited_ >= *rule->count_);
+  if (done_) return;
+  const s64 day = rule->count_ && !seen ? rule->start_day_
+                                        : from.days_since_epoch();
+  chunk_ = rule->NextChunk(rule->ChunkOf(day));
+  size_ = rule->Expand(chunk_, days_);
+  Advance();
+}
+
+void RecurrenceRule::Iterator::Advance() {
+  const RecurrenceRule &rule = *rule_;
+  while (true) {
+    while (next_ < size_) {
+      const DateTime occurrence = DateTime::FromSecondsSinceEpoch(
+          days_[next_++] * kSecondsPerDay + rule.time_of_day_);
+      if (occurrence < rule.start_ || (resumed_ && occurrence < from_)) {
+        continue;
+      }
+      if ((rule.until_ && occurrence > *rule.until_)
+          || (rule.count_ && visited_ == *rule.count_)) {
+        done_ = true;
+        return;
+      }
+      ++visited_;
+      if (occurrence < from_) continue;
+      current_ = occurrence;
+      return;
+    }
+    chunk_ = rule.NextChunk(chunk_ + 1);
+    if (rule.until_
+        && rule.FirstDayOf(chunk_) > rule.until_->days_since_epoch()) {
+      done_ = true;
+      return;
+    }
+    size_ = rule.Expand(chunk_, days_);
+    next_ = 0;
+  }
+}
+
+}  // namespace rose::time
@@ -0,0 +1,171 @@
+#ifndef BOARD_BEE_LIBS_TIME_RECURRENCE_RULE_H_
+#define BOARD_BEE_LIBS_TIME_RECURRENCE_RULE_H_
+
+#include <array>
+#include <iterator>
+
+#include "../aliases.h"
+#include "date_time.h"
+
+namespace rose::time {
+
+// How often a RecurrenceRule repeats, as in iCalendar's FREQ.
+enum class Frequency : u8 { kDaily, kWeekly, kMonthly, kYearly };
+
+// An iCalendar recurrence rule (RFC 5545's RRULE) over whole days, such as
+// "the fourth Thursday of every November". Occurrences happen at the start's
+// time of day on every day the rule keeps, from the start on.
+// The filters are compiled into bitmasks: a month's matching days are a few
+// ANDs of 31-bit masks, and periods that can't match (such as months the
+// rule leaves out) are skipped without being looked at, so finding the
+// occurrences in any window costs about the same however far it is from the
+// start.
+// Weeks start on Monday. Sub-daily frequencies and the BYDAY ordinals
+// ("2TU") aren't supported; set positions cover the latter.
+class RecurrenceRule {
+ public:
+  // Which days of each period are kept, as in BYMONTH, BYDAY, BYMONTHDAY
+  // and BYSETPOS. An empty filter keeps everything, except that a rule with
+  // no months, weekdays or month days keeps the start's day of the week
+  // (weekly), month (monthly) or year (yearly), as iCalendar does.
+  struct Filters {
+    // 1 to 12.
+    vector<u8> months;
+    vector<Weekday> weekdays;
+    // 1 to 31, or -1 (the last day of the month) to -31.
+    vector<s8> month_days;
+    // Positions within each period's matching days, applied after every
+    // other filter: 1 to 366, or -1 (the last) to -366.
+    vector<s16> set_positions;
+  };
+
+  // Walks the occurrences of a rule in order, working out one period at a
+  // time. The rule must outlive it.
+  class Iterator {
+   public:
+    using value_type = DateTime;
+    using difference_type = s64;
+
+    Iterator() = default;
+
+    DateTime operator*() const { return current_; }
+    Iterator &operator++() {
+      Advance();
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old = *this;
+      Advance();
+      return old;
+    }
+    bool operator==(std::default_sentinel_t) const { return done_; }
+
+   private:
+    friend class RecurrenceRule;
+
+    // Starts at the first occurrence at or after `from`. Without `seen`,
+    // counted rules are walked from the start to count what came before.
+    Iterator(const RecurrenceRule *rule, DateTime from,
+             opt<u64> seen = std::nullopt);
+
+    // Moves to the next occurrence, or past the end.
+    void Advance();
+
+    const RecurrenceRule *rule_ = nullptr;
+    // The period (see RecurrenceRule::Expand) in `days_`.
+    s64 chunk_ = 0;
+    // Its matching days, as days since the epoch, and how many are left.
+    std::array<s32, 366> days_;
+    u16 size_ = 0;
+    u16 next_ = 0;
+    // Occurrences visited so far, counting from the start.
+    u64 visited_ = 0;
+    // Whether `visited_` already counts the occurrences before `from_`.
+    bool resumed_ = false;
+    DateTime from_;
+    DateTime current_;
+    bool done_ = true;
+  };
+
+  // Repeats every `interval` periods from `start`. With `count`, stops after
+  // that many occurrences; with `until`, stops after that instant.
+  // Throws BadRecurrenceRuleException if a filter is out of range or
+  // `interval` is 0.
+  RecurrenceRule(DateTime start, Frequency frequency, u32 interval = 1,
+                 const Filters &filters = {}, opt<u64> count = std::nullopt,
+                 opt<DateTime> until = std::nullopt);
+
+  DateTime start() const { return start_; }
+  Frequency frequency() const { return frequency_; }
+  u32 interval() const { return interval_; }
+  opt<u64> count() const { return count_; }
+  opt<DateTime> until() const { return until_; }
+
+  Iterator begin() const { return Iterator(this, start_); }
+  std::default_sentinel_t end() const { return {}; }
+  // Returns an Iterator at the first occurrence at or after `from`. Without
+  // a count, that's found without visiting any earlier periods.
+  Iterator From(DateTime from) const { return Iterator(this, from); }
+  // Same as From(from), for picking a walk back up where it stopped: `seen`
+  // occurrences come before `from`, so a counted rule isn't walked from the
+  // start again.
+  Iterator Resume(DateTime from, u64 seen) const {
+    return Iterator(this, from, seen);
+  }
+
+  // Appends the occurrences in [from, to) to `out`, in order, and returns
+  // how many there were.
+  u64 Between(DateTime from, DateTime to, vector<DateTime> &out) const;
+
+ private:
+  // Chunks are how the rule is walked: years, months or weeks (numbered
+  // from the epoch's) for yearly, monthly and weekly rules, whose set
+  // positions apply within them, and months for daily rules.
+
+  // Returns the chunk `day` falls in.
+  s64 ChunkOf(s64 day) const;
+  // Returns the first chunk at or after `chunk` that the interval doesn't
+  // skip and that could have matching days.
+  s64 NextChunk(s64 chunk) const;
+  // Returns the first day of `chunk`.
+  s64 FirstDayOf(s64 chunk) const;
+  // Writes the days of `chunk` the rule keeps to `days`, in order, and
+  // returns how many there are.
+  u16 Expand(s64 chunk, std::array<s32, 366> &days) const;
+  // Returns the days of the month starting on `first_day` the rule keeps,
+  // as bit (day - 1) of a mask.
+  u32 MonthDays(s64 year, u32 month, s64 first_day) const;
+  // Returns true if the rule keeps `day`, ignoring set positions.
+  bool Keeps(s64 day) const;
+  // Keeps only the days of one period at the set positions.
+  u16 SelectPositions(std::array<s32, 366> &days, u16 size) const;
+
+  DateTime start_;
+  s64 start_day_;
+  u32 time_of_day_;
+  Frequency frequency_;
+  u32 interval_;
+  opt<u64> count_;
+  opt<DateTime> until_;
+  // The start's chunk; the chunks with occurrences are every
+  // `interval_`th one from it (or for daily rules, those holding every
+  // `interval_`th day).
+  s64 start_chunk_;
+  // Bit m for month m.
+  u16 months_ = 0;
+  // Bit w for Weekday w.
+  u8 weekdays_ = 0;
+  // Bit (d - 1) for day d, and bit (d - 1) for day -d.
+  u32 month_days_ = 0;
+  u32 last_month_days_ = 0;
+  // Days a month starting on Weekday w has on one of `weekdays_`, as bit
+  // (day - 1) of entry w.
+  std::array<u32, 7> weekday_days_{};
+  vector<s16> set_positions_;
+  // False if no day could ever match.
+  bool matches_ = true;
+};
+
+}  // namespace rose::time
+
+#endif  // BOARD_BEE_LIBS_TIME_RECURRENCE_RULE_H_
@@ -0,0 +1,472 @@
+#include "time_zone.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "../aliases.h"
+#include "exceptions.h"
+
+namespace rose::time {
+
+namespace {
+
+constexpr s64 kSecondsPerDay = Duration::kSecondsPerDay;
+
+// Reads the big-endian fields of a TZif file, throwing if it runs out.
+class TzifReader {
+ public:
+  TzifReader(const str_view name, const str_view data)
+      : name_(name), data_(data) {}
+
+  str_view Bytes(const u64 n) {
+    if (data_.size() - position_ < n) Fail("File is truncated");
+    const str_view bytes = data_.substr(position_, n);
+    position_ += n;
+    return bytes;
+  }
+  void Skip(const u64 n) { Bytes(n); }
+  u8 U8() { return Bytes(1)[0]; }
+  u32 U32() { return Read(4); }
+  s64 S64() { return static_cast<s64>(Read(8)); }
+  // Returns everything not read yet.
+  str_view Rest() const { return data_.substr(position_); }
+
+  [[noreturn]] void Fail(const char *what) const {
+    throw BadTimeZoneException(str(name_) + ": " + what);
+  }
+
+ private:
+  u64 Read(const u64 n) {
+    u64 value = 0;
+    for (const char byte : Bytes(n)) value = value << 8 | static_cast<u8>(byte);
+    return value;
+  }
+
+  str_view name_;
+  str_view data_;
+  u64 position_ = 0;
+};
+
+// The counts at the start of each TZif data block, in file order.
+struct TzifCounts {
+  u32 is_ut;
+  u32 is_std;
+  u32 leap;
+  u32 time;
+  u32 type;
+  u32 chars;
+
+  // Returns the size of the data block these counts describe.
+  u64 DataBytes(const u64 time_bytes) const {
+    return time * time_bytes + time + type * 6 + chars
+         + leap * (time_bytes + 4) + is_std + is_ut;
+  }
+};
+
+// Reads the header at the start of a TZif data block. Returns its version.
+u8 ReadHeader(TzifReader &reader, TzifCounts &counts) {
+  if (reader.Bytes(4) != "TZif") reader.Fail("Not a TZif file");
+  const u8 version = reader.U8();
+  reader.Skip(15);
+  counts = {reader.U32(), reader.U32(), reader.U32(),
+            reader.U32(), reader.U32(), reader.U32()};
+  return version;
+}
+
+opt<str> ReadFile(const str &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return std::nullopt;
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return std::move(contents).str();
+}
+
+// Returns "UTC" followed by `offset_seconds` as +HH:MM (or +HH:MM:SS).
+str OffsetName(const s32 offset_seconds) {
+  if (offset_seconds == 0) return "UTC";
+  const u32 magnitude = std::abs(offset_seconds);
+  const auto two_digits = [](const u32 n) {
+    return str{static_cast<char>('0' + n / 10),
+               static_cast<char>('0' + n % 10)};
+  };
+  str name = offset_seconds < 0 ? "UTC-" : "UTC+";
+  name += two_digits(magnitude / 3600) + ':' + two_digits(magnitude / 60 % 60);
+  if (magnitude % 60 != 0) name += ':' + two_digits(magnitude % 60);
+  return name;
+}
+
+}  // namespace
+
+// Parses POSIX TZ rules, as described for the TZ environment variable and
+// used in the footer of TZif files.
+class TimeZone::PosixParser {
+ public:
+  explicit PosixParser(const str_view text) : text_(text) {}
+
+  Rule Parse() {
+    Rule rule;
+    ReadName();
+    // POSIX offsets count hours west of UTC.
+    rule.std_offset = -ReadTime(24);
+    if (AtEnd()) return rule;
+    ReadName();
+    rule.dst_offset = rule.std_offset + 3600;
+    if (!AtEnd() && Peek() != ',') rule.dst_offset = -ReadTime(24);
+    if (AtEnd()) {
+      // The US rules, which POSIX leaves to the implementation.
+      rule.start = {RuleDay::Kind::kMonthWeekDay, 0, 3, 2};
+      rule.end = {RuleDay::Kind::kMonthWeekDay, 0, 11, 1};
+      return rule;
+    }
+    Expect(',');
+    rule.start = ReadDay();
+    Expect(',');
+    rule.end = ReadDay();
+    if (!AtEnd()) Fail();
+    return rule;
+  }
+
+ private:
+  bool AtEnd() const { return position_ == text_.size(); }
+  char Peek() const { return AtEnd() ? '\0' : text_[position_]; }
+  bool IsDigit() const { return Peek() >= '0' && Peek() <= '9'; }
+
+  void Expect(const char c) {
+    if (Peek() != c) Fail();
+    ++position_;
+  }
+
+  [[noreturn]] void Fail() const {
+    throw BadTimeZoneException("Malformed POSIX TZ rule \"" + str(text_)
+                               + '"');
+  }
+
+  // Skips a zone abbreviation: <...>, or at least three letters.
+  void ReadName() {
+    if (Peek() == '<') {
+      const u64 end = text_.find('>', position_);
+      if (end == str_view::npos) Fail();
+      position_ = end + 1;
+      return;
+    }
+    const u64 start = position_;
+    while (std::isalpha(static_cast<u8>(Peek()))) ++position_;
+    if (position_ - start < 3) Fail();
+  }
+
+  u32 ReadNumber(const u32 max) {
+    if (!IsDigit()) Fail();
+    u32 n = 0;
+    while (IsDigit()) {
+      n = n * 10 + (text_[position_++] - '0');
+      if (n > max) Fail();
+    }
+    return n;
+  }
+
+  // Reads [+-]h[:mm[:ss]] as seconds, with hours up to `max_hours`.
+  s32 ReadTime(const u32 max_hours) {
+    s32 sign = 1;
+    if (Peek() == '+' || Peek() == '-') {
+      if (Peek() == '-') sign = -1;
+      ++position_;
+    }
+    s32 seconds = ReadNumber(max_hours) * 3600;
+    if (Peek() == ':') {
+      ++position_;
+      seconds += ReadNumber(59) * 60;
+      if (Peek() == ':') {
+        ++position_;
+        seconds += ReadNumber(59);
+      }
+    }
+    return sign * seconds;
+  }
+
+  RuleDay ReadDay() {
+    RuleDay day;
+    if (Peek() == 'J') {
+      ++position_;
+      day.kind = RuleDay::Kind::kJulian;
+      day.day = ReadNumber(365);
+      if (day.day == 0) Fail();
+    } else if (Peek() == 'M') {
+      ++position_;
+      day.kind = RuleDay::Kind::kMonthWeekDay;
+      day.month = ReadNumber(12);
+      Expect('.');
+      day.week = ReadNumber(5);
+      Expect('.');
+      day.day = ReadNumber(6);
+      if (day.month == 0 || day.week == 0) Fail();
+    } else {
+      day.kind = RuleDay::Kind::kDayOfYear;
+      day.day = ReadNumber(365);
+    }
+    if (Peek() == '/') {
+      ++position_;
+      // Version 3 TZif files allow -167 to 167 hours.
+      day.time = ReadTime(167);
+    }
+    return day;
+  }
+
+  str_view text_;
+  u64 position_ = 0;
+};
+
+TimeZone::TimeZone(const s32 offset_seconds)
+    : name_(OffsetName(offset_seconds)), initial_offset_(offset_seconds) {}
+
+TimeZone TimeZone::Load(const str_view name) {
+  // Names are relative to the database, and mustn't leave it.
+  const std::filesystem::path relative(name);
+  if (name.empty() || relative.is_absolute()
+      || std::ranges::find(relative, std::filesystem::path(".."))
+             != relative.end()) {
+    throw BadTimeZoneException("Invalid time zone name \"" + str(name) + '"');
+  }
+  const char *directory = std::getenv("TZDIR");
+  const std::filesystem::path path =
+      std::filesystem::path(directory && *directory ? directory
+                                                    : "/usr/share/zoneinfo")
+      / relative;
+  const opt<str> data = ReadFile(path.string());
+  if (!data) {
+    throw BadTimeZoneException("Unknown time zone \"" + str(name) + '"');
+  }
+  return FromTzif(name, *data);
+}
+
+TimeZone TimeZone::System() {
+  const char *tz = std::getenv("TZ");
+  if (tz && *tz) {
+    str_view value = tz;
+    if (value.front() == ':') value.remove_prefix(1);
+    if (value.starts_with('/')) {
+      const opt<str> data = ReadFile(str(value));
+      if (!data) {
+        throw BadTimeZoneException("Can't read time zone file \""
+                                   + str(value) + '"');
+      }
+      return FromTzif(value, *data);
+    }
+    // TZ holds either a zone name or a POSIX rule, and can't be both.
+    try {
+      return Load(value);
+    } catch (const BadTimeZoneException &) {
+      return FromPosix(value);
+    }
+  }
+  constexpr const char *kLocalTime = "/etc/localtime";
+  const opt<str> data = ReadFile(kLocalTime);
+  if (!data) return Utc();
+  // /etc/localtime is usually a link into the database, which names it.
+  str name = "localtime";
+  std::error_code error;
+  const str target = std::filesystem::read_symlink(kLocalTime, error).string();
+  const u64 start = target.find("zoneinfo/");
+  if (!error && start != str::npos) name = target.substr(start + 9);
+  return FromTzif(name, *data);
+}
+
+TimeZone TimeZone::FromTzif(const str_view name, const str_view data) {
+  TzifReader reader(name, data);
+  TzifCounts counts{};
+  const u8 version = ReadHeader(reader, counts);
+  u64 time_bytes = 4;
+  if (version >= '2') {
+    // Version 2+ files repeat everything with 64-bit times after the
+    // version 1 block, then add a POSIX rule for later years.
+    reader.Skip(counts.DataBytes(4));
+    ReadHeader(reader, counts);
+    time_bytes = 8;
+  }
+  if (counts.leap != 0) {
+    reader.Fail("Zones that count leap seconds aren't supported");
+  }
+  if (counts.type == 0) reader.Fail("No local time types");
+
+  vector<s64> times(counts.time);
+  for (s64 &time : times) {
+    time = time_bytes == 8 ? reader.S64() : static_cast<s32>(reader.U32());
+  }
+  vector<u8> type_indices(counts.time);
+  for (u8 &index : type_indices) {
+    index = reader.U8();
+    if (index >= counts.type) reader.Fail("Bad local time type index");
+  }
+  vector<s32> type_offsets(counts.type);
+  for (s32 &offset : type_offsets) {
+    offset = static_cast<s32>(reader.U32());
+    // Skip the DST flag and abbreviation index, which don't affect offsets.
+    reader.Skip(2);
+  }
+  reader.Skip(counts.chars + counts.is_std + counts.is_ut);
+
+  TimeZone zone(type_offsets[0]);
+  zone.name_ = name;
+  for (u64 i = 0; i < times.size(); ++i) {
+    if (i > 0 && times[i] <= times[i - 1]) {
+      reader.Fail("Transition times aren't ascending");
+    }
+    zone.AddChange(times[i], type_offsets[type_indices[i]]);
+  }
+  if (version >= '2') {
+    const str_view footer = reader.Rest();
+    if (footer.size() < 2 || footer.front() != '\n') {
+      reader.Fail("Missing POSIX TZ footer");
+    }
+    const u64 end = footer.find('\n', 1);
+    if (end == str_view::npos) reader.Fail("Unterminated POSIX TZ footer");
+    if (end > 1) {
+      zone.rule_ = PosixParser(footer.substr(1, end - 1)).Parse();
+      zone.PrecomputeRule(times.empty() ? std::numeric_limits<s64>::min()
+                                        : times.back());
+    }
+  }
+  return zone;
+}
+
+TimeZone TimeZone::FromPosix(const str_view rule) {
+  TimeZone zone;
+  zone.name_ = rule;
+  zone.rule_ = PosixParser(rule).Parse();
+  zone.initial_offset_ = zone.rule_->std_offset;
+  zone.PrecomputeRule(std::numeric_limits<s64>::min());
+  return zone;
+}
+
+s32 TimeZone::OffsetAt(const DateTime utc) const {
+  if (changes_.empty()) return initial_offset_;
+  const s64 seconds = utc.seconds_since_epoch();
+  if (seconds < table_begin_ || seconds >= table_end_) {
+    return rule_->OffsetAt(seconds);
+  }
+
+  // Each entry is the interval between two changes in one zone.
+  struct CacheEntry {
+    u64 zone_id = 0;
+    s64 begin = 0;
+    s64 end = 0;
+    s32 offset = 0;
+  };
+  thread_local std::array<CacheEntry, kCacheSize> cache{};
+  thread_local size_t next_victim = 0;
+  for (const CacheEntry &entry : cache) {
+    if (entry.zone_id == id_ && entry.begin <= seconds
+        && seconds < entry.end) {
+      return entry.offset;
+    }
+  }
+  const u64 i =
+      std::ranges::upper_bound(changes_, seconds) - changes_.begin();
+  const s32 offset = i == 0 ? initial_offset_ : offsets_[i - 1];
+  cache[next_victim] = {
+      id_, i == 0 ? table_begin_ : changes_[i - 1],
+      i == changes_.size() ? table_end_ : changes_[i], offset};
+  next_victim = (next_victim + 1) % kCacheSize;
+  return offset;
+}
+
+DateTime TimeZone::FromLocal(const DateTime local) const {
+  // Assumes changes are more than two days apart, so at most one lies
+  // within a day of `local`.
+  const Duration day = Duration::Days(1);
+  const s32 before = OffsetAt(local - day);
+  const s32 after = OffsetAt(local + day);
+  const DateTime utc_before = local - Duration::Seconds(before);
+  if (before == after || OffsetAt(utc_before) == before) return utc_before;
+  const DateTime utc_after = local - Duration::Seconds(after);
+  if (OffsetAt(utc_after) == after) return utc_after;
+  // Skipped by a change forward.
+  return utc_before;
+}
+
+s64 TimeZone::RuleDay::DaysSinceEpoch(const s64 year) const {
+  const s64 january_1st = DaysFromCivil(year, 1, 1);
+  switch (kind) {
+    case Kind::kJulian:
+      return january_1st + day - 1
+           + (day >= 60 && DateTime::IsLeapYear(static_cast<u16>(year)));
+    case Kind::kDayOfYear:
+      return january_1st + day;
+    case Kind::kMonthWeekDay: {
+      const s64 first = DaysFromCivil(year, month, 1);
+      const s64 first_weekday = first + 4 - FloorDiv(first + 4, 7) * 7;
+      s64 day_of_month = 1 + (day - first_weekday + 7) % 7 + (week - 1) * 7;
+      if (day_of_month > DateTime::DaysInMonth(year, month)) {
+        day_of_month -= 7;
+      }
+      return first + day_of_month - 1;
+    }
+  }
+  return january_1st;
+}
+
+std::pair<s64, s64> TimeZone::Rule::Changes(const s64 year) const {
+  // Each change happens at a local time given in the offset it ends.
+  return {start.DaysSinceEpoch(year) * kSecondsPerDay + start.time
+              - std_offset,
+          end.DaysSinceEpoch(year) * kSecondsPerDay + end.time
+              - *dst_offset};
+}
+
+s32 TimeZone::Rule::OffsetAt(const s64 utc_seconds) const {
+  if (!dst_offset) return std_offset;
+  const s64 year = CivilFromDays(FloorDiv(utc_seconds, kSecondsPerDay)).year;
+  const auto [start, end] = Changes(year);
+  // Southern zones end daylight saving time before they start it.
+  const bool in_dst = start < end
+                    ? start <= utc_seconds && utc_seconds < end
+                    : !(end <= utc_seconds && utc_seconds < start);
+  return in_dst ? *dst_offset : std_offset;
+}
+
+void TimeZone::PrecomputeRule(const s64 from_seconds) {
+  const Rule &rule = *rule_;
+  // The last offset in the table already lasts forever.
+  if (!rule.dst_offset) return;
+  s64 from = from_seconds;
+  if (from_seconds == std::numeric_limits<s64>::min()) {
+    // Zones without a history start their table at the epoch and follow the
+    // rule before it, which matters for southern zones whose daylight
+    // saving time spans New Year.
+    from = 0;
+    table_begin_ = 0;
+    initial_offset_ = rule.OffsetAt(0);
+  }
+  const s64 first_year = CivilFromDays(FloorDiv(from, kSecondsPerDay)).year;
+  for (s64 year = first_year; year <= kPrecomputedUntilYear; ++year) {
+    const auto [start, end] = rule.Changes(year);
+    const std::pair<s64, s32> changes[2] = {
+        std::min(std::pair(start, *rule.dst_offset),
+                 std::pair(end, rule.std_offset)),
+        std::max(std::pair(start, *rule.dst_offset),
+                 std::pair(end, rule.std_offset))};
+    for (const auto &[seconds, offset] : changes) {
+      if (seconds > from) AddChange(seconds, offset);
+    }
+  }
+  table_end_ = DaysFromCivil(kPrecomputedUntilYear + 1, 1, 1) * kSecondsPerDay;
+}
+
+void TimeZone::AddChange(const s64 utc_seconds, const s32 offset) {
+  const s32 current = offsets_.empty() ? initial_offset_ : offsets_.back();
+  if (offset == current) return;
+  changes_.push_back(utc_seconds);
+  offsets_.push_back(offset);
+}
+
+u64 TimeZone::NextId() {
+  static std::atomic<u64> next_id = 1;
+  return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace rose::time
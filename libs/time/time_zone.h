@@ -0,0 +1,133 @@
+#ifndef BOARD_BEE_LIBS_TIME_TIME_ZONE_H_
+#define BOARD_BEE_LIBS_TIME_TIME_ZONE_H_
+
+#include <limits>
+#include <utility>
+
+#include "../aliases.h"
+#include "date_time.h"
+
+namespace rose::time {
+
+// The offsets from UTC used in one place over time, such as Europe/Berlin.
+// Every change of offset up to the end of kPrecomputedUntilYear (including
+// those that only follow from the zone's rule for future years) is kept in
+// one sorted table, so converting between UTC and local time is a binary
+// search. Zones given only as a rule start the table at 1970 and evaluate
+// the rule directly before then. The last few intervals found are also
+// cached per thread, so nearby lookups (like the cells of a calendar) skip
+// even that.
+class TimeZone {
+ public:
+  // Last year whose rule-based changes are put in the table. Later instants
+  // evaluate the rule directly.
+  static constexpr s64 kPrecomputedUntilYear = 2100;
+  // Number of intervals each thread remembers, across all zones.
+  static constexpr size_t kCacheSize = 8;
+
+  // A zone that's always `offset_seconds` ahead of UTC.
+  explicit TimeZone(s32 offset_seconds = 0);
+
+  static TimeZone Utc() { return TimeZone(0); }
+  // Loads the zone named `name`, such as "Europe/Berlin", from the system's
+  // time zone database ($TZDIR, or /usr/share/zoneinfo).
+  // Throws BadTimeZoneException if it can't be found or read.
+  static TimeZone Load(str_view name);
+  // Returns the zone this machine is set to: the one named by $TZ if it's
+  // set, otherwise /etc/localtime, otherwise UTC.
+  static TimeZone System();
+  // Parses the contents of a TZif file (RFC 8536) describing zone `name`.
+  // Throws BadTimeZoneException if `data` is malformed.
+  static TimeZone FromTzif(str_view name, str_view data);
+  // Parses a POSIX TZ rule such as "CET-1CEST,M3.5.0,M10.5.0/3".
+  // Throws BadTimeZoneException if `rule` is malformed.
+  static TimeZone FromPosix(str_view rule);
+
+  const str &name() const { return name_; }
+
+  // Returns how many seconds this zone is ahead of UTC at `utc`.
+  s32 OffsetAt(DateTime utc) const;
+  // Returns the time clocks in this zone show at `utc`, as a DateTime whose
+  // fields (and formatted strings) read as that local time.
+  DateTime ToLocal(const DateTime utc) const {
+    return utc + Duration::Seconds(OffsetAt(utc));
+  }
+  // Returns the instant at which clocks in this zone show `local`, the
+  // inverse of ToLocal. Times shown twice when clocks go back resolve to the
+  // earlier instant. Times skipped when clocks go forward are read with the
+  // offset from before the change, landing after it.
+  // Assumes the offset changes at most once in any two days, as it does in
+  // every zone in the tz database; closer changes may be resolved wrongly.
+  DateTime FromLocal(DateTime local) const;
+
+ private:
+  // A day of the year in a POSIX TZ rule, and the local time on it.
+  struct RuleDay {
+    enum class Kind : u8 {
+      // Jn: 1 to 365, never counting February 29th.
+      kJulian,
+      // n: 0 to 365, counting February 29th.
+      kDayOfYear,
+      // Mm.w.d: weekday d of week w (5 meaning the last) of month m.
+      kMonthWeekDay
+    };
+
+    // Returns the day this names in `year`, as days since the epoch.
+    s64 DaysSinceEpoch(s64 year) const;
+
+    Kind kind = Kind::kMonthWeekDay;
+    u16 day = 0;
+    u8 month = 0;
+    u8 week = 0;
+    // Seconds after local midnight; may be negative or past 24 hours.
+    s32 time = 2 * 3600;
+  };
+
+  // The trailing POSIX TZ rule of a zone, which describes every year after
+  // its last explicit change.
+  struct Rule {
+    // Returns the UTC instants daylight saving time starts and ends in
+    // `year`.
+    std::pair<s64, s64> Changes(s64 year) const;
+    s32 OffsetAt(s64 utc_seconds) const;
+
+    s32 std_offset = 0;
+    // Unset if the zone doesn't observe daylight saving time.
+    opt<s32> dst_offset;
+    RuleDay start;
+    RuleDay end;
+  };
+
+  class PosixParser;
+
+  // Returns an id that no zone (or earlier version of one) has used.
+  static u64 NextId();
+
+  // Adds the changes `rule_` makes after `from_seconds`, the last change in
+  // the zone's history (or the lowest s64 if it has none), through
+  // kPrecomputedUntilYear.
+  void PrecomputeRule(s64 from_seconds);
+  // Appends a change to `offset` at `utc_seconds`, unless it changes
+  // nothing.
+  void AddChange(s64 utc_seconds, s32 offset);
+
+  // Identifies this zone's table in each thread's lookup cache.
+  u64 id_ = NextId();
+  str name_;
+  // Offset before the first change.
+  s32 initial_offset_ = 0;
+  // UTC seconds at which the offset changed, ascending, and the offset from
+  // each change on. Kept apart so the search only touches the instants.
+  vector<s64> changes_;
+  vector<s32> offsets_;
+  // Instants before here predate the table and use `rule_`. Only zones
+  // that are nothing but a rule have one, since a history covers the rest.
+  s64 table_begin_ = std::numeric_limits<s64>::min();
+  // Instants from here on are past the table and use `rule_`.
+  s64 table_end_ = std::numeric_limits<s64>::max();
+  opt<Rule> rule_;
+};
+
+}  // namespace rose::time
+
+#endif  // BOARD_BEE_LIBS_TIME_TIME_ZONE_H_
@@ -0,0 +1,57 @@
+#include "arena_report.h"
+
+#include <aliases.h>
+#include <arena_allocator.h>
+#include <json.h>
+
+namespace bee {
+
+using namespace rose::json;
+
+namespace {
+
+Node *MakeCount(const u64 n, rose::ArenaAllocator &arena) {
+  return arena.Create<Node>(static_cast<s64>(n));
+}
+
+Node *PhaseStatsToJson(const rose::ArenaPhaseStats &stats,
+                       rose::ArenaAllocator &arena) {
+  auto *histogram = arena.CreateUnmanaged<Array>(arena.resource());
+  for (const u64 count : stats.size_histogram) {
+    histogram->push_back(MakeCount(count, arena));
+  }
+  auto *object = arena.CreateUnmanaged<Object>(
+      Object::allocator_type(arena.resource()));
+  object->emplace("allocations", MakeCount(stats.allocations, arena));
+  object->emplace("bytes_requested", MakeCount(stats.bytes_requested, arena));
+  object->emplace("padding_bytes", MakeCount(stats.padding_bytes, arena));
+  object->emplace("chunk_tail_bytes",
+                  MakeCount(stats.chunk_tail_bytes, arena));
+  // Entry i counts allocations of (2^(i-1), 2^i] bytes; see ArenaPhaseStats.
+  object->emplace("size_histogram", arena.Create<Node>(histogram));
+  return arena.Create<Node>(object);
+}
+
+}  // namespace
+
+Node *ArenaStatsToJson(const rose::ArenaStats &stats,
+                       rose::ArenaAllocator &arena) {
+  auto *phases = arena.CreateUnmanaged<Object>(
+      Object::allocator_type(arena.resource()));
+  for (size_t i = 0; i < rose::kArenaPhaseCount; ++i) {
+    const auto phase = static_cast<rose::ArenaPhase>(i);
+    const rose::ArenaPhaseStats &phase_stats = stats.phase(phase);
+    if (phase_stats.allocations == 0) continue;
+    phases->emplace(rose::ArenaPhaseName(phase),
+                    PhaseStatsToJson(phase_stats, arena));
+  }
+  auto *object = arena.CreateUnmanaged<Object>(
+      Object::allocator_type(arena.resource()));
+  object->emplace("bytes_committed", MakeCount(stats.bytes_committed, arena));
+  object->emplace("high_water_mark", MakeCount(stats.high_water_mark, arena));
+  object->emplace("total", PhaseStatsToJson(stats.Total(), arena));
+  object->emplace("phases", arena.Create<Node>(phases));
+  return arena.Create<Node>(object);
+}
+
+}  // namespace bee
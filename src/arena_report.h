@@ -0,0 +1,18 @@
+#ifndef BOARD_BEE_SRC_ARENA_REPORT_H_
+#define BOARD_BEE_SRC_ARENA_REPORT_H_
+
+#include <aliases.h>
+#include <arena_allocator.h>
+#include <json.h>
+
+namespace bee {
+
+// Converts `stats` to a JSON Object Node suitable for writing with
+// rose::json::Writer. Every Node (and container) is allocated in `arena`,
+// which must outlive the result and should not be the arena being measured.
+rose::json::Node *ArenaStatsToJson(const rose::ArenaStats &stats,
+                                   rose::ArenaAllocator &arena);
+
+}  // namespace bee
+
+#endif  // BOARD_BEE_SRC_ARENA_REPORT_H_
@@ -3,38 +3,83 @@
 #include <arena_allocator.h>
 #include <json.h>
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
+#include "arena_report.h"
+#include "structures/board.h"
+#include "structures/exceptions.h"
+
 using namespace rose::json;
 
+// Plain heap buffers: at this size, huge pages and prefaulting would cost
+// more than the page faults they save.
 static constexpr size_t kArenaSizeBytes = 1000 * 1000;  // 1 MB
+// Only used to build the (small) arena stats report.
+static constexpr size_t kReportArenaSizeBytes = 64 * 1000;  // 64 KB
 
 int main(const s32 argc, const char *argv[]) {
   if (argc < 2) {
     std::cerr << "Missing JSON input and output file paths\n";
     return EXIT_FAILURE;
   }
-  if (argc != 3) {
+  if (argc < 3) {
     std::cerr << "Missing JSON output file path\n";
     return EXIT_FAILURE;
   }
+  const char *arena_stats_path = nullptr;
+  if (argc == 5 && strcmp(argv[3], "--arena-stats") == 0) {
+    arena_stats_path = argv[4];
+  } else if (argc != 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <input.json> <output.json> [--arena-stats <stats.json>]\n";
+    return EXIT_FAILURE;
+  }
 
-  auto string_allocator = mk_sptr<rose::ArenaAllocator>(kArenaSizeBytes);
+  rose::ArenaAllocator string_allocator(kArenaSizeBytes);
+  string_allocator.set_phase(rose::ArenaPhase::kTokenize);
   vector<Token> tokens;
   {
     std::ifstream fin(argv[1]);
     Tokenizer tokenizer(fin, string_allocator);
     tokens = tokenizer.Tokenize();
   }
-  auto node_allocator = mk_sptr<rose::ArenaAllocator>(kArenaSizeBytes);
+  rose::ArenaAllocator node_allocator(kArenaSizeBytes);
+  node_allocator.set_phase(rose::ArenaPhase::kParse);
   Parser parser(std::move(tokens), node_allocator);
   parser.Parse();
+  // Reading the Board checks the document, and its allocations show up in
+  // the stats as the domain build.
+  node_allocator.set_phase(rose::ArenaPhase::kDomainBuild);
+  try {
+    const bee::Board board =
+        bee::Board::FromJson(*parser.root(), node_allocator.resource());
+  } catch (const bee::BadStructureException &e) {
+    std::cerr << "Invalid board: " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
   {
     std::ofstream fout(argv[2]);
     Writer writer(fout);
     writer.Write(parser.root());
   }
 
+  if (arena_stats_path) {
+    rose::ArenaAllocator report_allocator(kReportArenaSizeBytes);
+    auto *arenas = report_allocator.CreateUnmanaged<Object>(
+        Object::allocator_type(report_allocator.resource()));
+    arenas->emplace("string_arena",
+                    bee::ArenaStatsToJson(string_allocator.stats(),
+                                          report_allocator));
+    arenas->emplace("node_arena",
+                    bee::ArenaStatsToJson(node_allocator.stats(),
+                                          report_allocator));
+    std::ofstream fout(arena_stats_path);
+    Writer writer(fout);
+    writer.Write(report_allocator.Create<Node>(arenas));
+    fout << '\n';
+  }
+
   return EXIT_SUCCESS;
 }
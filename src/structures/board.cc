@@ -1,104 +1,427 @@
 #include "board.h"
 
 #include <json.h>
+#include <schema/v0_0/readers.h>
+#include <schema/v0_0/validators.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
 
 #include "event.h"
+#include "event_generator.h"
+#include "flags.h"
+#include "json_reader.h"
+#include "label_table.h"
 #include "task.h"
+#include "task_generator.h"
 
 namespace bee {
 
 using namespace rose::json;
+using rose::time::DateTime;
 
-bool Board::MatchesStructure(const Node &node) {
-  return structure()->Matches(node);
+namespace {
+
+// The labels and flags a Board's metadata (already known to match the
+// schema) defines. The schema can't say which ones those are, so Tasks'
+// references to them are checked against these separately.
+struct Vocabulary {
+  explicit Vocabulary(const Node &metadata_node) {
+    const Object &metadata = *metadata_node.as_object().value();
+    if (const Node *labels_node = Find(metadata, "labels")) {
+      for (const auto &[key, value] : *labels_node->as_object().value()) {
+        labels.Intern(key, static_cast<s32>(value->as_s64().value()));
+      }
+    }
+    // The schema allows at most FlagTable::kMaxFlags, so all of them fit.
+    for (const Node *flag : *Find(metadata, "flags")->as_array().value()) {
+      flags.Intern(flag->as_string().value());
+    }
+  }
+
+  LabelTable labels;
+  FlagTable flags;
+};
+
+// Returns true if `generator`, an element of "task_generators" (already
+// known to match the schema), is a note or has a template that only refers
+// to labels and flags `vocabulary` defines.
+bool HasValidTemplateReferences(const Node &generator,
+                                const Vocabulary &vocabulary) {
+  if (generator.is_string()) return true;
+  return Task::HasValidReferences(
+      *Find(*generator.as_object().value(), "template"), vocabulary.labels,
+      vocabulary.flags);
+}
+
+// Returns the index of the first element of "task_generators" in `board`
+// that fails HasValidTemplateReferences, if any does.
+opt<u64> FirstBadTemplate(const Object &board, const Vocabulary &vocabulary) {
+  const Array &generators =
+      *Find(board, "task_generators")->as_array().value();
+  for (u64 i = 0; i < generators.size(); ++i) {
+    if (!HasValidTemplateReferences(*generators[i], vocabulary)) return i;
+  }
+  return std::nullopt;
+}
+
+// Returns the "__metadata__" of `node` if it's an object with metadata that
+// matches the schema, or nullptr otherwise.
+const Node *ValidMetadata(const Node &node) {
+  if (!node.is_object()) return nullptr;
+  const Node *metadata = Find(*node.as_object().value(), "__metadata__");
+  if (!metadata || !schema::v0_0::MatchesMetadata(*metadata)) return nullptr;
+  return metadata;
+}
+
+// Checks the elements of arrays on a ThreadPool, one array at a time,
+// remembering which element failed. Elements of `tasks` must also only
+// refer to labels and flags in `vocabulary`, and both checks run in the
+// same pass, so the element remembered is the first to fail either.
+class PoolScheduler final : public ElementScheduler {
+ public:
+  PoolScheduler(rose::ThreadPool &pool, const Node *tasks,
+                const Vocabulary &vocabulary)
+      : pool_(pool), tasks_(tasks), vocabulary_(vocabulary) {}
+
+  bool MatchesAll(const Array &array, const Matcher matcher) override {
+    const bool is_tasks =
+        tasks_ && tasks_->is_array() && tasks_->as_array().value() == &array;
+    // Elements are checked serially inside, so threads never wait on threads.
+    const opt<u64> index = pool_.FindFirst(array.size(), [&](const u64 i) {
+      if (!matcher(*array[i], nullptr)) return true;
+      return is_tasks
+          && !Task::HasValidReferences(*array[i], vocabulary_.labels,
+                                       vocabulary_.flags);
+    });
+    if (!index) return true;
+    failed_array_ = &array;
+    failed_index_ = *index;
+    return false;
+  }
+
+  const Array *failed_array() const { return failed_array_; }
+  u64 failed_index() const { return failed_index_; }
+
+ private:
+  rose::ThreadPool &pool_;
+  const Node *tasks_;
+  const Vocabulary &vocabulary_;
+  const Array *failed_array_ = nullptr;
+  u64 failed_index_ = 0;
+};
+
+// Checks the elements of arrays through a ValidationCache, so only elements
+// that changed since they last passed are checked again.
+class CachingScheduler final : public ElementScheduler {
+ public:
+  explicit CachingScheduler(ValidationCache &cache) : cache_(cache) {}
+
+  bool MatchesAll(const Array &array, const Matcher matcher) override {
+    return cache_.CheckElements(
+        array, CheckId(matcher),
+        [&](const Node &element) { return matcher(element, nullptr); });
+  }
+
+  // Returns an id for `matcher` that also changes with the schema.
+  static u64 CheckId(const Matcher matcher) {
+    return ValidationCache::Combine(reinterpret_cast<uintptr_t>(matcher),
+                                    schema::v0_0::kSchemaHash);
+  }
+
+ private:
+  ValidationCache &cache_;
+};
+
+// Returns the JSONPath of element `index` of `array`, one of the top-level
+// arrays of `board_node`.
+str ElementPath(const Node &board_node, const Array *array, const u64 index) {
+  for (const auto &[key, value] : *board_node.as_object().value()) {
+    if (value->is_array() && value->as_array().value() == array) {
+      return str("$.") + key + '[' + std::to_string(index) + ']';
+    }
+  }
+  return "$";
+}
+
+}  // namespace
+
+Board Board::FromJson(const Node &node, const allocator_type &alloc) {
+  JsonReader reader;
+  const Object &object = reader.ExpectObject(node);
+  // Tasks refer to the labels and flags defined in the metadata, so it's read
+  // first wherever it appears.
+  const Node *metadata = Find(object, "__metadata__");
+  if (!metadata) reader.Fail("Missing required property \"__metadata__\"");
+  Board board = ReadMetadata(*metadata, reader, alloc);
+
+  struct Handler {
+    // Already read.
+    void Metadata(const Node &) {}
+    void Tasks(const Array &tasks) { board.tasks_.reserve(tasks.size()); }
+    void TasksItem(const Node &task) {
+      // Straight into the columns, with the strings copied from the Node.
+      board.AddTask(
+          Task::ReadFields(task, reader, &board.labels_, &board.flags_));
+    }
+    void Events(const Array &events) {
+      board.events_.reserve(events.size());
+      board.event_index_.reserve(events.size());
+      board.event_handles_.reserve(events.size());
+    }
+    void EventsItem(const Node &event) {
+      board.AddEvent(Event::FromJson(event, reader, alloc));
+    }
+    void EventGenerators(const Array &generators) {
+      board.event_generators_.reserve(generators.size());
+    }
+    // Notes, like the link to the iCalendar spec in sample.json, are only
+    // checked.
+    void EventGeneratorsItemEventGenerator(const Node &generator) {
+      board.event_generators_.push_back(
+          EventGenerator::FromJson(generator, reader, alloc));
+    }
+    void TaskGenerators(const Array &generators) {
+      board.task_generators_.reserve(generators.size());
+    }
+    void TaskGeneratorsItemTaskGenerator(const Node &generator) {
+      board.task_generators_.push_back(TaskGenerator::FromJson(
+          generator, reader, &board.labels_, &board.flags_, alloc));
+    }
+
+    Board &board;
+    JsonReader &reader;
+    const allocator_type &alloc;
+  } handler{board, reader, alloc};
+  schema::v0_0::ReadBoard(node, reader, handler);
+  return board;
 }
 
-bool Board::NestedStructures::MatchesMetadata(const Node &node) {
-  return metadata()->Matches(node);
+Board Board::ReadMetadata(const Node &node, JsonReader &reader,
+                          const allocator_type &alloc) {
+  const auto scope = reader.Key("__metadata__");
+  Board board(0.0, "", alloc);
+  struct Handler {
+    void BoardBeeVersion(const f64 x) { board.version_ = x; }
+    void Name(const char *x) { board.name_ = x; }
+    void Desc(const char *x) { board.desc_.emplace(x, alloc); }
+    void LabelsValue(const char *key, const s64 x) {
+      // The schema keeps label values within 32 bits.
+      board.labels_.Intern(key, static_cast<s32>(x));
+    }
+    void FlagsItem(const char *x) {
+      // The schema allows at most FlagTable::kMaxFlags, all different.
+      board.flags_.Intern(x);
+    }
+
+    Board &board;
+    const allocator_type &alloc;
+  } handler{board, alloc};
+  schema::v0_0::ReadMetadata(node, reader, handler);
+  return board;
 }
 
-bool Board::NestedStructures::MatchesLabels(const Node &node) {
-  if (!node.is_object()) return false;
-  for (const auto &[key, value] : *node.as_object().value()) {
-    if (!value->is_s64()) return false;
+u64 Board::MaterializeTasks(const DateTime horizon) {
+  // Every due date first, so the instances can be added in one go.
+  vector<DateTime> dues;
+  vector<u64> ends;
+  ends.reserve(task_generators_.size());
+  for (const TaskGenerator &generator : task_generators_) {
+    generator.PendingUntil(horizon, dues);
+    ends.push_back(dues.size());
+  }
+  // Grown geometrically, so frequent small batches stay O(new instances).
+  const u64 needed = tasks_.size() + dues.size();
+  if (needed > tasks_.capacity()) {
+    tasks_.reserve(std::max<u64>(needed, 2 * tasks_.capacity()));
   }
-  return true;
+  u64 begin = 0;
+  for (u64 i = 0; i < task_generators_.size(); ++i) {
+    if (ends[i] == begin) continue;
+    for (u64 j = begin; j < ends[i]; ++j) {
+      AddTask(task_generators_[i].Instance(dues[j], {}));
+    }
+    task_generators_[i].Advance(dues[ends[i] - 1], ends[i] - begin);
+    begin = ends[i];
+  }
+  return dues.size();
 }
 
-bool Board::NestedStructures::MatchesFlags(const Node &node) {
-  if (!node.is_array()) return false;
-  for (const Node *value : *node.as_array().value()) {
-    if (!value->is_string() || !StringNodeNotEmpty(*value)) return false;
+s32 Board::LabelWeight(const opt<u32> label) const {
+  return label ? labels_.weight(*label) : 1;
+}
+
+void Board::CheckIndex(const u64 i, const u64 size, const char *what) {
+  if (i >= size) {
+    throw std::runtime_error(str(what) + ' ' + std::to_string(i)
+                             + " is out of range (there are "
+                             + std::to_string(size) + ")");
   }
-  return true;
 }
 
-bool Board::NestedStructures::MatchesTasks(const Node &node) {
-  return tasks()->Matches(node);
+void Board::AddTask(const Task::Fields &task) {
+  text_index_.Set(TaskDoc(tasks_.size()), task.name, task.desc.value_or(""));
+  tasks_.Add(task, LabelWeight(task.label));
 }
 
-bool Board::NestedStructures::MatchesEvents(const Node &node) {
-  return events()->Matches(node);
+void Board::ReplaceTask(const u64 i, const Task::Fields &task) {
+  CheckIndex(i, tasks_.size(), "Task");
+  text_index_.Set(TaskDoc(i), task.name, task.desc.value_or(""));
+  tasks_.Replace(i, task, LabelWeight(task.label));
 }
 
-bool Board::NestedStructures::MatchesTaskGenerators(const Node &node) {
-  return task_generators()->Matches(node);
+opt<u64> Board::RemoveTask(const u64 i) {
+  CheckIndex(i, tasks_.size(), "Task");
+  text_index_.Remove(TaskDoc(i));
+  const u64 last = tasks_.size() - 1;
+  if (i != last) text_index_.Renumber(TaskDoc(last), TaskDoc(i));
+  tasks_.Remove(i);
+  return i == last ? std::nullopt : mk_opt<u64>(last);
 }
 
-bool Board::NestedStructures::MatchesEventGenerators(const Node &node) {
-  return event_generators()->Matches(node);
+void Board::AddEvent(Event event) {
+  text_index_.Set(EventDoc(events_.size()), event.name(),
+                  event.desc().value_or(""));
+  const Event::Dates &dates = event.dates();
+  event_handles_.push_back(event_index_.Insert(
+      dates.start(), dates.end(), static_cast<u32>(events_.size())));
+  events_.push_back(std::move(event));
 }
 
-const ObjectStructure *Board::NestedStructures::metadata() {
-  if (metadata_) return metadata_;
-  auto *tmp = new ObjectStructure();
-  tmp->AddRequiredProperty("board_bee_version", {Node::is_f64});
-  tmp->AddRequiredProperty("name", {Node::is_string, StringNodeNotEmpty});
-  tmp->AddOptionalProperty("desc", {Node::is_string});
-  tmp->AddRequiredProperty("flags", {MatchesFlags});
-  tmp->AddOptionalProperty("labels", {MatchesLabels});
-  metadata_ = tmp;
-  return metadata_;
+void Board::RemoveEvent(const u64 i) {
+  CheckIndex(i, events_.size(), "Event");
+  event_index_.Erase(event_handles_[i]);
+  text_index_.Remove(EventDoc(i));
+  const u64 last = events_.size() - 1;
+  if (i != last) {
+    text_index_.Renumber(EventDoc(last), EventDoc(i));
+    events_[i] = std::move(events_[last]);
+    event_handles_[i] = event_handles_[last];
+    event_index_.value(event_handles_[i]) = static_cast<u32>(i);
+  }
+  events_.pop_back();
+  event_handles_.pop_back();
 }
 
-const ArrayStructure *Board::NestedStructures::tasks() {
-  if (tasks_) return tasks_;
-  auto *tmp = new ArrayStructure();
-  tmp->AddPredicate([](const Node &node) -> bool {
-    for (const Node *value : *node.as_array().value()) {
-      if (!Task::MatchesStructure(*value)) return false;
-    }
-    return true;
+vector<const Event *> Board::EventsBetween(const DateTime from,
+                                           const DateTime to) const {
+  vector<const Event *> events;
+  event_index_.ForEachOverlapping(from, to, [&](const u32 handle) {
+    events.push_back(&events_[event_index_.value(handle)]);
   });
-  tasks_ = tmp;
-  return tasks_;
+  return events;
 }
 
-const ArrayStructure *Board::NestedStructures::events() {
-  if (events_) return events_;
-  auto *tmp = new ArrayStructure();
-  tmp->AddPredicate([](const Node &node) -> bool {
-    for (const Node *value : *node.as_array().value()) {
-      if (!Event::MatchesStructure(*value)) return false;
-    }
-    return true;
+vector<const Event *> Board::EventsAt(const DateTime instant) const {
+  vector<const Event *> events;
+  event_index_.ForEachContaining(instant, [&](const u32 handle) {
+    events.push_back(&events_[event_index_.value(handle)]);
   });
-  events_ = tmp;
-  return events_;
-}
-
-const ObjectStructure *Board::structure() {
-  if (structure_) return structure_;
-  auto *tmp = new ObjectStructure();
-  tmp->AddRequiredProperty("__metadata__", {NestedStructures::MatchesMetadata});
-  tmp->AddRequiredProperty("tasks", {NestedStructures::MatchesTasks});
-  tmp->AddRequiredProperty("events", {NestedStructures::MatchesEvents});
-  tmp->AddRequiredProperty("task_generators",
-                           {NestedStructures::MatchesTaskGenerators});
-  tmp->AddRequiredProperty("event_generators",
-                           {NestedStructures::MatchesEventGenerators});
-  structure_ = tmp;
-  return structure_;
+  return events;
+}
+
+vector<const Event *> Board::UpcomingEvents(const DateTime from,
+                                            const u64 count) const {
+  vector<const Event *> events;
+  events.reserve(std::min<u64>(count, events_.size()));
+  event_index_.ForEachStartingFrom(from, count, [&](const u32 handle) {
+    events.push_back(&events_[event_index_.value(handle)]);
+  });
+  return events;
+}
+
+vector<Board::SearchHit> Board::Search(const str_view query,
+                                       const u64 limit) const {
+  vector<SearchHit> hits;
+  for (const rose::TextIndex::Hit &hit : text_index_.Search(query, limit)) {
+    hits.push_back(Resolve(hit));
+  }
+  return hits;
+}
+
+vector<Board::SearchHit> Board::SearchSubstring(const str_view needle,
+                                                const u64 limit) const {
+  vector<SearchHit> hits;
+  for (const rose::TextIndex::Hit &hit :
+       text_index_.SearchSubstring(needle, limit)) {
+    hits.push_back(Resolve(hit));
+  }
+  return hits;
+}
+
+Board::SearchHit Board::Resolve(const rose::TextIndex::Hit &hit) {
+  return {hit.doc % 2 ? SearchHit::Kind::kEvent : SearchHit::Kind::kTask,
+          hit.doc / 2, hit.score};
+}
+
+bool Board::MatchesStructure(const Node &node) {
+  if (!schema::v0_0::MatchesBoard(node)) return false;
+  const Object &board = *node.as_object().value();
+  const Vocabulary vocabulary(*Find(board, "__metadata__"));
+  for (const Node *task : *Find(board, "tasks")->as_array().value()) {
+    if (!Task::HasValidReferences(*task, vocabulary.labels, vocabulary.flags)) {
+      return false;
+    }
+  }
+  return !FirstBadTemplate(board, vocabulary);
+}
+
+bool Board::MatchesStructure(const Node &node, rose::ThreadPool &pool,
+                             str *failure) {
+  // Tasks are checked against the metadata while they're checked against
+  // the schema, so the metadata has to be known good first.
+  const Node *metadata = ValidMetadata(node);
+  if (!metadata) return false;
+  const Vocabulary vocabulary(*metadata);
+  PoolScheduler scheduler(pool, Find(*node.as_object().value(), "tasks"),
+                          vocabulary);
+  if (!schema::v0_0::MatchesBoard(node, &scheduler)) {
+    if (failure && scheduler.failed_array()) {
+      *failure = ElementPath(node, scheduler.failed_array(),
+                             scheduler.failed_index());
+    }
+    return false;
+  }
+  // There are few generators, so their templates are checked here.
+  const Object &board = *node.as_object().value();
+  const opt<u64> bad = FirstBadTemplate(board, vocabulary);
+  if (!bad) return true;
+  if (failure) {
+    *failure = ElementPath(
+        node, Find(board, "task_generators")->as_array().value(), *bad);
+  }
+  return false;
+}
+
+bool Board::MatchesStructure(const Node &node, ValidationCache &cache) {
+  CachingScheduler scheduler(cache);
+  if (!schema::v0_0::MatchesBoard(node, &scheduler)) return false;
+  // Whether a Task's references are valid depends on the metadata too, so
+  // those results are only reused while the metadata stays the same.
+  const Object &board = *node.as_object().value();
+  const u64 metadata = cache.Hash(*Find(board, "__metadata__"));
+  const u64 task_check = ValidationCache::Combine(
+      reinterpret_cast<uintptr_t>(&Task::HasValidReferences), metadata);
+  const u64 template_check = ValidationCache::Combine(
+      reinterpret_cast<uintptr_t>(&HasValidTemplateReferences), metadata);
+  opt<Vocabulary> vocabulary;
+  const auto get_vocabulary = [&]() -> const Vocabulary & {
+    if (!vocabulary) vocabulary.emplace(*Find(board, "__metadata__"));
+    return *vocabulary;
+  };
+  const bool tasks_pass = cache.CheckElements(
+      *Find(board, "tasks")->as_array().value(), task_check,
+      [&](const Node &task) {
+        return Task::HasValidReferences(task, get_vocabulary().labels,
+                                        get_vocabulary().flags);
+      });
+  return tasks_pass
+      && cache.CheckElements(
+             *Find(board, "task_generators")->as_array().value(),
+             template_check, [&](const Node &generator) {
+               return HasValidTemplateReferences(generator, get_vocabulary());
+             });
 }
 
 }  // namespace bee
@@ -2,62 +2,192 @@
 #define BOARD_BEE_SRC_STRUCTURES_BOARD_H_
 
 #include <aliases.h>
+#include <interval_tree.h>
 #include <json.h>
+#include <rose_time.h>
+#include <text_index.h>
+#include <thread_pool.h>
 
-#include <set>
+#include <memory_resource>
 
 #include "event.h"
+#include "event_generator.h"
+#include "flags.h"
+#include "label_table.h"
 #include "task.h"
+#include "task_generator.h"
+#include "task_store.h"
 
 namespace bee {
 
 class Board {
  public:
-  static Board FromJson(const rose::json::Node &node);
+  using allocator_type = std::pmr::polymorphic_allocator<>;
 
-  Board(const f64 version, const str_view name)
-      : version_(version), name_(name) {}
+  // A Task or Event found by Search or SearchSubstring.
+  struct SearchHit {
+    enum class Kind : u8 { kTask, kEvent };
 
+    Kind kind;
+    // Of the Task in tasks() or the Event in events().
+    u64 index;
+    f64 score;
+  };
+
+  // Reads a Board from `node`, checking it against schema/v0_0/board.json
+  // (and its Tasks against the labels and flags it defines) in a single
+  // pass. Throws a BadStructureException naming the first problem found.
+  static Board FromJson(const rose::json::Node &node,
+                        const allocator_type &alloc = {});
+
+  // Every string and container in the Board (including those inside its
+  // Tasks and Events) draws its storage from `alloc`. Pass an arena-backed
+  // allocator to load a Board with a few large allocations and free it in one.
+  Board(const f64 version, const str_view name,
+        const allocator_type &alloc = {})
+      : version_(version),
+        name_(name, alloc),
+        labels_(alloc),
+        flags_(alloc),
+        tasks_(alloc),
+        events_(alloc),
+        event_index_(alloc),
+        event_handles_(alloc),
+        task_generators_(alloc),
+        event_generators_(alloc),
+        text_index_(alloc) {}
+
+  allocator_type get_allocator() const { return name_.get_allocator(); }
+
+  f64 version() const { return version_; }
+  str_view name() const { return name_; }
+  opt<str_view> desc() const { return desc_; }
+  // Both interned in the order the metadata lists them.
+  const LabelTable &labels() const { return labels_; }
+  const FlagTable &flags() const { return flags_; }
+  // Stored column by column; each row reads like a Task.
+  const TaskStore &tasks() const { return tasks_; }
+  const pmr::vector<Event> &events() const { return events_; }
+  const pmr::vector<TaskGenerator> &task_generators() const {
+    return task_generators_;
+  }
+  const pmr::vector<EventGenerator> &event_generators() const {
+    return event_generators_;
+  }
+
+  // Tasks passed in number their labels and flags by labels() and flags().
+
+  // Adds `task` to the end of tasks().
+  void AddTask(const Task::Fields &task);
+  void AddTask(const Task &task) { AddTask(task.fields()); }
+  // Overwrites tasks()[i] with `task`. Throws a std::runtime_error if
+  // there's no tasks()[i].
+  void ReplaceTask(u64 i, const Task::Fields &task);
+  void ReplaceTask(const u64 i, const Task &task) {
+    ReplaceTask(i, task.fields());
+  }
+  // Removes tasks()[i], moving the last Task into its place. Returns the
+  // index the moved Task had, or nullopt if tasks()[i] was the last, so
+  // anything that refers to Tasks by index can follow it (see
+  // DeadlineScheduler::Renumber). Throws a std::runtime_error if there's
+  // no tasks()[i].
+  opt<u64> RemoveTask(u64 i);
+  // Sets tasks().now(), the time the overdue counts in its Rollups are as
+  // of.
+  void SetNow(const rose::time::DateTime now) { tasks_.SetNow(now); }
+  // Adds `event` to the end of events().
+  void AddEvent(Event event);
+  // Removes events()[i], moving the last Event into its place. Throws a
+  // std::runtime_error if there's no events()[i].
+  void RemoveEvent(u64 i);
+
+  // Appends every instance of every TaskGenerator due at or before
+  // `horizon` that hasn't been made yet, and returns how many there were.
+  // They're grouped by generator, each group in order of due date, and
+  // tasks() grows at most once. Each generator's watermark makes the next
+  // call start where this one stopped.
+  u64 MaterializeTasks(rose::time::DateTime horizon);
+
+  // Events are indexed by their dates (see rose::IntervalTree). With k
+  // Events returned, UpcomingEvents takes O(log n + k) time and the others
+  // O(min(n, (k + 1) log n)). Each Event covers its start and end and
+  // everything between, and they're returned in order of start.
+
+  // Returns the Events that overlap [from, to).
+  vector<const Event *> EventsBetween(rose::time::DateTime from,
+                                      rose::time::DateTime to) const;
+  // Returns the Events happening at `instant`.
+  vector<const Event *> EventsAt(rose::time::DateTime instant) const;
+  // Returns the first `count` Events that start at or after `from`.
+  vector<const Event *> UpcomingEvents(rose::time::DateTime from,
+                                       u64 count) const;
+
+  // The names and descriptions of Tasks and the names of Events are indexed
+  // for full-text search as they're added, replaced and removed. Hits are
+  // returned best first, at most `limit` of them.
+
+  // Returns the Tasks and Events with every word of `query`, ranked by
+  // BM25 with names counting more than descriptions.
+  vector<SearchHit> Search(str_view query, u64 limit) const;
+  // Returns the Tasks and Events whose name or description contains
+  // `needle`, ignoring case; name matches first, then earlier ones.
+  vector<SearchHit> SearchSubstring(str_view needle, u64 limit) const;
+  // The index behind Search. Saved next to the Board's file (see
+  // TextIndex::Save), it answers a cold search without loading the Board:
+  // pass each of its hits to Resolve.
+  const rose::TextIndex &text_index() const { return text_index_; }
+  static SearchHit Resolve(const rose::TextIndex::Hit &hit);
+
+  // Returns true if `node` matches schema/v0_0/board.json and every Task in
+  // it, including TaskGenerators' templates, only refers to labels and flags
+  // its Board defines.
   static bool MatchesStructure(const rose::json::Node &node);
+  // Same as above, but the elements of "tasks" and "events" are checked on
+  // `pool`'s threads. If an element is to blame, `failure` (when given) is
+  // set to its JSONPath, e.g. "$.tasks[12]". That's always the element with
+  // the lowest index, whether it breaks the schema or refers to an unknown
+  // label or flag, so the answer never depends on thread timing.
+  static bool MatchesStructure(const rose::json::Node &node,
+                               rose::ThreadPool &pool,
+                               str *failure = nullptr);
+  // Same as MatchesStructure(node), but only re-checks what changed since
+  // `node` was last checked with `cache` (see ValidationCache::MarkDirty).
+  // After editing one Task, that's the Task and the path down to it rather
+  // than the whole Board. Results are versioned by the schema they were
+  // checked against, so a cache never outlives a schema change.
+  static bool MatchesStructure(const rose::json::Node &node,
+                               rose::json::ValidationCache &cache);
   rose::json::Node ToJson() const;
 
  private:
-  class NestedStructures {
-   public:
-    static bool MatchesMetadata(const rose::json::Node &node);
-    static bool MatchesLabels(const rose::json::Node &node);
-    static bool MatchesFlags(const rose::json::Node &node);
-    static bool MatchesTasks(const rose::json::Node &node);
-    static bool MatchesEvents(const rose::json::Node &node);
-    static bool MatchesTaskGenerators(const rose::json::Node &node);
-    static bool MatchesEventGenerators(const rose::json::Node &node);
-
-    static const rose::json::ObjectStructure *metadata();
-    static const rose::json::ArrayStructure *tasks();
-    static const rose::json::ArrayStructure *events();
-    static const rose::json::ArrayStructure *task_generators();
-    static const rose::json::ArrayStructure *event_generators();
-
-   private:
-    inline static const rose::json::ObjectStructure *metadata_ = nullptr;
-    inline static const rose::json::ArrayStructure *tasks_ = nullptr;
-    inline static const rose::json::ArrayStructure *events_ = nullptr;
-    inline static const rose::json::ArrayStructure *task_generators_ = nullptr;
-    inline static const rose::json::ArrayStructure *event_generators_ = nullptr;
-  };
+  // Reads the "__metadata__" property of a Board.
+  static Board ReadMetadata(const rose::json::Node &node, JsonReader &reader,
+                            const allocator_type &alloc);
+
+  // Returns the weight a Task with `label` counts for in tasks()' Rollups.
+  s32 LabelWeight(opt<u32> label) const;
+  // Throws a std::runtime_error naming `what` unless `i` is below `size`.
+  static void CheckIndex(u64 i, u64 size, const char *what);
 
-  static const rose::json::ObjectStructure *structure();
+  // Ids of tasks()[i] and events()[i] in `text_index_`.
+  static u32 TaskDoc(const u64 i) { return 2 * i; }
+  static u32 EventDoc(const u64 i) { return 2 * i + 1; }
 
   f64 version_;
-  str name_;
-  opt<str> desc_;
-  HashMap<str, s32> labels_;
-  std::set<str> flags_;
-  vector<Task> tasks_;
-  vector<Event> events_;
-  // vector<TaskGenerator> task_generators_;
-  // vector<EventGenerator> event_generators_;
-  inline static const rose::json::ObjectStructure *structure_ = nullptr;
+  pmr::str name_;
+  opt<pmr::str> desc_;
+  LabelTable labels_;
+  FlagTable flags_;
+  TaskStore tasks_;
+  pmr::vector<Event> events_;
+  // Index of each Event in `events_`, by its dates.
+  rose::IntervalTree<rose::time::DateTime, u32> event_index_;
+  // Each Event's handle in `event_index_`, parallel to `events_`.
+  pmr::vector<u32> event_handles_;
+  pmr::vector<TaskGenerator> task_generators_;
+  pmr::vector<EventGenerator> event_generators_;
+  // Task i is document 2 * i, and Event i is document 2 * i + 1.
+  rose::TextIndex text_index_;
 };
 
 }  // namespace bee
@@ -0,0 +1,95 @@
+#include "deadline_scheduler.h"
+
+#include "board.h"
+#include "task.h"
+#include "task_store.h"
+
+namespace bee {
+
+using rose::time::DateTime;
+
+void DeadlineScheduler::ScheduleAll(const Board &board) {
+  const TaskStore &tasks = board.tasks();
+  heap_.reserve(heap_.size() + tasks.size() * kMilestoneCount);
+  for (u64 i = 0; i < tasks.size(); ++i) {
+    if (const opt<Task::Dates> dates = tasks[i].dates()) {
+      Schedule(static_cast<u32>(i), *dates);
+    }
+  }
+}
+
+void DeadlineScheduler::Schedule(const u32 task, const Task::Dates &dates) {
+  if (const opt<DateTime> start_by = dates.start_by()) {
+    Schedule(task, Milestone::kStartBy, *start_by);
+  } else {
+    Cancel(task, Milestone::kStartBy);
+  }
+  Schedule(task, Milestone::kFinishBy, dates.finish_by());
+  Schedule(task, Milestone::kDue, dates.due());
+}
+
+void DeadlineScheduler::Schedule(const u32 task, const Milestone milestone,
+                                 const DateTime when) {
+  Heap::Handle &handle = HandleOf(task, milestone);
+  if (handle == kUnscheduled) {
+    handle = heap_.Push(when, {task, milestone});
+  } else {
+    heap_.Update(handle, when);
+  }
+}
+
+void DeadlineScheduler::Cancel(const u32 task, const Milestone milestone) {
+  if (task >= handles_.size()) return;
+  Heap::Handle &handle = HandleOf(task, milestone);
+  if (handle == kUnscheduled) return;
+  heap_.Erase(handle);
+  handle = kUnscheduled;
+}
+
+void DeadlineScheduler::Cancel(const u32 task) {
+  Cancel(task, Milestone::kStartBy);
+  Cancel(task, Milestone::kFinishBy);
+  Cancel(task, Milestone::kDue);
+}
+
+void DeadlineScheduler::Renumber(const u32 from, const u32 to) {
+  if (from == to) return;
+  Cancel(to);
+  if (from >= handles_.size()) return;
+  HandleOf(to, Milestone::kDue);  // Makes room for `to`.
+  std::array<Heap::Handle, kMilestoneCount> &moved = handles_[from];
+  for (const Heap::Handle handle : moved) {
+    if (handle != kUnscheduled) heap_.value(handle).task = to;
+  }
+  handles_[to] = moved;
+  moved.fill(kUnscheduled);
+}
+
+opt<Deadline> DeadlineScheduler::Next() const {
+  if (heap_.empty()) return std::nullopt;
+  const Entry &entry = heap_.value(heap_.top());
+  return Deadline{entry.task, entry.milestone, heap_.top_key()};
+}
+
+u64 DeadlineScheduler::PopExpired(const DateTime now,
+                                  vector<Deadline> &expired) {
+  u64 count = 0;
+  while (!heap_.empty() && heap_.top_key() <= now) {
+    const DateTime when = heap_.top_key();
+    const Entry entry = heap_.Pop();
+    HandleOf(entry.task, entry.milestone) = kUnscheduled;
+    expired.push_back({entry.task, entry.milestone, when});
+    ++count;
+  }
+  return count;
+}
+
+DeadlineScheduler::Heap::Handle &DeadlineScheduler::HandleOf(
+    const u32 task, const Milestone milestone) {
+  if (task >= handles_.size()) {
+    handles_.resize(task + 1, {kUnscheduled, kUnscheduled, kUnscheduled});
+  }
+  return handles_[task][static_cast<u64>(milestone)];
+}
+
+}  // namespace bee
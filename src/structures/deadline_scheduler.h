@@ -0,0 +1,91 @@
+#ifndef BOARD_BEE_SRC_STRUCTURES_DEADLINE_SCHEDULER_H_
+#define BOARD_BEE_SRC_STRUCTURES_DEADLINE_SCHEDULER_H_
+
+#include <aliases.h>
+#include <indexed_heap.h>
+#include <rose_time.h>
+
+#include <array>
+#include <memory_resource>
+
+#include "board.h"
+#include "task.h"
+
+namespace bee {
+
+// One of the dates in a Task's Dates.
+enum class Milestone : u8 { kStartBy, kFinishBy, kDue };
+
+inline constexpr u64 kMilestoneCount = 3;
+
+// A milestone of a Task, identified by its position in Board::tasks().
+struct Deadline {
+  u32 task;
+  Milestone milestone;
+  rose::time::DateTime when;
+};
+
+// Keeps every scheduled milestone in order of date, so a long-running
+// process can ask what's due next, or collect everything that has come due,
+// without rescanning a Board. Scheduling, cancelling and rescheduling a
+// milestone each take O(log n) time.
+class DeadlineScheduler {
+ public:
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  explicit DeadlineScheduler(const allocator_type &alloc = {})
+      : heap_(alloc), handles_(alloc) {}
+
+  // Schedules the milestones of every Task on `board` that has Dates.
+  void ScheduleAll(const Board &board);
+  // Schedules each milestone in `dates` for Task `task`, replacing any
+  // already scheduled for it.
+  void Schedule(u32 task, const Task::Dates &dates);
+  // Schedules (or moves) one milestone of Task `task` to `when`.
+  void Schedule(u32 task, Milestone milestone, rose::time::DateTime when);
+  // Unschedules one milestone of Task `task`, if it's scheduled.
+  void Cancel(u32 task, Milestone milestone);
+  // Unschedules every milestone of Task `task`.
+  void Cancel(u32 task);
+  // Moves every milestone of Task `from` to Task `to`, replacing any
+  // scheduled for `to`. Board::RemoveTask moves a Task to a new index, so
+  // removing Task i goes
+  //   scheduler.Cancel(i);
+  //   if (const opt<u64> moved = board.RemoveTask(i)) {
+  //     scheduler.Renumber(*moved, i);
+  //   }
+  void Renumber(u32 from, u32 to);
+
+  // Number of milestones scheduled.
+  u64 size() const { return heap_.size(); }
+  bool empty() const { return heap_.empty(); }
+
+  // Returns the earliest scheduled milestone, if any.
+  opt<Deadline> Next() const;
+  // Unschedules every milestone at or before `now` and appends them to
+  // `expired` in order of date. Returns how many there were.
+  u64 PopExpired(rose::time::DateTime now, vector<Deadline> &expired);
+
+ private:
+  // What the heap stores for each milestone.
+  struct Entry {
+    u32 task = 0;
+    Milestone milestone = Milestone::kStartBy;
+  };
+
+  using Heap = rose::IndexedHeap<rose::time::DateTime, Entry>;
+
+  static constexpr Heap::Handle kUnscheduled = ~Heap::Handle{0};
+
+  // Returns where the handle of `milestone` of `task` is kept, making room
+  // for `task` if needed.
+  Heap::Handle &HandleOf(u32 task, Milestone milestone);
+
+  Heap heap_;
+  // Heap handles of each Task's milestones, by task and then milestone.
+  pmr::vector<std::array<Heap::Handle, kMilestoneCount>> handles_;
+};
+
+}  // namespace bee
+
+#endif  // BOARD_BEE_SRC_STRUCTURES_DEADLINE_SCHEDULER_H_
@@ -3,39 +3,60 @@
 #include <aliases.h>
 #include <json.h>
 #include <rose_time.h>
+#include <schema/v0_0/readers.h>
+#include <schema/v0_0/validators.h>
+
+#include "json_reader.h"
 
 namespace bee {
 
 using namespace rose::json;
 using namespace rose::time;
 
+Event::Dates Event::Dates::FromJson(const Node &node, JsonReader &reader) {
+  // The reader makes sure both are there.
+  struct Handler {
+    void DatesStart(const DateTime x) { start = x; }
+    void DatesEnd(const DateTime x) { end = x; }
+
+    DateTime start;
+    DateTime end;
+  } handler;
+  schema::v0_0::ReadEventDates(node, reader, handler);
+  return Dates(handler.start, handler.end);
+}
+
 bool Event::Dates::MatchesStructure(const Node &node) {
-  return structure()->Matches(node);
+  return schema::v0_0::MatchesEventDates(node);
 }
 
-const ObjectStructure *Event::Dates::structure() {
-  if (structure_) return structure_;
-  auto *tmp = new ObjectStructure();
-  auto string_node_date_time = [](const Node &node) -> bool {
-    return DateTime::IsValidDateTime(node.as_string().value());
-  };
-  tmp->AddRequiredProperty("start", {Node::is_string, string_node_date_time});
-  tmp->AddRequiredProperty("end", {Node::is_string, string_node_date_time});
-  structure_ = tmp;
-  return structure_;
+Event Event::FromJson(const Node &node, const allocator_type &alloc) {
+  JsonReader reader;
+  return FromJson(node, reader, alloc);
 }
 
-bool Event::MatchesStructure(const Node &node) {
-  return structure()->Matches(node);
+Event Event::FromJson(const Node &node, JsonReader &reader,
+                      const allocator_type &alloc) {
+  struct Handler {
+    void Name(const char *x) { name = x; }
+    void Desc(const char *x) { desc = x; }
+    void Label(const char *x) { label = x; }
+    void DatesStart(const DateTime x) { start = x; }
+    void DatesEnd(const DateTime x) { end = x; }
+
+    const char *name = nullptr;
+    opt<str_view> desc;
+    opt<str_view> label;
+    DateTime start;
+    DateTime end;
+  } handler;
+  schema::v0_0::ReadEvent(node, reader, handler);
+  return Event(handler.name, handler.desc, handler.label,
+               Dates(handler.start, handler.end), alloc);
 }
 
-const ObjectStructure *Event::structure() {
-  if (structure_) return structure_;
-  auto *tmp = new ObjectStructure();
-  tmp->AddRequiredProperty("name", {Node::is_string, StringNodeNotEmpty});
-  tmp->AddRequiredProperty("dates", {Dates::MatchesStructure});
-  structure_ = tmp;
-  return structure_;
+bool Event::MatchesStructure(const Node &node) {
+  return schema::v0_0::MatchesEvent(node);
 }
 
 }  // namespace bee
@@ -5,6 +5,10 @@
 #include <json.h>
 #include <rose_time.h>
 
+#include <memory_resource>
+
+#include "json_reader.h"
+
 namespace bee {
 
 class Event {
@@ -17,29 +21,74 @@ class Event {
     rose::time::DateTime start() const { return start_; }
     rose::time::DateTime end() const { return end_; }
 
+    // Reads Dates from `node`, parsing each date exactly once.
+    static Dates FromJson(const rose::json::Node &node, JsonReader &reader);
     static bool MatchesStructure(const rose::json::Node &node);
 
    private:
-    static const rose::json::ObjectStructure *structure();
-
     rose::time::DateTime start_;
     rose::time::DateTime end_;
-    inline static const rose::json::ObjectStructure *structure_ = nullptr;
   };
 
-  static Event FromJson(const rose::json::Node &node);
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  // Reads an Event from `node`, checking it against schema/v0_0/event.json
+  // in the same pass. Throws a BadStructureException naming the first
+  // problem found.
+  static Event FromJson(const rose::json::Node &node,
+                        const allocator_type &alloc = {});
+  // Same as above, but reporting problems relative to `reader`.
+  static Event FromJson(const rose::json::Node &node, JsonReader &reader,
+                        const allocator_type &alloc);
+
+  Event(const str_view name, const Dates dates,
+        const allocator_type &alloc = {})
+      : name_(name, alloc), dates_(dates) {}
+  Event(const str_view name, const opt<str_view> desc,
+        const opt<str_view> label, const Dates dates,
+        const allocator_type &alloc = {})
+      : name_(name, alloc),
+        desc_(desc ? mk_opt<pmr::str>(*desc, alloc) : std::nullopt),
+        label_(label ? mk_opt<pmr::str>(*label, alloc) : std::nullopt),
+        dates_(dates) {}
+  Event(const Event &other, const allocator_type &alloc)
+      : name_(other.name_, alloc),
+        desc_(CopyString(other.desc_, alloc)),
+        label_(CopyString(other.label_, alloc)),
+        dates_(other.dates_) {}
+  Event(Event &&other, const allocator_type &alloc)
+      : name_(std::move(other.name_), alloc),
+        desc_(CopyString(other.desc_, alloc)),
+        label_(CopyString(other.label_, alloc)),
+        dates_(other.dates_) {}
+  Event(const Event &other) = default;
+  Event &operator=(const Event &other) = default;
+  Event(Event &&other) = default;
+  Event &operator=(Event &&other) = default;
+
+  allocator_type get_allocator() const { return name_.get_allocator(); }
 
-  Event(const str_view name, const Dates dates) : name_(name), dates_(dates) {}
+  str_view name() const { return name_; }
+  opt<str_view> desc() const { return desc_; }
+  // Labels aren't checked against a Board's, unlike a Task's.
+  opt<str_view> label() const { return label_; }
+  const Dates &dates() const { return dates_; }
 
+  // Returns true if `node` matches schema/v0_0/event.json.
   static bool MatchesStructure(const rose::json::Node &node);
   rose::json::Node ToJson() const;
 
  private:
-  static const rose::json::ObjectStructure *structure();
+  // Returns a copy of `string` whose storage comes from `alloc`.
+  static opt<pmr::str> CopyString(const opt<pmr::str> &string,
+                                  const allocator_type &alloc) {
+    return string ? mk_opt<pmr::str>(string.value(), alloc) : std::nullopt;
+  }
 
-  str name_;
+  pmr::str name_;
+  opt<pmr::str> desc_;
+  opt<pmr::str> label_;
   Dates dates_;
-  inline static const rose::json::ObjectStructure *structure_ = nullptr;
 };
 
 }  // namespace bee
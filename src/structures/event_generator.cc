@@ -0,0 +1,141 @@
+#include "event_generator.h"
+
+#include <aliases.h>
+#include <json.h>
+#include <rose_time.h>
+#include <schema/v0_0/readers.h>
+#include <schema/v0_0/validators.h>
+
+#include "event.h"
+#include "json_reader.h"
+#include "recurrence.h"
+
+namespace bee {
+
+using namespace rose::json;
+using namespace rose::time;
+
+namespace {
+
+// Returns midnight UTC at the start of `year`.
+DateTime StartOfYear(const s64 year) {
+  return DateTime::FromSecondsSinceEpoch(DaysFromCivil(year, 1, 1)
+                                         * Duration::kSecondsPerDay);
+}
+
+s64 YearOf(const DateTime date_time) {
+  return CivilFromDays(date_time.days_since_epoch()).year;
+}
+
+}  // namespace
+
+EventGenerator EventGenerator::FromJson(const Node &node,
+                                        const allocator_type &alloc) {
+  JsonReader reader;
+  return FromJson(node, reader, alloc);
+}
+
+EventGenerator EventGenerator::FromJson(const Node &node, JsonReader &reader,
+                                        const allocator_type &alloc) {
+  // The rule is read once the start is known, wherever it appears.
+  struct Handler {
+    void Name(const char *x) { name = x; }
+    void Desc(const char *x) { desc = x; }
+    void Label(const char *x) { label = x; }
+    void StartDatesStart(const DateTime x) { start = x; }
+    void StartDatesEnd(const DateTime x) { end = x; }
+    void RecurrenceRule(const Node &x) { rule = &x; }
+
+    const char *name = nullptr;
+    opt<str_view> desc;
+    opt<str_view> label;
+    DateTime start;
+    DateTime end;
+    const Node *rule = nullptr;
+  } handler;
+  schema::v0_0::ReadEventGenerator(node, reader, handler);
+  const auto scope = reader.Key("recurrence_rule");
+  const RecurrenceRule rule =
+      ReadRecurrenceRule(*handler.rule, reader, handler.start);
+  return EventGenerator(handler.name, handler.desc, handler.label, rule,
+                        handler.end - handler.start, alloc);
+}
+
+bool EventGenerator::MatchesStructure(const Node &node) {
+  return schema::v0_0::MatchesEventGenerator(node);
+}
+
+EventGenerator &EventGenerator::operator=(const EventGenerator &other) {
+  if (this == &other) return *this;
+  name_ = other.name_;
+  desc_ = other.desc_;
+  label_ = other.label_;
+  rule_ = other.rule_;
+  length_ = other.length_;
+  const std::lock_guard lock(mutex_);
+  years_.clear();
+  return *this;
+}
+
+EventGenerator &EventGenerator::operator=(EventGenerator &&other) {
+  if (this == &other) return *this;
+  name_ = std::move(other.name_);
+  desc_ = std::move(other.desc_);
+  label_ = std::move(other.label_);
+  rule_ = other.rule_;
+  length_ = other.length_;
+  const std::lock_guard lock(mutex_);
+  years_.clear();
+  return *this;
+}
+
+vector<Event::Dates> EventGenerator::OccurrencesBetween(
+    const DateTime from, const DateTime to) const {
+  vector<Event::Dates> occurrences;
+  if (!(from < to)) return occurrences;
+  // Occurrences that overlap [from, to) start in [first, to).
+  const DateTime first = from - length_;
+  const auto add = [&](const DateTime start) {
+    if (first <= start && start < to) {
+      occurrences.emplace_back(start, start + length_);
+    }
+  };
+  const s64 first_year = YearOf(first);
+  const s64 last_year = YearOf(to - Duration::Seconds(1));
+  if (last_year - first_year >= static_cast<s64>(kMaxCachedYears)) {
+    // Too long to cache; it would only push everything else out.
+    for (auto it = rule_.From(first); it != rule_.end() && *it < to; ++it) {
+      add(*it);
+    }
+    return occurrences;
+  }
+  const std::lock_guard lock(mutex_);
+  for (s64 year = first_year; year <= last_year; ++year) {
+    for (const DateTime start : StartsIn(year)) add(start);
+  }
+  return occurrences;
+}
+
+vector<Event> EventGenerator::EventsBetween(const DateTime from,
+                                            const DateTime to,
+                                            const allocator_type &alloc) const {
+  vector<Event> events;
+  for (const Event::Dates &dates : OccurrencesBetween(from, to)) {
+    events.emplace_back(name_, desc_, label_, dates, alloc);
+  }
+  return events;
+}
+
+const pmr::vector<DateTime> &EventGenerator::StartsIn(const s64 year) const {
+  if (const auto it = years_.find(year); it != years_.end()) return it->second;
+  if (years_.size() >= kMaxCachedYears) years_.clear();
+  pmr::vector<DateTime> &starts = years_[year];
+  const DateTime end = StartOfYear(year + 1);
+  for (auto it = rule_.From(StartOfYear(year)); it != rule_.end() && *it < end;
+       ++it) {
+    starts.push_back(*it);
+  }
+  return starts;
+}
+
+}  // namespace bee
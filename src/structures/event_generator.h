@@ -0,0 +1,124 @@
+#ifndef BOARD_BEE_SRC_STRUCTURES_EVENT_GENERATOR_H_
+#define BOARD_BEE_SRC_STRUCTURES_EVENT_GENERATOR_H_
+
+#include <aliases.h>
+#include <json.h>
+#include <rose_time.h>
+
+#include <memory_resource>
+#include <mutex>
+
+#include "event.h"
+#include "json_reader.h"
+
+namespace bee {
+
+// An Event that repeats by a RecurrenceRule, such as a yearly holiday.
+// Each occurrence lasts as long as the first. Occurrences are worked out on
+// demand, a calendar year at a time, and the years asked about are
+// remembered so repeated queries (like redrawing a calendar) don't expand
+// the rule again.
+class EventGenerator {
+ public:
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  // Most years of occurrences remembered at once.
+  static constexpr u64 kMaxCachedYears = 256;
+
+  // Reads an EventGenerator from `node`, of the form
+  //   {"name": ..., "desc": ..., "label": ...,
+  //    "start_dates": {"start": ..., "end": ...}, "recurrence_rule": {...}}
+  // where the rule (see ReadRecurrenceRule) repeats from "start", and
+  // "desc" and "label" may be left out.
+  // Throws a BadStructureException naming the first problem found.
+  static EventGenerator FromJson(const rose::json::Node &node,
+                                 const allocator_type &alloc = {});
+  // Same as above, but reporting problems relative to `reader`.
+  static EventGenerator FromJson(const rose::json::Node &node,
+                                 JsonReader &reader,
+                                 const allocator_type &alloc);
+  // Returns true if `node` matches schema/v0_0/event_generator.json.
+  static bool MatchesStructure(const rose::json::Node &node);
+
+  // Occurrences start whenever `rule` does and last `length`.
+  EventGenerator(const str_view name, const rose::time::RecurrenceRule &rule,
+                 const rose::time::Duration length,
+                 const allocator_type &alloc = {})
+      : EventGenerator(name, std::nullopt, std::nullopt, rule, length,
+                       alloc) {}
+  // Same as above, but every Event made also has `desc` and `label`.
+  EventGenerator(const str_view name, const opt<str_view> desc,
+                 const opt<str_view> label,
+                 const rose::time::RecurrenceRule &rule,
+                 const rose::time::Duration length,
+                 const allocator_type &alloc = {})
+      : name_(name, alloc),
+        desc_(desc ? mk_opt<pmr::str>(*desc, alloc) : std::nullopt),
+        label_(label ? mk_opt<pmr::str>(*label, alloc) : std::nullopt),
+        rule_(rule),
+        length_(length),
+        years_(alloc) {}
+  // Copies start with nothing cached.
+  EventGenerator(const EventGenerator &other, const allocator_type &alloc)
+      : name_(other.name_, alloc),
+        desc_(CopyString(other.desc_, alloc)),
+        label_(CopyString(other.label_, alloc)),
+        rule_(other.rule_),
+        length_(other.length_),
+        years_(alloc) {}
+  EventGenerator(EventGenerator &&other, const allocator_type &alloc)
+      : name_(std::move(other.name_), alloc),
+        desc_(CopyString(other.desc_, alloc)),
+        label_(CopyString(other.label_, alloc)),
+        rule_(other.rule_),
+        length_(other.length_),
+        years_(alloc) {}
+  EventGenerator(const EventGenerator &other)
+      : EventGenerator(other, other.get_allocator()) {}
+  EventGenerator(EventGenerator &&other)
+      : EventGenerator(std::move(other), other.get_allocator()) {}
+  EventGenerator &operator=(const EventGenerator &other);
+  EventGenerator &operator=(EventGenerator &&other);
+
+  allocator_type get_allocator() const { return name_.get_allocator(); }
+
+  str_view name() const { return name_; }
+  opt<str_view> desc() const { return desc_; }
+  opt<str_view> label() const { return label_; }
+  const rose::time::RecurrenceRule &rule() const { return rule_; }
+  rose::time::Duration length() const { return length_; }
+
+  // Returns the occurrences that overlap [from, to), in order of start.
+  // Safe to call from several threads at once.
+  vector<Event::Dates> OccurrencesBetween(rose::time::DateTime from,
+                                          rose::time::DateTime to) const;
+  // Same as above, but as Events with this generator's name, description
+  // and label.
+  vector<Event> EventsBetween(rose::time::DateTime from,
+                              rose::time::DateTime to,
+                              const allocator_type &alloc = {}) const;
+
+ private:
+  // Returns a copy of `string` whose storage comes from `alloc`.
+  static opt<pmr::str> CopyString(const opt<pmr::str> &string,
+                                  const allocator_type &alloc) {
+    return string ? mk_opt<pmr::str>(string.value(), alloc) : std::nullopt;
+  }
+
+  // Returns the starts of the occurrences in `year`, expanding the rule if
+  // they aren't cached. `mutex_` must be held.
+  const pmr::vector<rose::time::DateTime> &StartsIn(s64 year) const;
+
+  pmr::str name_;
+  opt<pmr::str> desc_;
+  opt<pmr::str> label_;
+  rose::time::RecurrenceRule rule_;
+  rose::time::Duration length_;
+  mutable std::mutex mutex_;
+  // Starts of the occurrences in each year, by year.
+  mutable pmr::HashMap<s64, pmr::vector<rose::time::DateTime>> years_;
+};
+
+}  // namespace bee
+
+#endif  // BOARD_BEE_SRC_STRUCTURES_EVENT_GENERATOR_H_
@@ -0,0 +1,44 @@
+#ifndef BOARD_BEE_SRC_STRUCTURES_EXCEPTIONS_H_
+#define BOARD_BEE_SRC_STRUCTURES_EXCEPTIONS_H_
+
+#include <aliases.h>
+
+#include <exception>
+
+namespace bee {
+
+// A Node couldn't be turned into a Board (or one of its parts).
+// Carries the JSONPath of the offending Node, e.g. "$.tasks[3].dates.due".
+class BadStructureException final : public std::exception {
+ public:
+  BadStructureException(const str_view path, const str_view message)
+      : path_(path), what_(str(path) + ": " + str(message)) {}
+
+  const char *what() const noexcept override { return what_.c_str(); }
+  const str &path() const { return path_; }
+
+ private:
+  str path_;
+  str what_;
+};
+
+// A query's text couldn't be compiled into a TaskQuery.
+// Carries the offset of the offending term in the text.
+class BadQueryException final : public std::exception {
+ public:
+  BadQueryException(const u64 position, const str_view message)
+      : position_(position),
+        what_("Character " + std::to_string(position + 1) + ": "
+              + str(message)) {}
+
+  const char *what() const noexcept override { return what_.c_str(); }
+  u64 position() const { return position_; }
+
+ private:
+  u64 position_;
+  str what_;
+};
+
+}  // namespace bee
+
+#endif  // BOARD_BEE_SRC_STRUCTURES_EXCEPTIONS_H_
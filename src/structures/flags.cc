@@ -2,29 +2,105 @@
 
 #include <aliases.h>
 #include <json.h>
+#include <schema/v0_0/readers.h>
+#include <schema/v0_0/validators.h>
+
+#include "json_reader.h"
 
 namespace bee {
 
 using namespace rose::json;
 
-void Flags::set_valid_flags(const std::set<str> *valid_flags) {
+opt<u32> FlagTable::Intern(const str_view name) {
+  if (const opt<u32> id = Find(name)) return id;
+  if (size() == kMaxFlags) return std::nullopt;
+  const u32 id = size();
+  names_.emplace_back(name);
+  ids_.emplace(names_.back(), id);
+  return id;
+}
+
+opt<u32> FlagTable::Find(const str_view name) const {
+  const auto it = ids_.find(name);
+  if (it == ids_.end()) return std::nullopt;
+  return it->second;
+}
+
+Flags Flags::FromJson(const Node &node) {
+  JsonReader reader;
+  return FromJson(node, reader, valid_flags_);
+}
+
+Flags Flags::FromJson(const Node &node, JsonReader &reader,
+                      const FlagTable *table) {
+  FlagsBuilder builder(reader, table);
+  schema::v0_0::ReadTaskFlags(node, reader, builder);
+  return builder.Finish();
+}
+
+void Flags::set_valid_flags(const FlagTable *valid_flags) {
   valid_flags_ = valid_flags;
 }
 
 bool Flags::MatchesStructure(const Node &node) {
-  return structure()->Matches(node);
+  if (!schema::v0_0::MatchesTaskFlags(node)) return false;
+  return !valid_flags_ || HasValidNames(node, *valid_flags_);
+}
+
+bool Flags::HasValidNames(const Node &node, const FlagTable &table) {
+  // The set of valid flags can change between Boards, so it's checked here
+  // rather than in the schema.
+  u64 found = 0;
+  for (const auto &[key, value] : *node.as_object().value()) {
+    const opt<u32> id = table.Find(key);
+    if (!id) return false;
+    found |= u64{1} << *id;
+  }
+  return found == table.all();
 }
 
-const ObjectStructure *Flags::structure() {
-  if (structure_) return structure_;
-  auto *tmp = new ObjectStructure();
-  if (valid_flags_) {
-    for (const str &flag : *valid_flags_) {
-      tmp->AddRequiredProperty(flag.c_str(), {Node::is_bool});
+void FlagsBuilder::FlagsValue(const char *name, const bool value) {
+  const opt<u32> id = table_ ? table_->Find(name) : std::nullopt;
+  if (!id) reader_.Fail("Unknown flag");
+  flags_.Set(*id, value);
+}
+
+Flags FlagsBuilder::Finish() const {
+  // Every name was valid, so any shortfall means a flag is missing.
+  if (table_ && flags_.present() != table_->all()) {
+    for (u32 id = 0; id < table_->size(); ++id) {
+      if (!(flags_.present() >> id & 1)) {
+        reader_.Fail("Missing flag \"" + str(table_->name(id)) + '"');
+      }
     }
   }
-  structure_ = tmp;
-  return structure_;
+  return flags_;
+}
+
+FlagPredicate &FlagPredicate::Require(const u32 id, const bool value) {
+  (value ? must_be_true_ : must_be_false_) |= u64{1} << id;
+  return *this;
+}
+
+void FlagPredicate::Keep(const std::span<const u64> values,
+                         const std::span<const u64> present,
+                         const std::span<u8> mask) const {
+  u8 *out = mask.data();
+  const u64 n = mask.size();
+  if (contradictory()) {
+    for (u64 i = 0; i < n; ++i) out[i] = 0;
+    return;
+  }
+  const u64 *value = values.data();
+  const u64 *has = present.data();
+  const u64 flip = must_be_false_;
+  const u64 tested = this->tested();
+  for (u64 i = 0; i < n; ++i) {
+    // The tests that fail. The top bit of (missing | -missing) is set if
+    // there are any, which avoids a 64-bit compare SSE2 doesn't have.
+    const u64 missing = tested & ~((value[i] ^ flip) & has[i]);
+    out[i] &= ((missing | (0 - missing)) >> 63) ^ 1;
+  }
 }
 
 }  // namespace bee
@@ -4,25 +4,153 @@
 #include <aliases.h>
 #include <json.h>
 
-#include <set>
+#include <memory_resource>
+#include <span>
+
+#include "json_reader.h"
 
 namespace bee {
 
+// The flags a Board defines, each interned to a small id: its bit in Flags.
+// Ids are handed out in order from 0, and a Board has at most kMaxFlags.
+class FlagTable {
+ public:
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  static constexpr u32 kMaxFlags = 64;
+
+  FlagTable() = default;
+  explicit FlagTable(const allocator_type &alloc)
+      : names_(alloc), ids_(alloc) {}
+  FlagTable(const FlagTable &other, const allocator_type &alloc)
+      : names_(other.names_, alloc), ids_(other.ids_, alloc) {}
+  FlagTable(FlagTable &&other, const allocator_type &alloc)
+      : names_(std::move(other.names_), alloc),
+        ids_(std::move(other.ids_), alloc) {}
+  FlagTable(const FlagTable &other) = default;
+  FlagTable &operator=(const FlagTable &other) = default;
+  FlagTable(FlagTable &&other) = default;
+  FlagTable &operator=(FlagTable &&other) = default;
+
+  allocator_type get_allocator() const { return names_.get_allocator(); }
+
+  // Returns the id of `name`, giving it the next one if it has none, or
+  // nullopt if all kMaxFlags ids are taken.
+  opt<u32> Intern(str_view name);
+  // Returns the id of `name`, if it has one.
+  opt<u32> Find(str_view name) const;
+  str_view name(const u32 id) const { return names_[id]; }
+  u32 size() const { return names_.size(); }
+  // Bit i is set for every id i in use.
+  u64 all() const {
+    return size() == kMaxFlags ? ~u64{0} : (u64{1} << size()) - 1;
+  }
+
+ private:
+  pmr::vector<pmr::str> names_;
+  pmr::StrHashMap<u32> ids_;
+};
+
+// A Task's flags, as two words: bit i of `present()` says whether the Task
+// has the flag with id i in its Board's FlagTable, and bit i of `values()`
+// is its value. The names live in the table, so Flags are a fixed 16 bytes.
 class Flags {
  public:
+  // Reads Flags from `node`, which must map exactly the valid flags (see
+  // set_valid_flags) to booleans. Throws a BadStructureException otherwise.
   static Flags FromJson(const rose::json::Node &node);
+  // Same as above, but checked against and numbered by `table`, and
+  // reporting problems relative to `reader`. Without a table, flags have no
+  // ids, so only an empty object is accepted.
+  static Flags FromJson(const rose::json::Node &node, JsonReader &reader,
+                        const FlagTable *table);
 
-  static void set_valid_flags(const std::set<str> *valid_flags);
+  Flags() = default;
+  Flags(const u64 values, const u64 present)
+      : values_(values & present), present_(present) {}
 
+  u64 values() const { return values_; }
+  u64 present() const { return present_; }
+  // Returns the value of the flag with id `id`, or nullopt if it isn't set.
+  opt<bool> Get(const u32 id) const {
+    if (!(present_ >> id & 1)) return std::nullopt;
+    return (values_ >> id & 1) != 0;
+  }
+  void Set(const u32 id, const bool value) {
+    const u64 bit = u64{1} << id;
+    present_ |= bit;
+    values_ = value ? values_ | bit : values_ & ~bit;
+  }
+
+  static const FlagTable *valid_flags() { return valid_flags_; }
+  static void set_valid_flags(const FlagTable *valid_flags);
+
+  // Returns true if `node` is an Object mapping exactly the valid flags
+  // (see set_valid_flags) to booleans.
   static bool MatchesStructure(const rose::json::Node &node);
-  rose::json::Node ToJson() const;
+  // Returns true if `node` (which must already match the Task flags schema)
+  // maps exactly the flags in `table`.
+  static bool HasValidNames(const rose::json::Node &node,
+                            const FlagTable &table);
+  rose::json::Node ToJson(const FlagTable &table) const;
 
  private:
-  static const rose::json::ObjectStructure *structure();
+  u64 values_ = 0;
+  u64 present_ = 0;
+  inline static const FlagTable *valid_flags_ = nullptr;
+};
 
-  HashMap<str, bool> data_;
-  inline static const std::set<str> *valid_flags_ = nullptr;
-  inline static const rose::json::ObjectStructure *structure_ = nullptr;
+// Builds Flags out of the name and value of each flag in a Task's "flags",
+// as generated readers (see schema/v0_0/readers.h) pass them in, checking
+// each name against a FlagTable. Handlers for whole Tasks derive from it.
+class FlagsBuilder {
+ public:
+  // Without a table, flags have no ids, so every name is unknown.
+  FlagsBuilder(JsonReader &reader, const FlagTable *table)
+      : reader_(reader), table_(table) {}
+
+  // Adds flag `name`, failing through the reader if it isn't in the table.
+  void FlagsValue(const char *name, bool value);
+  // Returns the Flags built, failing if the table has a flag they lack.
+  Flags Finish() const;
+
+  JsonReader &reader() const { return reader_; }
+
+ private:
+  JsonReader &reader_;
+  const FlagTable *table_;
+  Flags flags_;
+};
+
+// A conjunction of flag tests, such as "in_progress && !done", compiled to
+// two masks: the flags that must be true and those that must be false.
+// Flags pass if they have every flag tested and
+//   (values ^ must_be_false) & tested == tested,
+// so a whole column of them is checked with a few word-wide ANDs.
+class FlagPredicate {
+ public:
+  // Adds the test "flag `id` is `value`". A flag tested both ways makes
+  // the predicate always false.
+  FlagPredicate &Require(u32 id, bool value);
+
+  u64 must_be_true() const { return must_be_true_; }
+  u64 must_be_false() const { return must_be_false_; }
+  // Every flag tested.
+  u64 tested() const { return must_be_true_ | must_be_false_; }
+  bool contradictory() const { return must_be_true_ & must_be_false_; }
+
+  bool Matches(const Flags flags) const {
+    return ((flags.values() ^ must_be_false_) & flags.present() & tested())
+        == tested() && !contradictory();
+  }
+  // Clears mask[i] for every i where the Flags with words values[i] and
+  // present[i] don't pass. The three spans must be the same size.
+  void Keep(std::span<const u64> values, std::span<const u64> present,
+            std::span<u8> mask) const;
+
+ private:
+  u64 must_be_true_ = 0;
+  u64 must_be_false_ = 0;
 };
 
 }  // namespace bee
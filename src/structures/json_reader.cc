@@ -0,0 +1,128 @@
+#include "json_reader.h"
+
+#include <aliases.h>
+#include <json.h>
+#include <rose_time.h>
+
+#include <cstring>
+#include <sstream>
+
+#include "exceptions.h"
+
+namespace bee {
+
+using namespace rose::json;
+using namespace rose::time;
+
+const Node *Find(const Object &object, const char *key) {
+  for (const auto &[name, value] : object) {
+    if (strcmp(name, key) == 0) return value;
+  }
+  return nullptr;
+}
+
+JsonReader::Scope JsonReader::Key(const char *key) {
+  const size_t length = path_.size();
+  path_ += '.';
+  path_ += key;
+  return Scope(this, length);
+}
+
+JsonReader::Scope JsonReader::Index(const u64 index) {
+  const size_t length = path_.size();
+  path_ += '[';
+  path_ += std::to_string(index);
+  path_ += ']';
+  return Scope(this, length);
+}
+
+void JsonReader::Fail(const str_view message) const {
+  throw BadStructureException(path_, message);
+}
+
+const Object &JsonReader::ExpectObject(const Node &node) const {
+  if (!node.is_object()) Fail("Expected an object");
+  return *node.as_object().value();
+}
+
+const Array &JsonReader::ExpectArray(const Node &node) const {
+  if (!node.is_array()) Fail("Expected an array");
+  return *node.as_array().value();
+}
+
+const char *JsonReader::ExpectString(const Node &node,
+                                     const u64 min_length) const {
+  if (!node.is_string()) Fail("Expected a string");
+  const char *string = node.as_string().value();
+  if (min_length == 0) return string;
+  // Count UTF-8 code points, not bytes, like JSON Schema's minLength.
+  u64 length = 0;
+  for (const char *c = string; *c && length < min_length; ++c) {
+    if ((*c & 0xC0) != 0x80) ++length;
+  }
+  if (length < min_length) {
+    if (min_length == 1) Fail("Expected a non-empty string");
+    Fail("Expected at least " + std::to_string(min_length) + " characters");
+  }
+  return string;
+}
+
+f64 JsonReader::ExpectNumber(const Node &node, const f64 min,
+                             const f64 max) const {
+  f64 number;
+  if (node.is_f64()) {
+    number = node.as_f64().value();
+  } else if (node.is_s64()) {
+    number = static_cast<f64>(node.as_s64().value());
+  } else {
+    Fail("Expected a number");
+  }
+  if (number < min || number > max) {
+    std::stringstream error_msg;
+    error_msg << number << " is not on the interval [" << min << ", " << max
+              << ']';
+    Fail(error_msg.str());
+  }
+  return number;
+}
+
+s64 JsonReader::ExpectS64(const Node &node) const {
+  if (!node.is_s64()) Fail("Expected an integer");
+  return node.as_s64().value();
+}
+
+s64 JsonReader::ExpectS64(const Node &node, const s64 min,
+                          const s64 max) const {
+  const s64 number = ExpectS64(node);
+  if (number < min || number > max) {
+    Fail(std::to_string(number) + " is not on the interval ["
+         + std::to_string(min) + ", " + std::to_string(max) + ']');
+  }
+  return number;
+}
+
+bool JsonReader::ExpectBool(const Node &node) const {
+  if (!node.is_bool()) Fail("Expected a boolean");
+  return node.as_bool().value();
+}
+
+DateTime JsonReader::ExpectDateTime(const Node &node) const {
+  const char *string = ExpectString(node);
+  ParseError error;
+  const opt<DateTime> date_time = DateTime::Parse(string, &error);
+  if (!date_time) Fail(DateTime::ErrorMessage(string, error));
+  return *date_time;
+}
+
+void JsonReader::ExpectFound(
+    const u64 found, const std::initializer_list<const char *> required) const {
+  u64 bit = 1;
+  for (const char *name : required) {
+    if (!(found & bit)) {
+      Fail(str("Missing required property \"") + name + '"');
+    }
+    bit <<= 1;
+  }
+}
+
+}  // namespace bee
@@ -0,0 +1,78 @@
+#ifndef BOARD_BEE_SRC_STRUCTURES_JSON_READER_H_
+#define BOARD_BEE_SRC_STRUCTURES_JSON_READER_H_
+
+#include <aliases.h>
+#include <json.h>
+#include <rose_time.h>
+
+#include <initializer_list>
+
+namespace bee {
+
+// Returns the property named `key` in `object`, or nullptr.
+const rose::json::Node *Find(const rose::json::Object &object,
+                             const char *key);
+
+// Checks Nodes while a struct is being built from them, keeping track of
+// where in the document it is so the first problem can be reported with its
+// JSONPath (e.g. "$.tasks[3].dates.due"). Every Expect* function throws a
+// BadStructureException if the Node isn't what was asked for.
+class JsonReader {
+ public:
+  // Puts the path back the way it was when the Scope was made.
+  class Scope {
+   public:
+    Scope(const Scope &other) = delete;
+    Scope &operator=(const Scope &other) = delete;
+    ~Scope() { reader_->path_.resize(length_); }
+
+   private:
+    friend class JsonReader;
+
+    Scope(JsonReader *reader, const size_t length)
+        : reader_(reader), length_(length) {}
+
+    JsonReader *reader_;
+    size_t length_;
+  };
+
+  JsonReader() : path_("$") {}
+
+  // Descends into the property named `key` for as long as the Scope lives.
+  [[nodiscard]] Scope Key(const char *key);
+  // Descends into the element at `index` for as long as the Scope lives.
+  [[nodiscard]] Scope Index(u64 index);
+
+  // Returns the JSONPath of the Node currently being read.
+  const str &path() const { return path_; }
+
+  // Throws a BadStructureException for the Node currently being read.
+  [[noreturn]] void Fail(str_view message) const;
+
+  const rose::json::Object &ExpectObject(const rose::json::Node &node) const;
+  const rose::json::Array &ExpectArray(const rose::json::Node &node) const;
+  // Returns the string in `node`, which must have at least `min_length`
+  // characters.
+  const char *ExpectString(const rose::json::Node &node,
+                           u64 min_length = 0) const;
+  // Returns the number (integer or not) in `node`, which must be on the
+  // closed interval [min, max].
+  f64 ExpectNumber(const rose::json::Node &node, f64 min, f64 max) const;
+  s64 ExpectS64(const rose::json::Node &node) const;
+  // Returns the integer in `node`, which must be on the closed interval
+  // [min, max].
+  s64 ExpectS64(const rose::json::Node &node, s64 min, s64 max) const;
+  bool ExpectBool(const rose::json::Node &node) const;
+  rose::time::DateTime ExpectDateTime(const rose::json::Node &node) const;
+
+  // Fails unless bit i of `found` is set for every name `required[i]`.
+  void ExpectFound(u64 found,
+                   std::initializer_list<const char *> required) const;
+
+ private:
+  str path_;
+};
+
+}  // namespace bee
+
+#endif  // BOARD_BEE_SRC_STRUCTURES_JSON_READER_H_
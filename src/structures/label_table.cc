@@ -0,0 +1,22 @@
+#include "label_table.h"
+
+#include <aliases.h>
+
+namespace bee {
+
+u32 LabelTable::Intern(const str_view name, const s32 weight) {
+  if (const opt<u32> id = Find(name)) return *id;
+  const u32 id = size();
+  names_.emplace_back(name);
+  weights_.push_back(weight);
+  ids_.emplace(names_.back(), id);
+  return id;
+}
+
+opt<u32> LabelTable::Find(const str_view name) const {
+  const auto it = ids_.find(name);
+  if (it == ids_.end()) return std::nullopt;
+  return it->second;
+}
+
+}  // namespace bee
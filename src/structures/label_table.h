@@ -0,0 +1,52 @@
+#ifndef BOARD_BEE_SRC_STRUCTURES_LABEL_TABLE_H_
+#define BOARD_BEE_SRC_STRUCTURES_LABEL_TABLE_H_
+
+#include <aliases.h>
+
+#include <memory_resource>
+
+namespace bee {
+
+// The labels a Board defines, each interned to a small id with its weight.
+// Ids are handed out in order from 0. Tasks refer to labels by id, so two
+// labels with the same weight are still told apart.
+class LabelTable {
+ public:
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  LabelTable() = default;
+  explicit LabelTable(const allocator_type &alloc)
+      : names_(alloc), weights_(alloc), ids_(alloc) {}
+  LabelTable(const LabelTable &other, const allocator_type &alloc)
+      : names_(other.names_, alloc),
+        weights_(other.weights_, alloc),
+        ids_(other.ids_, alloc) {}
+  LabelTable(LabelTable &&other, const allocator_type &alloc)
+      : names_(std::move(other.names_), alloc),
+        weights_(std::move(other.weights_), alloc),
+        ids_(std::move(other.ids_), alloc) {}
+  LabelTable(const LabelTable &other) = default;
+  LabelTable &operator=(const LabelTable &other) = default;
+  LabelTable(LabelTable &&other) = default;
+  LabelTable &operator=(LabelTable &&other) = default;
+
+  allocator_type get_allocator() const { return names_.get_allocator(); }
+
+  // Returns the id of `name`, giving it the next one and weight `weight` if
+  // it has none. A label already interned keeps its weight.
+  u32 Intern(str_view name, s32 weight);
+  // Returns the id of `name`, if it has one.
+  opt<u32> Find(str_view name) const;
+  str_view name(const u32 id) const { return names_[id]; }
+  s32 weight(const u32 id) const { return weights_[id]; }
+  u32 size() const { return names_.size(); }
+
+ private:
+  pmr::vector<pmr::str> names_;
+  pmr::vector<s32> weights_;
+  pmr::StrHashMap<u32> ids_;
+};
+
+}  // namespace bee
+
+#endif  // BOARD_BEE_SRC_STRUCTURES_LABEL_TABLE_H_
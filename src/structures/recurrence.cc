@@ -0,0 +1,48 @@
+#include "recurrence.h"
+
+#include <aliases.h>
+#include <json.h>
+#include <rose_time.h>
+#include <schema/v0_0/readers.h>
+
+#include "json_reader.h"
+
+namespace bee {
+
+using namespace rose::json;
+using namespace rose::time;
+
+RecurrenceRule ReadRecurrenceRule(const Node &node, JsonReader &reader,
+                                  const DateTime start) {
+  // The schema lists frequencies and weekdays in enum order, and rules out
+  // 0 in "month_days" and "set_pos".
+  struct Handler {
+    void FrequencyMode(const u64 x) { frequency = static_cast<Frequency>(x); }
+    void Interval(const s64 x) { interval = static_cast<u32>(x); }
+    void Count(const s64 x) { count = x; }
+    void Until(const DateTime x) { until = x; }
+    void FiltersMonthsItem(const s64 x) {
+      filters.months.push_back(static_cast<u8>(x));
+    }
+    void FiltersWeekdaysItem(const u64 x) {
+      filters.weekdays.push_back(static_cast<Weekday>(x));
+    }
+    void FiltersMonthDaysItem(const s64 x) {
+      filters.month_days.push_back(static_cast<s8>(x));
+    }
+    void FiltersSetPosItem(const s64 x) {
+      filters.set_positions.push_back(static_cast<s16>(x));
+    }
+
+    Frequency frequency;
+    u32 interval = 1;
+    opt<u64> count;
+    opt<DateTime> until;
+    RecurrenceRule::Filters filters;
+  } handler;
+  schema::v0_0::ReadRecurrenceRule(node, reader, handler);
+  return RecurrenceRule(start, handler.frequency, handler.interval,
+                        handler.filters, handler.count, handler.until);
+}
+
+}  // namespace bee
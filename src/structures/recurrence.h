@@ -0,0 +1,26 @@
+#ifndef BOARD_BEE_SRC_STRUCTURES_RECURRENCE_H_
+#define BOARD_BEE_SRC_STRUCTURES_RECURRENCE_H_
+
+#include <aliases.h>
+#include <json.h>
+#include <rose_time.h>
+
+#include "json_reader.h"
+
+namespace bee {
+
+// Reads the "recurrence_rule" of a generator, which repeats from `start`
+// (see schema/v0_0/recurrence_rule.json):
+//   {"frequency_mode": "daily" | "weekly" | "monthly" | "yearly",
+//    "interval": 1, "count": ..., "until": ...,
+//    "filters": {"months": [...], "weekdays": ["monday", ...],
+//                "month_days": [...], "set_pos": [...]}}
+// Only "frequency_mode" is required. Throws a BadStructureException naming
+// the first problem found.
+rose::time::RecurrenceRule ReadRecurrenceRule(const rose::json::Node &node,
+                                              JsonReader &reader,
+                                              rose::time::DateTime start);
+
+}  // namespace bee
+
+#endif  // BOARD_BEE_SRC_STRUCTURES_RECURRENCE_H_
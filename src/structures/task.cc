@@ -3,73 +3,129 @@
 #include <aliases.h>
 #include <json.h>
 #include <rose_time.h>
+#include <schema/v0_0/readers.h>
+#include <schema/v0_0/validators.h>
 
 #include "flags.h"
+#include "json_reader.h"
+#include "label_table.h"
 
 namespace bee {
 
 using namespace rose::json;
 using namespace rose::time;
 
+Task::Dates Task::Dates::FromJson(const Node &node, JsonReader &reader) {
+  struct Handler {
+    void DatesStartBy(const DateTime x) { start_by = x; }
+    void DatesFinishBy(const DateTime x) { finish_by = x; }
+    void DatesDue(const DateTime x) { due = x; }
+
+    opt<DateTime> start_by;
+    // The reader makes sure these two are there.
+    DateTime finish_by;
+    DateTime due;
+  } handler;
+  schema::v0_0::ReadTaskDates(node, reader, handler);
+  return handler.start_by
+           ? Dates(*handler.start_by, handler.finish_by, handler.due)
+           : Dates(handler.finish_by, handler.due);
+}
+
 bool Task::Dates::MatchesStructure(const Node &node) {
-  return structure()->Matches(node);
+  return schema::v0_0::MatchesTaskDates(node);
+}
+
+Task Task::FromJson(const Node &node, const allocator_type &alloc) {
+  JsonReader reader;
+  return FromJson(node, reader, valid_labels_, Flags::valid_flags(), alloc);
 }
 
-const ObjectStructure *Task::Dates::structure() {
-  if (structure_) return structure_;
-  auto *tmp = new ObjectStructure();
-  auto string_node_date_time = [](const Node &node) -> bool {
-    return DateTime::IsValidDateTime(node.as_string().value());
-  };
-  tmp->AddOptionalProperty("start_by",
-                           {Node::is_string, string_node_date_time});
-  tmp->AddRequiredProperty("finish_by",
-                           {Node::is_string, string_node_date_time});
-  tmp->AddRequiredProperty("due", {Node::is_string, string_node_date_time});
-  structure_ = tmp;
-  return structure_;
+Task Task::FromJson(const Node &node, JsonReader &reader,
+                    const LabelTable *valid_labels, const FlagTable *flags,
+                    const allocator_type &alloc) {
+  return Task(ReadFields(node, reader, valid_labels, flags), alloc);
+}
+
+Task::Fields Task::ReadFields(const Node &node, JsonReader &reader,
+                              const LabelTable *valid_labels,
+                              const FlagTable *flags) {
+  // Everything but the labels and flags a Board defines is checked by the
+  // reader, which passes each value here as it goes.
+  struct Handler : FlagsBuilder {
+    Handler(JsonReader &reader, const FlagTable *flags,
+            const LabelTable *valid_labels)
+        : FlagsBuilder(reader, flags), valid_labels(valid_labels) {}
+
+    void Name(const char *x) { name = x; }
+    void Desc(const char *x) { desc = x; }
+    void Label(const char *x) {
+      if (!valid_labels) reader().Fail("Unknown label");
+      label = valid_labels->Find(x);
+      if (!label) reader().Fail("Unknown label");
+    }
+    void DatesStartBy(const DateTime x) { start_by = x; }
+    void DatesFinishBy(const DateTime x) { finish_by = x; }
+    void DatesDue(const DateTime x) { due = x; }
+    void Completion(const f64 x) { completion = x; }
+
+    const LabelTable *valid_labels;
+    const char *name = nullptr;
+    opt<str_view> desc;
+    opt<u32> label;
+    opt<DateTime> start_by;
+    opt<DateTime> finish_by;
+    opt<DateTime> due;
+    opt<f64> completion;
+  } handler(reader, flags, valid_labels);
+  schema::v0_0::ReadTask(node, reader, handler);
+
+  Flags task_flags;
+  {
+    const auto scope = reader.Key("flags");
+    task_flags = handler.Finish();
+  }
+  // "dates" requires both of these, so either both are set or neither is.
+  opt<Dates> dates;
+  if (handler.due) {
+    dates = handler.start_by
+              ? Dates(*handler.start_by, *handler.finish_by, *handler.due)
+              : Dates(*handler.finish_by, *handler.due);
+  }
+  return {handler.name, handler.desc, handler.label, task_flags, dates,
+          handler.completion};
 }
 
 bool Task::MatchesStructure(const Node &node) {
-  return structure()->Matches(node);
+  if (!schema::v0_0::MatchesTask(node)) return false;
+  // Labels can change between Boards, so validity is looked up at run time.
+  const Object &task = *node.as_object().value();
+  const Node *label = Find(task, "label");
+  if (label && !IsLabelValid(label->as_string().value())) return false;
+  return Flags::MatchesStructure(*Find(task, "flags"));
 }
 
-const ObjectStructure *Task::structure() {
-  if (structure_) return structure_;
-  auto *tmp = new ObjectStructure();
-  auto string_node_not_empty = [](const Node &node) -> bool {
-    return *node.as_string().value() != '\0';
-  };
-  auto string_node_valid_label = [](const Node &node) -> bool {
-    return IsLabelValid(node.as_string().value());
-  };
-  auto f64_node_on_0_to_1 = [](const Node &node) -> bool {
-    const f64 x = node.as_f64().value();
-    return x >= 0.0 && x <= 1.0;
-  };
-  tmp->AddRequiredProperty("name", {Node::is_string, string_node_not_empty});
-  tmp->AddOptionalProperty("desc", {Node::is_string});
-  tmp->AddOptionalProperty("label", {Node::is_string, string_node_valid_label});
-  tmp->AddRequiredProperty("flags", {Flags::MatchesStructure});
-  tmp->AddOptionalProperty("dates", {Dates::MatchesStructure});
-  tmp->AddOptionalProperty("completion", {Node::is_f64, f64_node_on_0_to_1});
-  tmp->AddOptionalProperty("checklist", {/*???*/});
-  structure_ = tmp;
-  return structure_;
+bool Task::HasValidReferences(const Node &node,
+                              const LabelTable &valid_labels,
+                              const FlagTable &flags) {
+  const Object &task = *node.as_object().value();
+  const Node *label = Find(task, "label");
+  if (label && !valid_labels.Find(label->as_string().value())) return false;
+  return Flags::HasValidNames(*Find(task, "flags"), flags);
 }
 
-void Task::set_valid_labels(const HashMap<str, s32> *valid_labels) {
+void Task::set_valid_labels(const LabelTable *valid_labels) {
   valid_labels_ = valid_labels;
-  structure_ = nullptr;
 }
 
 bool Task::IsLabelValid(const str_view label) {
-  return valid_labels_->contains(label.data());
+  return valid_labels_ && valid_labels_->Find(label);
 }
 
 opt<s32> Task::LabelValue(const str_view label) {
-  return IsLabelValid(label) ? mk_opt<s32>(valid_labels_->at(label.data()))
-                             : std::nullopt;
+  if (!valid_labels_) return std::nullopt;
+  const opt<u32> id = valid_labels_->Find(label);
+  return id ? mk_opt<s32>(valid_labels_->weight(*id)) : std::nullopt;
 }
 
 }  // namespace bee
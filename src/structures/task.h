@@ -5,7 +5,11 @@
 #include <json.h>
 #include <rose_time.h>
 
+#include <memory_resource>
+
 #include "flags.h"
+#include "json_reader.h"
+#include "label_table.h"
 
 namespace bee {
 
@@ -23,39 +27,123 @@ class Task {
     rose::time::DateTime finish_by() const { return finish_by_; }
     rose::time::DateTime due() const { return due_; }
 
+    // Reads Dates from `node`, parsing each date exactly once.
+    static Dates FromJson(const rose::json::Node &node, JsonReader &reader);
     static bool MatchesStructure(const rose::json::Node &node);
 
    private:
-    static const rose::json::ObjectStructure *structure();
-
     opt<rose::time::DateTime> start_by_;
     rose::time::DateTime finish_by_;
     rose::time::DateTime due_;
-    inline static const rose::json::ObjectStructure *structure_ = nullptr;
   };
 
-  static Task FromJson(const rose::json::Node &node);
+  // A Task's fields, with its strings borrowed from wherever they were read
+  // (such as the Node behind FromJson) rather than owned.
+  struct Fields {
+    str_view name;
+    opt<str_view> desc;
+    opt<u32> label;
+    Flags flags;
+    opt<Dates> dates;
+    opt<f64> completion;
+  };
+
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  // Reads a Task from `node`, checking it against schema/v0_0/task.json and
+  // the valid labels and flags (see set_valid_labels and
+  // Flags::set_valid_flags) in the same pass. Throws a BadStructureException
+  // naming the first problem found.
+  static Task FromJson(const rose::json::Node &node,
+                       const allocator_type &alloc = {});
+  // Same as above, but with the labels and flags of the Board being read and
+  // reporting problems relative to `reader`. A null `valid_labels` rejects
+  // every label; a null `flags` rejects every flag (see Flags::FromJson).
+  static Task FromJson(const rose::json::Node &node, JsonReader &reader,
+                       const LabelTable *valid_labels,
+                       const FlagTable *flags, const allocator_type &alloc);
+  // Same as above, but returns the fields without copying them into a Task.
+  // The strings point into `node`, so they last as long as it does.
+  static Fields ReadFields(const rose::json::Node &node, JsonReader &reader,
+                           const LabelTable *valid_labels,
+                           const FlagTable *flags);
+
+  Task() = default;
+  explicit Task(const allocator_type &alloc) : name_(alloc) {}
+  Task(const str_view name, const opt<str_view> desc, const opt<u32> label,
+       const Flags flags, const opt<Dates> &dates, const opt<f64> completion,
+       const allocator_type &alloc = {})
+      : name_(name, alloc),
+        desc_(desc ? mk_opt<pmr::str>(*desc, alloc) : std::nullopt),
+        label_(label),
+        flags_(flags),
+        dates_(dates),
+        completion_(completion) {}
+  explicit Task(const Fields &fields, const allocator_type &alloc = {})
+      : Task(fields.name, fields.desc, fields.label, fields.flags,
+             fields.dates, fields.completion, alloc) {}
+  Task(const Task &other, const allocator_type &alloc)
+      : name_(other.name_, alloc),
+        desc_(CopyDesc(other.desc_, alloc)),
+        label_(other.label_),
+        flags_(other.flags_),
+        dates_(other.dates_),
+        completion_(other.completion_) {}
+  Task(Task &&other, const allocator_type &alloc)
+      : name_(std::move(other.name_), alloc),
+        desc_(CopyDesc(other.desc_, alloc)),
+        label_(other.label_),
+        flags_(other.flags_),
+        dates_(other.dates_),
+        completion_(other.completion_) {}
+  Task(const Task &other) = default;
+  Task &operator=(const Task &other) = default;
+  Task(Task &&other) = default;
+  Task &operator=(Task &&other) = default;
+
+  allocator_type get_allocator() const { return name_.get_allocator(); }
 
   str_view name() const { return name_; }
   opt<str_view> desc() const { return desc_; }
-  opt<s32> label() const { return label_; }
+  // The id of the label in its Board's LabelTable.
+  opt<u32> label() const { return label_; }
   Flags flags() const { return flags_; }
-  static void set_valid_labels(const HashMap<str, s32> *valid_labels);
+  const opt<Dates> &dates() const { return dates_; }
+  void set_dates(const opt<Dates> &dates) { dates_ = dates; }
+  opt<f64> completion() const { return completion_; }
+  // Returns the fields of this Task, borrowing its strings.
+  Fields fields() const {
+    return {name_, desc(), label_, flags_, dates_, completion_};
+  }
+  static void set_valid_labels(const LabelTable *valid_labels);
 
   static bool IsLabelValid(str_view label);
+  // Returns the weight of `label`, if it's valid.
   static opt<s32> LabelValue(str_view label);
+  // Returns true if `node` matches schema/v0_0/task.json and its label and
+  // flags are valid (see set_valid_labels and Flags::set_valid_flags).
   static bool MatchesStructure(const rose::json::Node &node);
+  // Returns true if the label and flags of `node` (which must already match
+  // the Task schema) are among `valid_labels` and `flags`.
+  static bool HasValidReferences(
+      const rose::json::Node &node,
+      const LabelTable &valid_labels, const FlagTable &flags);
   rose::json::Node ToJson() const;
 
  private:
-  static const rose::json::ObjectStructure *structure();
+  // Returns a copy of `desc` whose storage comes from `alloc`.
+  static opt<pmr::str> CopyDesc(const opt<pmr::str> &desc,
+                                const allocator_type &alloc) {
+    return desc ? mk_opt<pmr::str>(desc.value(), alloc) : std::nullopt;
+  }
 
-  str name_;
-  opt<str> desc_;
-  opt<s32> label_;
+  pmr::str name_;
+  opt<pmr::str> desc_;
+  opt<u32> label_;
   Flags flags_;
-  inline static const HashMap<str, s32> *valid_labels_ = nullptr;
-  inline static const rose::json::ObjectStructure *structure_ = nullptr;
+  opt<Dates> dates_;
+  opt<f64> completion_;
+  inline static const LabelTable *valid_labels_ = nullptr;
 };
 
 }  // namespace bee
@@ -0,0 +1,81 @@
+#include "task_generator.h"
+
+#include <aliases.h>
+#include <json.h>
+#include <rose_time.h>
+#include <schema/v0_0/readers.h>
+#include <schema/v0_0/validators.h>
+
+#include "json_reader.h"
+#include "label_table.h"
+#include "recurrence.h"
+#include "task.h"
+
+namespace bee {
+
+using namespace rose::json;
+using namespace rose::time;
+
+TaskGenerator TaskGenerator::FromJson(const Node &node, JsonReader &reader,
+                                      const LabelTable *valid_labels,
+                                      const FlagTable *flags,
+                                      const allocator_type &alloc) {
+  // The schema makes sure the template has dates. The rule is read once
+  // the template's due date is known, wherever it appears.
+  struct Handler {
+    void Template(const Node &x) {
+      prototype.emplace(Task::FromJson(x, reader, valid_labels, flags, alloc));
+    }
+    void RecurrenceRule(const Node &x) { rule = &x; }
+
+    JsonReader &reader;
+    const LabelTable *valid_labels;
+    const FlagTable *flags;
+    const allocator_type &alloc;
+    opt<Task> prototype;
+    const Node *rule = nullptr;
+  } handler{reader, valid_labels, flags, alloc, std::nullopt};
+  schema::v0_0::ReadTaskGenerator(node, reader, handler);
+  const auto scope = reader.Key("recurrence_rule");
+  const RecurrenceRule rule = ReadRecurrenceRule(
+      *handler.rule, reader, handler.prototype->dates()->due());
+  return TaskGenerator(*handler.prototype, rule, alloc);
+}
+
+bool TaskGenerator::MatchesStructure(const Node &node) {
+  return schema::v0_0::MatchesTaskGenerator(node);
+}
+
+u64 TaskGenerator::PendingUntil(const DateTime horizon,
+                                vector<DateTime> &dues) const {
+  u64 count = 0;
+  auto it = watermark_
+              ? rule_.Resume(*watermark_ + Duration::Seconds(1), materialized_)
+              : rule_.begin();
+  for (; it != rule_.end() && *it <= horizon; ++it) {
+    dues.push_back(*it);
+    ++count;
+  }
+  return count;
+}
+
+Task TaskGenerator::Instance(const DateTime due,
+                             const allocator_type &alloc) const {
+  Task task(prototype_, alloc);
+  const Task::Dates &dates = *prototype_.dates();
+  const Duration shift = due - dates.due();
+  if (const opt<DateTime> start_by = dates.start_by()) {
+    task.set_dates(
+        Task::Dates(*start_by + shift, dates.finish_by() + shift, due));
+  } else {
+    task.set_dates(Task::Dates(dates.finish_by() + shift, due));
+  }
+  return task;
+}
+
+void TaskGenerator::Advance(const DateTime due, const u64 count) {
+  watermark_ = due;
+  materialized_ += count;
+}
+
+}  // namespace bee
@@ -0,0 +1,92 @@
+#ifndef BOARD_BEE_SRC_STRUCTURES_TASK_GENERATOR_H_
+#define BOARD_BEE_SRC_STRUCTURES_TASK_GENERATOR_H_
+
+#include <aliases.h>
+#include <json.h>
+#include <rose_time.h>
+
+#include <memory_resource>
+
+#include "flags.h"
+#include "json_reader.h"
+#include "label_table.h"
+#include "task.h"
+
+namespace bee {
+
+// A Task that repeats by a RecurrenceRule, such as a weekly chore.
+// Each instance is a copy of a template Task with its dates moved so that
+// it's due on an occurrence of the rule, which repeats from the template's
+// due date. Instances are made in batches (see Board::MaterializeTasks), and
+// the generator remembers the last one made, its watermark, so each batch
+// picks up where the previous one stopped.
+// The watermark is only kept in memory: the schema has no place for it and
+// Boards aren't written back yet. Materialization is per process, so a
+// generator read from JSON always starts again from its first occurrence.
+class TaskGenerator {
+ public:
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  // Reads a TaskGenerator from `node`, of the form
+  //   {"template": {...}, "recurrence_rule": {...}}
+  // where the template is a Task with dates and the rule is read by
+  // ReadRecurrenceRule. The template's label and flags are checked against
+  // `valid_labels` and `flags` like Task::FromJson does. Throws a
+  // BadStructureException naming the first problem found.
+  static TaskGenerator FromJson(const rose::json::Node &node,
+                                JsonReader &reader,
+                                const LabelTable *valid_labels,
+                                const FlagTable *flags,
+                                const allocator_type &alloc);
+  // Returns true if `node` matches schema/v0_0/task_generator.json. Its
+  // template's label and flags aren't checked (see Board::MatchesStructure).
+  static bool MatchesStructure(const rose::json::Node &node);
+
+  // `prototype` must have dates, and `rule` should repeat from its due date.
+  TaskGenerator(const Task &prototype, const rose::time::RecurrenceRule &rule,
+                const allocator_type &alloc = {})
+      : prototype_(prototype, alloc), rule_(rule) {}
+  TaskGenerator(const TaskGenerator &other, const allocator_type &alloc)
+      : prototype_(other.prototype_, alloc),
+        rule_(other.rule_),
+        watermark_(other.watermark_),
+        materialized_(other.materialized_) {}
+  TaskGenerator(TaskGenerator &&other, const allocator_type &alloc)
+      : prototype_(std::move(other.prototype_), alloc),
+        rule_(other.rule_),
+        watermark_(other.watermark_),
+        materialized_(other.materialized_) {}
+  TaskGenerator(const TaskGenerator &other) = default;
+  TaskGenerator &operator=(const TaskGenerator &other) = default;
+  TaskGenerator(TaskGenerator &&other) = default;
+  TaskGenerator &operator=(TaskGenerator &&other) = default;
+
+  allocator_type get_allocator() const { return prototype_.get_allocator(); }
+
+  const Task &prototype() const { return prototype_; }
+  const rose::time::RecurrenceRule &rule() const { return rule_; }
+  // Due date of the last instance made, if any have been.
+  opt<rose::time::DateTime> watermark() const { return watermark_; }
+  // Number of instances made so far.
+  u64 materialized() const { return materialized_; }
+
+  // Appends the due dates of the instances after the watermark and at or
+  // before `horizon` to `dues`, in order, and returns how many there are.
+  // Only occurrences past the watermark are visited.
+  u64 PendingUntil(rose::time::DateTime horizon,
+                   vector<rose::time::DateTime> &dues) const;
+  // Returns the instance due at `due`, its storage drawn from `alloc`.
+  Task Instance(rose::time::DateTime due, const allocator_type &alloc) const;
+  // Records that `count` more instances were made, the last due at `due`.
+  void Advance(rose::time::DateTime due, u64 count);
+
+ private:
+  Task prototype_;
+  rose::time::RecurrenceRule rule_;
+  opt<rose::time::DateTime> watermark_;
+  u64 materialized_ = 0;
+};
+
+}  // namespace bee
+
+#endif  // BOARD_BEE_SRC_STRUCTURES_TASK_GENERATOR_H_
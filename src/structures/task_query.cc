@@ -0,0 +1,256 @@
+#include "task_query.h"
+
+#include <aliases.h>
+#include <roaring_bitmap.h>
+#include <rose_time.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+#include "board.h"
+#include "exceptions.h"
+#include "flags.h"
+#include "task.h"
+#include "task_store.h"
+
+namespace bee {
+
+using rose::RoaringBitmap;
+using rose::time::DateTime;
+using rose::time::Duration;
+
+namespace {
+
+// Bounds for one-sided due tests.
+constexpr DateTime kEarliest =
+    DateTime::FromSecondsSinceEpoch(std::numeric_limits<s64>::min() / 2);
+constexpr DateTime kLatest =
+    DateTime::FromSecondsSinceEpoch(std::numeric_limits<s64>::max() / 2);
+
+enum class Comparison : u8 { kLess, kAtMost, kGreater, kAtLeast, kEqual };
+
+// Reads the comparison at the start of `text`, and returns its length, or 0
+// if there's none.
+u64 ReadComparison(const str_view text, Comparison *comparison) {
+  if (text.starts_with("<=")) {
+    *comparison = Comparison::kAtMost;
+    return 2;
+  }
+  if (text.starts_with(">=")) {
+    *comparison = Comparison::kAtLeast;
+    return 2;
+  }
+  switch (text.empty() ? '\0' : text[0]) {
+    case '<':
+      *comparison = Comparison::kLess;
+      return 1;
+    case '>':
+      *comparison = Comparison::kGreater;
+      return 1;
+    case '=':
+      *comparison = Comparison::kEqual;
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
+TaskQuery TaskQuery::Compile(const str_view text, const Board &board) {
+  TaskQuery query;
+  u64 i = 0;
+  while (true) {
+    while (i < text.size() && (text[i] == ' ' || text[i] == '\t')) ++i;
+    if (i == text.size()) break;
+    const u64 start = i;
+    while (i < text.size() && text[i] != ' ' && text[i] != '\t') ++i;
+    query.AddTerm(text.substr(start, i - start), start, board);
+  }
+  return query;
+}
+
+vector<TaskRef> TaskQuery::Run(const TaskStore &store) const {
+  vector<TaskRef> tasks;
+  if (never_ || flags_.contradictory()) return tasks;
+  const bool scans = has_due_ || has_completion_;
+
+  // Indexes first: they only cost as much as the rows they hold.
+  opt<RoaringBitmap> candidates;
+  if (flags_.tested()) {
+    candidates = store.Matching(flags_);
+    if (label_) *candidates &= store.WithLabel(*label_);
+  } else if (label_) {
+    candidates = store.WithLabel(*label_);
+  }
+  if (candidates
+      && (!scans
+          || candidates->Cardinality() * kRowByRowFraction < store.size())) {
+    tasks.reserve(candidates->Cardinality());
+    candidates->ForEach([&](const u32 row) {
+      if (!scans || PassesScans(store[row])) tasks.push_back(store[row]);
+    });
+    return tasks;
+  }
+
+  // Then a pass over the columns, starting from whatever the indexes kept.
+  vector<u8> mask(store.size(), candidates ? 0 : 1);
+  if (candidates) candidates->ForEach([&](const u32 row) { mask[row] = 1; });
+  if (has_due_) store.KeepDueBetween(due_from_, due_to_, mask);
+  if (has_completion_) {
+    store.KeepCompletionBetween(completion_min_, completion_max_, mask);
+  }
+  for (const u32 row : TaskStore::Rows(mask)) tasks.push_back(store[row]);
+  return tasks;
+}
+
+void TaskQuery::AddTerm(const str_view term, const u64 position,
+                        const Board &board) {
+  const auto fail = [&](const str &message) {
+    throw BadQueryException(position, message);
+  };
+  const auto flag_id = [&](const str_view name) {
+    const opt<u32> id = board.flags().Find(name);
+    if (!id) fail("Unknown flag \"" + str(name) + '"');
+    return *id;
+  };
+
+  if (term[0] == '!') {
+    flags_.Require(flag_id(term.substr(1)), false);
+    return;
+  }
+  const u64 field_end = term.find_first_of(":<>=");
+  if (field_end == str_view::npos) {
+    flags_.Require(flag_id(term), true);
+    return;
+  }
+  const str_view field = term.substr(0, field_end);
+
+  if (term[field_end] == ':') {
+    if (field != "label") fail("Unknown field \"" + str(field) + '"');
+    const str_view name = term.substr(field_end + 1);
+    const opt<u32> id = board.labels().Find(name);
+    if (!id) fail("Unknown label \"" + str(name) + '"');
+    if (label_ && *label_ != *id) never_ = true;
+    label_ = id;
+    return;
+  }
+
+  Comparison comparison;
+  const u64 value_start =
+      field_end + ReadComparison(term.substr(field_end), &comparison);
+  const str_view value = term.substr(value_start);
+  if (value.empty()) {
+    fail("Missing value after \"" + str(term.substr(0, value_start)) + '"');
+  }
+
+  if (field == "due") {
+    // A bare date stands for the whole day, so "due<=2024-05-01" includes
+    // Tasks due that evening.
+    const bool whole_day = value.size() == 10;
+    const opt<DateTime> date_time =
+        DateTime::Parse(whole_day ? str(value) + "T00:00:00Z" : str(value));
+    if (!date_time) fail("Invalid date \"" + str(value) + '"');
+    const DateTime start = *date_time;
+    const DateTime next =
+        start + (whole_day ? Duration::Days(1) : Duration::Seconds(1));
+    DateTime from = kEarliest;
+    DateTime to = kLatest;
+    switch (comparison) {
+      case Comparison::kLess:
+        to = start;
+        break;
+      case Comparison::kAtMost:
+        to = next;
+        break;
+      case Comparison::kGreater:
+        from = next;
+        break;
+      case Comparison::kAtLeast:
+        from = start;
+        break;
+      case Comparison::kEqual:
+        from = start;
+        to = next;
+        break;
+    }
+    if (has_due_) {
+      from = std::max(from, due_from_);
+      to = std::min(to, due_to_);
+    }
+    has_due_ = true;
+    due_from_ = from;
+    due_to_ = to;
+    if (from >= to) never_ = true;
+    return;
+  }
+
+  if (field == "completion") {
+    f64 x;
+    const auto [end, error] =
+        std::from_chars(value.data(), value.data() + value.size(), x);
+    if (error != std::errc() || end != value.data() + value.size()
+        || std::isnan(x)) {
+      fail("Invalid number \"" + str(value) + '"');
+    }
+    constexpr f64 kInfinity = std::numeric_limits<f64>::infinity();
+    f64 min = -kInfinity;
+    f64 max = kInfinity;
+    switch (comparison) {
+      case Comparison::kLess:
+        max = std::nextafter(x, -kInfinity);
+        break;
+      case Comparison::kAtMost:
+        max = x;
+        break;
+      case Comparison::kGreater:
+        min = std::nextafter(x, kInfinity);
+        break;
+      case Comparison::kAtLeast:
+        min = x;
+        break;
+      case Comparison::kEqual:
+        min = max = x;
+        break;
+    }
+    if (has_completion_) {
+      min = std::max(min, completion_min_);
+      max = std::min(max, completion_max_);
+    }
+    has_completion_ = true;
+    completion_min_ = min;
+    completion_max_ = max;
+    if (min > max) never_ = true;
+    return;
+  }
+
+  fail("Unknown field \"" + str(field) + '"');
+}
+
+bool TaskQuery::PassesScans(const TaskRef task) const {
+  if (has_due_) {
+    const opt<Task::Dates> dates = task.dates();
+    if (!dates || dates->due() < due_from_ || !(dates->due() < due_to_)) {
+      return false;
+    }
+  }
+  if (has_completion_) {
+    const opt<f64> completion = task.completion();
+    if (!completion || *completion < completion_min_
+        || *completion > completion_max_) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const TaskQuery &TaskQueryCache::Compile(const str_view text) {
+  if (const auto it = plans_.find(text); it != plans_.end()) return it->second;
+  TaskQuery query = TaskQuery::Compile(text, board_);
+  if (plans_.size() == kCapacity) plans_.clear();
+  return plans_.emplace(str(text), std::move(query)).first->second;
+}
+
+}  // namespace bee
@@ -0,0 +1,95 @@
+#ifndef BOARD_BEE_SRC_STRUCTURES_TASK_QUERY_H_
+#define BOARD_BEE_SRC_STRUCTURES_TASK_QUERY_H_
+
+#include <aliases.h>
+#include <rose_time.h>
+
+#include "board.h"
+#include "flags.h"
+#include "task_store.h"
+
+namespace bee {
+
+// A compiled search over a Board's Tasks, such as
+//   label:02_MATH_1220 due<2024-05-01 completion<0.5 !done
+// Terms are separated by spaces and a Task must pass all of them:
+//   label:NAME       has the label NAME
+//   due<D, due<=D, due>D, due>=D, due=D
+//                    is due before, by, after, from or on D, where D is a
+//                    date (YYYY-MM-DD, a whole UTC day) or a date and time
+//                    as in the Board's JSON
+//   completion<X (and <=, >, >=, =)
+//                    has a completion compared that way with the number X
+//   FLAG, !FLAG      has the flag FLAG set to true, or to false
+// Tasks without a label, dates or completion fail every test of it.
+//
+// Compiling resolves names to ids and folds the terms into one test per
+// field. Running it starts from the label and flag bitmaps of the Board's
+// TaskStore, smallest first, then finishes the date and completion tests:
+// row by row over the candidates when there are few of them, or with the
+// store's Keep* loops over every row when there are many.
+class TaskQuery {
+ public:
+  // Compiles `text` against the labels and flags of `board`. Throws a
+  // BadQueryException naming the first term it can't make sense of.
+  static TaskQuery Compile(str_view text, const Board &board);
+
+  // Returns the Tasks in `store` that pass, in order of row.
+  vector<TaskRef> Run(const TaskStore &store) const;
+
+ private:
+  TaskQuery() = default;
+
+  // Folds the term `term`, which starts at `position` in the query's text,
+  // into this query.
+  void AddTerm(str_view term, u64 position, const Board &board);
+  // Returns true if `task` passes the due and completion tests.
+  bool PassesScans(TaskRef task) const;
+
+  // Fewer candidates than 1 / kRowByRowFraction of the store are tested
+  // row by row; with more, a full Keep* pass is cheaper.
+  static constexpr u64 kRowByRowFraction = 16;
+
+  // True once two terms contradict, e.g. two different labels.
+  bool never_ = false;
+  opt<u32> label_;
+  FlagPredicate flags_;
+  // Due in [due_from_, due_to_), if `has_due_`.
+  bool has_due_ = false;
+  rose::time::DateTime due_from_;
+  rose::time::DateTime due_to_;
+  // Completion on [completion_min_, completion_max_], if `has_completion_`.
+  bool has_completion_ = false;
+  f64 completion_min_;
+  f64 completion_max_;
+};
+
+// Compiled TaskQueries for one Board, by their text, so running the same
+// query again skips parsing and name lookups. The Board must outlive it,
+// and its labels and flags must not change.
+class TaskQueryCache {
+ public:
+  // Plans are small, so up to this many are kept, and the cache starts
+  // over when it's full.
+  static constexpr u64 kCapacity = 256;
+
+  explicit TaskQueryCache(const Board &board) : board_(board) {}
+
+  // Returns `text` compiled, compiling it the first time it's seen. Throws
+  // like TaskQuery::Compile. The result is valid until the next call.
+  const TaskQuery &Compile(str_view text);
+  // Compiles `text` (if need be) and runs it over the Board's Tasks.
+  vector<TaskRef> Run(const str_view text) {
+    return Compile(text).Run(board_.tasks());
+  }
+
+  u64 size() const { return plans_.size(); }
+
+ private:
+  const Board &board_;
+  StrHashMap<TaskQuery> plans_;
+};
+
+}  // namespace bee
+
+#endif  // BOARD_BEE_SRC_STRUCTURES_TASK_QUERY_H_
@@ -0,0 +1,333 @@
+#include "task_store.h"
+
+#include <aliases.h>
+#include <roaring_bitmap.h>
+#include <rose_time.h>
+
+#include <algorithm>
+#include <bit>
+
+#include "flags.h"
+#include "task.h"
+
+namespace bee {
+
+using rose::RoaringBitmap;
+using rose::time::DateTime;
+
+str_view TaskRef::name() const { return store_->View(store_->names_[row_]); }
+
+opt<str_view> TaskRef::desc() const {
+  if (!(store_->present_[row_] & TaskStore::kDesc)) return std::nullopt;
+  return store_->View(store_->descs_[row_]);
+}
+
+opt<u32> TaskRef::label() const {
+  if (!(store_->present_[row_] & TaskStore::kLabel)) return std::nullopt;
+  return store_->labels_[row_];
+}
+
+s32 TaskRef::weight() const { return store_->weights_[row_]; }
+
+opt<Task::Dates> TaskRef::dates() const {
+  const u8 present = store_->present_[row_];
+  if (!(present & TaskStore::kDates)) return std::nullopt;
+  if (present & TaskStore::kStartBy) {
+    return Task::Dates(store_->start_by_[row_], store_->finish_by_[row_],
+                       store_->due_[row_]);
+  }
+  return Task::Dates(store_->finish_by_[row_], store_->due_[row_]);
+}
+
+opt<f64> TaskRef::completion() const {
+  if (!(store_->present_[row_] & TaskStore::kCompletion)) return std::nullopt;
+  return store_->completion_[row_];
+}
+
+Flags TaskRef::flags() const {
+  return Flags(store_->flag_values_[row_], store_->flag_present_[row_]);
+}
+
+Task TaskRef::ToTask(const Task::allocator_type &alloc) const {
+  return Task(name(), desc(), label(), flags(), dates(), completion(), alloc);
+}
+
+TaskStore::TaskStore(const allocator_type &alloc)
+    : text_(alloc),
+      names_(alloc),
+      descs_(alloc),
+      labels_(alloc),
+      weights_(alloc),
+      present_(alloc),
+      start_by_(alloc),
+      finish_by_(alloc),
+      due_(alloc),
+      completion_(alloc),
+      flag_values_(alloc),
+      flag_present_(alloc),
+      label_rows_(alloc),
+      flag_rows_(2 * FlagTable::kMaxFlags, alloc),
+      no_rows_(alloc),
+      label_rollups_(alloc),
+      flag_rollups_(2 * FlagTable::kMaxFlags, alloc),
+      due_rows_(alloc),
+      due_handles_(alloc) {}
+
+void TaskStore::reserve(const u64 rows) {
+  ForEachColumn([&](auto &column) { column.reserve(rows); });
+}
+
+void TaskStore::Add(const Task::Fields &task, const s32 weight) {
+  const u64 row = size();
+  ForEachColumn([](auto &column) { column.emplace_back(); });
+  Write(row, task, weight);
+  Index(row);
+}
+
+void TaskStore::Replace(const u64 row, const Task::Fields &task,
+                        const s32 weight) {
+  Unindex(row);
+  garbage_ += TextSize(row);
+  Write(row, task, weight);
+  Index(row);
+  MaybeCompactText();
+}
+
+void TaskStore::Remove(const u64 row) {
+  Unindex(row);
+  garbage_ += TextSize(row);
+  const u64 last = size() - 1;
+  if (row != last) {
+    Unindex(last);
+    ForEachColumn([&](auto &column) { column[row] = column[last]; });
+    Index(row);
+  }
+  ForEachColumn([](auto &column) { column.pop_back(); });
+  MaybeCompactText();
+}
+
+const RoaringBitmap &TaskStore::WithLabel(const u32 label) const {
+  const auto it = label_rows_.find(label);
+  return it == label_rows_.end() ? no_rows_ : it->second;
+}
+
+const RoaringBitmap &TaskStore::WithFlag(const u32 flag,
+                                         const bool value) const {
+  return flag_rows_[2 * flag + value];
+}
+
+RoaringBitmap TaskStore::Matching(const FlagPredicate &predicate) const {
+  RoaringBitmap rows(get_allocator());
+  if (predicate.contradictory()) return rows;
+  vector<const RoaringBitmap *> indexes;
+  for (u64 tested = predicate.tested(); tested != 0; tested &= tested - 1) {
+    const u32 flag = std::countr_zero(tested);
+    indexes.push_back(&WithFlag(flag, predicate.must_be_true() >> flag & 1));
+  }
+  if (indexes.empty()) {
+    rows.AddRange(0, size());
+    return rows;
+  }
+  // Smallest first, so every intersection after it is cheap.
+  std::ranges::sort(indexes, {}, &RoaringBitmap::Cardinality);
+  rows = *indexes[0];
+  for (u64 i = 1; i < indexes.size() && !rows.empty(); ++i) {
+    rows &= *indexes[i];
+  }
+  return rows;
+}
+
+const Rollup &TaskStore::LabelRollup(const u32 label) const {
+  const auto it = label_rollups_.find(label);
+  return it == label_rollups_.end() ? no_rollup_ : it->second;
+}
+
+void TaskStore::SetNow(const DateTime now) {
+  if (now < now_) {
+    // Rows overdue at now_ aren't in `due_rows_`, so only a scan finds the
+    // ones that aren't overdue at `now`.
+    for (u64 row = 0; row < size(); ++row) {
+      if (due_handles_[row] != kNotDue || !CanBeOverdue(row)
+          || due_[row] < now) {
+        continue;
+      }
+      ForEachRollup(row, [](Rollup &rollup) { --rollup.overdue; });
+      due_handles_[row] = due_rows_.Push(due_[row], static_cast<u32>(row));
+    }
+  }
+  while (!due_rows_.empty() && due_rows_.top_key() < now) {
+    const u32 row = due_rows_.Pop();
+    due_handles_[row] = kNotDue;
+    ForEachRollup(row, [](Rollup &rollup) { ++rollup.overdue; });
+  }
+  now_ = now;
+}
+
+// The columns are read through local pointers: `mask` holds chars, which
+// may alias anything, so otherwise each vector's data pointer is reloaded
+// after every store and the loops can't be vectorized.
+
+void TaskStore::KeepLabel(const u32 label, const std::span<u8> mask) const {
+  const u64 n = size();
+  const u32 *labels = labels_.data();
+  const u8 *present = present_.data();
+  u8 *out = mask.data();
+  for (u64 i = 0; i < n; ++i) {
+    out[i] &= (labels[i] == label) & ((present[i] & kLabel) != 0);
+  }
+}
+
+void TaskStore::KeepDueBetween(const DateTime from, const DateTime to,
+                               const std::span<u8> mask) const {
+  const u64 n = size();
+  const DateTime *due = due_.data();
+  const u8 *present = present_.data();
+  u8 *out = mask.data();
+  for (u64 i = 0; i < n; ++i) {
+    out[i] &= (from <= due[i]) & (due[i] < to) & ((present[i] & kDates) != 0);
+  }
+}
+
+void TaskStore::KeepCompletionBetween(const f64 min, const f64 max,
+                                      const std::span<u8> mask) const {
+  const u64 n = size();
+  const f64 *completion = completion_.data();
+  const u8 *present = present_.data();
+  u8 *out = mask.data();
+  for (u64 i = 0; i < n; ++i) {
+    out[i] &= (min <= completion[i]) & (completion[i] <= max)
+            & ((present[i] & kCompletion) != 0);
+  }
+}
+
+void TaskStore::KeepFlags(const FlagPredicate &predicate,
+                          const std::span<u8> mask) const {
+  predicate.Keep(flag_values_, flag_present_, mask.first(size()));
+}
+
+vector<u32> TaskStore::Rows(const std::span<const u8> mask) {
+  vector<u32> rows;
+  for (u64 i = 0; i < mask.size(); ++i) {
+    if (mask[i]) rows.push_back(static_cast<u32>(i));
+  }
+  return rows;
+}
+
+TaskStore::Text TaskStore::Store(const str_view string) {
+  const u64 offset = text_.size();
+  text_.insert(text_.end(), string.begin(), string.end());
+  return {static_cast<u32>(offset), static_cast<u32>(string.size())};
+}
+
+u64 TaskStore::TextSize(const u64 row) const {
+  return names_[row].size + (present_[row] & kDesc ? descs_[row].size : 0);
+}
+
+void TaskStore::MaybeCompactText() {
+  if (garbage_ <= text_.size() / 2) return;
+  pmr::vector<char> text(text_.get_allocator());
+  text.reserve(text_.size() - garbage_);
+  const auto copy = [&](Text &string) {
+    const u64 offset = text.size();
+    text.insert(text.end(), text_.begin() + string.offset,
+                text_.begin() + string.offset + string.size);
+    string.offset = static_cast<u32>(offset);
+  };
+  for (u64 row = 0; row < size(); ++row) {
+    copy(names_[row]);
+    if (present_[row] & kDesc) copy(descs_[row]);
+  }
+  text_ = std::move(text);
+  garbage_ = 0;
+}
+
+void TaskStore::Write(const u64 row, const Task::Fields &task,
+                      const s32 weight) {
+  u8 present = 0;
+  names_[row] = Store(task.name);
+  if (task.desc) {
+    descs_[row] = Store(*task.desc);
+    present |= kDesc;
+  } else {
+    descs_[row] = {0, 0};
+  }
+  labels_[row] = task.label.value_or(0);
+  if (task.label) present |= kLabel;
+  weights_[row] = weight;
+  if (const opt<Task::Dates> &dates = task.dates) {
+    present |= kDates;
+    if (dates->start_by()) present |= kStartBy;
+    start_by_[row] = dates->start_by().value_or(DateTime());
+    finish_by_[row] = dates->finish_by();
+    due_[row] = dates->due();
+  } else {
+    start_by_[row] = DateTime();
+    finish_by_[row] = DateTime();
+    due_[row] = DateTime();
+  }
+  completion_[row] = task.completion.value_or(0.0);
+  if (task.completion) present |= kCompletion;
+  present_[row] = present;
+  flag_values_[row] = task.flags.values();
+  flag_present_[row] = task.flags.present();
+}
+
+void TaskStore::Index(const u64 row) {
+  if (present_[row] & kLabel) label_rows_[labels_[row]].Add(row);
+  for (u64 flags = flag_present_[row]; flags != 0; flags &= flags - 1) {
+    const u32 flag = std::countr_zero(flags);
+    flag_rows_[2 * flag + (flag_values_[row] >> flag & 1)].Add(row);
+  }
+  Tally(row, 1);
+  due_handles_[row] = CanBeOverdue(row) && !(due_[row] < now_)
+                        ? due_rows_.Push(due_[row], static_cast<u32>(row))
+                        : kNotDue;
+}
+
+void TaskStore::Unindex(const u64 row) {
+  if (present_[row] & kLabel) {
+    const auto it = label_rows_.find(labels_[row]);
+    it->second.Remove(row);
+    if (it->second.empty()) label_rows_.erase(it);
+  }
+  for (u64 flags = flag_present_[row]; flags != 0; flags &= flags - 1) {
+    const u32 flag = std::countr_zero(flags);
+    flag_rows_[2 * flag + (flag_values_[row] >> flag & 1)].Remove(row);
+  }
+  Tally(row, -1);
+  if (due_handles_[row] != kNotDue) {
+    due_rows_.Erase(due_handles_[row]);
+    due_handles_[row] = kNotDue;
+  }
+}
+
+void TaskStore::Tally(const u64 row, const s32 sign) {
+  const u8 present = present_[row];
+  const f64 completion = present & kCompletion ? completion_[row] : 0;
+  const f64 weight = weights_[row];
+  const s32 overdue = CanBeOverdue(row) && due_[row] < now_ ? sign : 0;
+  ForEachRollup(row, [&](Rollup &rollup) {
+    rollup.count += sign;
+    // Sums of f64s drift as rows come and go, so an emptied group starts
+    // over from exactly 0.
+    if (rollup.count == 0) {
+      rollup = Rollup();
+      return;
+    }
+    rollup.completion += sign * completion;
+    rollup.weight += sign * weight;
+    rollup.weighted_completion += sign * weight * completion;
+    rollup.overdue += overdue;
+  });
+  if (sign < 0 && present & kLabel) {
+    const auto it = label_rollups_.find(labels_[row]);
+    if (it->second.count == 0) label_rollups_.erase(it);
+  }
+}
+
+bool TaskStore::CanBeOverdue(const u64 row) const {
+  return (present_[row] & kDates)
+      && (!(present_[row] & kCompletion) || completion_[row] < 1);
+}
+
+}  // namespace bee
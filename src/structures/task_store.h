@@ -0,0 +1,296 @@
+#ifndef BOARD_BEE_SRC_STRUCTURES_TASK_STORE_H_
+#define BOARD_BEE_SRC_STRUCTURES_TASK_STORE_H_
+
+#include <aliases.h>
+#include <indexed_heap.h>
+#include <roaring_bitmap.h>
+#include <rose_time.h>
+
+#include <bit>
+#include <iterator>
+#include <memory_resource>
+#include <span>
+
+#include "flags.h"
+#include "task.h"
+
+namespace bee {
+
+class TaskStore;
+
+// One row of a TaskStore, read like a Task. Stays valid until the store
+// is changed.
+class TaskRef {
+ public:
+  TaskRef(const TaskStore *store, const u64 row) : store_(store), row_(row) {}
+
+  u64 row() const { return row_; }
+
+  str_view name() const;
+  opt<str_view> desc() const;
+  // The id of the label, as in Task::label().
+  opt<u32> label() const;
+  // The weight the row counts for in Rollups.
+  s32 weight() const;
+  opt<Task::Dates> dates() const;
+  opt<f64> completion() const;
+  Flags flags() const;
+
+  // Copies this row out into a Task whose storage comes from `alloc`.
+  Task ToTask(const Task::allocator_type &alloc = {}) const;
+
+ private:
+  const TaskStore *store_;
+  u64 row_;
+};
+
+// Totals over a group of Tasks, kept up to date by their TaskStore.
+struct Rollup {
+  // Tasks without a completion count as 0% complete.
+  f64 progress() const { return count == 0 ? 0 : completion / count; }
+  // Mean completion weighted by each Task's weight (see TaskStore::Add).
+  f64 weighted_progress() const {
+    return weight == 0 ? 0 : weighted_completion / weight;
+  }
+
+  u64 count = 0;
+  // Sum of completion.
+  f64 completion = 0;
+  // Sums of weight and of weight times completion.
+  f64 weight = 0;
+  f64 weighted_completion = 0;
+  // Tasks due before the store's now() that aren't complete.
+  u64 overdue = 0;
+};
+
+// Tasks stored column by column: each field of every Task sits in an array
+// of its own, names and descriptions share one pool of characters, and
+// flags are the two words of each Flags. Filtering on one field then reads
+// only that field's array, in loops simple enough to vectorize.
+// Rows are read through TaskRef, and Tasks are added and replaced whole.
+// Labels and flags are also indexed by RoaringBitmaps of row numbers, so
+// "which Tasks have ..." is answered by combining bitmaps without a scan,
+// and summed up in Rollups, so "how are the Tasks with ... doing" is
+// answered without reading any rows.
+class TaskStore {
+ public:
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  class Iterator {
+   public:
+    using value_type = TaskRef;
+    using difference_type = s64;
+
+    Iterator() = default;
+    Iterator(const TaskStore *store, const u64 row)
+        : store_(store), row_(row) {}
+
+    TaskRef operator*() const { return TaskRef(store_, row_); }
+    Iterator &operator++() {
+      ++row_;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old = *this;
+      ++row_;
+      return old;
+    }
+    bool operator==(const Iterator &other) const {
+      return row_ == other.row_;
+    }
+
+   private:
+    const TaskStore *store_ = nullptr;
+    u64 row_ = 0;
+  };
+
+  explicit TaskStore(const allocator_type &alloc = {});
+
+  allocator_type get_allocator() const { return names_.get_allocator(); }
+
+  u64 size() const { return names_.size(); }
+  bool empty() const { return names_.empty(); }
+  u64 capacity() const { return names_.capacity(); }
+  // Makes room for `rows` Tasks in every column.
+  void reserve(u64 rows);
+
+  TaskRef operator[](const u64 row) const { return TaskRef(this, row); }
+  Iterator begin() const { return Iterator(this, 0); }
+  Iterator end() const { return Iterator(this, size()); }
+
+  // Appends `task` as a new row, weighing `weight` in Rollups. Its label
+  // and flags keep their ids, so every Task in a store should number them
+  // by the same LabelTable and FlagTable.
+  void Add(const Task::Fields &task, s32 weight = 1);
+  void Add(const Task &task, const s32 weight = 1) {
+    Add(task.fields(), weight);
+  }
+  // Overwrites row `row` with `task`, weighing `weight`.
+  void Replace(u64 row, const Task::Fields &task, s32 weight = 1);
+  void Replace(const u64 row, const Task &task, const s32 weight = 1) {
+    Replace(row, task.fields(), weight);
+  }
+  // Removes row `row`, moving the last row into its place.
+  void Remove(u64 row);
+
+  // Indexes, kept up to date by Add, Replace and Remove. Combine them with
+  // RoaringBitmap's &, | and -; e.g. a Kanban column for label `l` is
+  //   store.WithLabel(l) & store.Matching(FlagPredicate().Require(done, 0))
+
+  // Rows with the label whose id is `label`.
+  const rose::RoaringBitmap &WithLabel(u32 label) const;
+  // Rows whose flag with id `flag` is `value`.
+  const rose::RoaringBitmap &WithFlag(u32 flag, bool value) const;
+  // Rows whose flags pass `predicate`: the intersection of the WithFlag
+  // indexes it tests, or every row if it tests none.
+  rose::RoaringBitmap Matching(const FlagPredicate &predicate) const;
+  // Each label in use, with its rows; their sizes are the label counts.
+  const pmr::HashMap<u32, rose::RoaringBitmap> &label_index() const {
+    return label_rows_;
+  }
+
+  // Rollups, kept up to date by Add, Replace and Remove in constant time
+  // per label and flag, and read in constant time. A Task weighs what it
+  // was added with: on a Board, its label's weight, or 1 without one.
+
+  // Every row.
+  const Rollup &total() const { return total_; }
+  // Rows with the label whose id is `label`.
+  const Rollup &LabelRollup(u32 label) const;
+  // Rows whose flag with id `flag` is `value`.
+  const Rollup &FlagRollup(const u32 flag, const bool value) const {
+    return flag_rollups_[2 * flag + value];
+  }
+  const pmr::HashMap<u32, Rollup> &label_rollups() const {
+    return label_rollups_;
+  }
+
+  // The time overdue counts are as of; the epoch until SetNow is called.
+  rose::time::DateTime now() const { return now_; }
+  // Moves now() to `now`. Going forward only touches the Tasks that fall
+  // due in between, in order of due date; going back rescans every row.
+  void SetNow(rose::time::DateTime now);
+
+  // Each Keep* function clears mask[i] for every row i that doesn't pass,
+  // so filters can be chained over one mask of size() entries that starts
+  // out all ones. Each is a branch-free loop over one or two columns.
+
+  // Keeps the Tasks with the label whose id is `label`.
+  void KeepLabel(u32 label, std::span<u8> mask) const;
+  // Keeps the Tasks due in [from, to).
+  void KeepDueBetween(rose::time::DateTime from, rose::time::DateTime to,
+                      std::span<u8> mask) const;
+  // Keeps the Tasks whose completion is on [min, max].
+  void KeepCompletionBetween(f64 min, f64 max, std::span<u8> mask) const;
+  // Keeps the Tasks whose flags pass `predicate`.
+  void KeepFlags(const FlagPredicate &predicate, std::span<u8> mask) const;
+  // Returns the rows whose entry in `mask` is set.
+  static vector<u32> Rows(std::span<const u8> mask);
+
+ private:
+  friend class TaskRef;
+
+  // Bits of `present_`.
+  enum Field : u8 {
+    kDesc = 1,
+    kLabel = 2,
+    kDates = 4,
+    kStartBy = 8,
+    kCompletion = 16
+  };
+
+  // In `due_handles_`, for rows not in `due_rows_`.
+  static constexpr u32 kNotDue = ~u32{0};
+
+  // A string in `text_`.
+  struct Text {
+    u32 offset;
+    u32 size;
+  };
+
+  // Copies `string` into `text_`.
+  Text Store(str_view string);
+  str_view View(const Text text) const {
+    return str_view(text_.data() + text.offset, text.size);
+  }
+  // Characters of row `row` in `text_`.
+  u64 TextSize(u64 row) const;
+  // Rebuilds `text_` without the characters no row refers to, once they're
+  // most of it.
+  void MaybeCompactText();
+
+  // Calls `f(column)` for every column.
+  template <typename F>
+  void ForEachColumn(F &&f) {
+    f(names_);
+    f(descs_);
+    f(labels_);
+    f(weights_);
+    f(present_);
+    f(start_by_);
+    f(finish_by_);
+    f(due_);
+    f(completion_);
+    f(flag_values_);
+    f(flag_present_);
+    f(due_handles_);
+  }
+  // Sets the columns of row `row` from `task` and `weight`.
+  void Write(u64 row, const Task::Fields &task, s32 weight);
+  // Adds row `row` to the indexes and rollups, or removes it from them.
+  void Index(u64 row);
+  void Unindex(u64 row);
+  // Calls `f(rollup)` for each Rollup row `row` counts towards.
+  template <typename F>
+  void ForEachRollup(const u64 row, F &&f) {
+    f(total_);
+    if (present_[row] & kLabel) f(label_rollups_[labels_[row]]);
+    for (u64 flags = flag_present_[row]; flags != 0; flags &= flags - 1) {
+      const u32 flag = std::countr_zero(flags);
+      f(flag_rollups_[2 * flag + (flag_values_[row] >> flag & 1)]);
+    }
+  }
+  // Adds `sign` times row `row` to each of its Rollups.
+  void Tally(u64 row, s32 sign);
+  // Returns true if row `row` has dates and completion below 1, and so
+  // can be overdue.
+  bool CanBeOverdue(u64 row) const;
+
+  pmr::vector<char> text_;
+  // Characters in `text_` that no row refers to anymore.
+  u64 garbage_ = 0;
+  pmr::vector<Text> names_;
+  pmr::vector<Text> descs_;
+  pmr::vector<u32> labels_;
+  pmr::vector<s32> weights_;
+  // Which of the optional fields each row has, as Fields.
+  pmr::vector<u8> present_;
+  pmr::vector<rose::time::DateTime> start_by_;
+  pmr::vector<rose::time::DateTime> finish_by_;
+  pmr::vector<rose::time::DateTime> due_;
+  pmr::vector<f64> completion_;
+  // Flags::values() and Flags::present() of each row.
+  pmr::vector<u64> flag_values_;
+  pmr::vector<u64> flag_present_;
+
+  pmr::HashMap<u32, rose::RoaringBitmap> label_rows_;
+  // Rows whose flag i is false at 2 * i, and true at 2 * i + 1.
+  pmr::vector<rose::RoaringBitmap> flag_rows_;
+  // Returned for labels no row has.
+  rose::RoaringBitmap no_rows_;
+
+  // Laid out like `label_rows_` and `flag_rows_`.
+  Rollup total_;
+  pmr::HashMap<u32, Rollup> label_rollups_;
+  pmr::vector<Rollup> flag_rollups_;
+  Rollup no_rollup_;
+  rose::time::DateTime now_;
+  // Rows that can be overdue but aren't yet, by due date, and each row's
+  // handle in it (or kNotDue).
+  rose::IndexedHeap<rose::time::DateTime, u32> due_rows_;
+  pmr::vector<u32> due_handles_;
+};
+
+}  // namespace bee
+
+#endif  // BOARD_BEE_SRC_STRUCTURES_TASK_STORE_H_
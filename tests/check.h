@@ -0,0 +1,24 @@
+#ifndef BOARD_BEE_TESTS_CHECK_H_
+#define BOARD_BEE_TESTS_CHECK_H_
+
+#include <cstdio>
+#include <cstdlib>
+#include <source_location>
+
+namespace bee::test {
+
+// Ends the test with a failure, naming the caller's line, unless
+// `condition` holds. Tests are seeded, so the same line fails again on the
+// next run.
+inline void Check(const bool condition,
+                  const std::source_location where =
+                      std::source_location::current()) {
+  if (condition) return;
+  std::fprintf(stderr, "%s:%u: check failed\n", where.file_name(),
+               where.line());
+  std::exit(1);
+}
+
+}  // namespace bee::test
+
+#endif  // BOARD_BEE_TESTS_CHECK_H_
@@ -0,0 +1,94 @@
+#include <aliases.h>
+#include <arena_allocator.h>
+#include <concurrent_arena.h>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <thread>
+
+#include "check.h"
+
+using bee::test::Check;
+using rose::ArenaAllocator;
+using rose::ConcurrentArena;
+
+namespace {
+
+constexpr u32 kThreads = 8;
+
+// A block a thread got, and the byte it filled it with.
+struct Block {
+  uintptr_t address;
+  size_t bytes;
+  size_t alignment;
+  u8 fill;
+};
+
+// Allocates from `pool` as thread `thread` would: straight from the pool,
+// through its own Local() arena, and now and then more than a slab.
+vector<Block> Hammer(ConcurrentArena &pool, const u32 thread, const u32 round,
+                     const u32 steps) {
+  std::mt19937_64 rng(round * kThreads + thread + 1);
+  ArenaAllocator &local = pool.Local();
+  vector<Block> blocks;
+  for (u32 step = 0; step < steps; ++step) {
+    const size_t alignment = size_t{1} << rng() % 8;
+    const u64 kind = rng() % 64;
+    const size_t bytes = kind == 0 ? 70000 + rng() % 10000 : 1 + rng() % 300;
+    void *memory;
+    if (kind % 2) {
+      Check(&pool.Local() == &local);
+      memory = local.AllocateBytes(bytes, alignment);
+    } else {
+      memory = pool.allocate(bytes, alignment);
+    }
+    // Whoever else got these bytes would overwrite this.
+    const u8 fill = static_cast<u8>(thread * 31 + step);
+    std::memset(memory, fill, bytes);
+    blocks.push_back({reinterpret_cast<uintptr_t>(memory), bytes, alignment,
+                      fill});
+  }
+  return blocks;
+}
+
+void CheckBlocks(vector<Block> &blocks) {
+  std::ranges::sort(blocks, {}, &Block::address);
+  for (u64 i = 0; i < blocks.size(); ++i) {
+    const Block &block = blocks[i];
+    Check(block.address % block.alignment == 0);
+    if (i + 1 < blocks.size()) {
+      Check(block.address + block.bytes <= blocks[i + 1].address);
+    }
+    const auto *bytes = reinterpret_cast<const u8 *>(block.address);
+    Check(std::all_of(bytes, bytes + block.bytes,
+                      [&](const u8 byte) { return byte == block.fill; }));
+  }
+}
+
+}  // namespace
+
+int main() {
+  // Small slabs and regions, so threads race to grow the pool.
+  ConcurrentArena pool(64 * 1024, 4 * 1024);
+  for (u32 round = 0; round < 4; ++round) {
+    vector<vector<Block>> per_thread(kThreads);
+    vector<std::thread> threads;
+    for (u32 thread = 0; thread < kThreads; ++thread) {
+      threads.emplace_back([&, thread] {
+        per_thread[thread] = Hammer(pool, thread, round, 10000);
+      });
+    }
+    // This thread's arena, which must be made anew after each Reset.
+    const vector<Block> own = Hammer(pool, kThreads, round, 2000);
+    for (std::thread &thread : threads) thread.join();
+
+    vector<Block> blocks = own;
+    for (const vector<Block> &thread_blocks : per_thread) {
+      blocks.insert(blocks.end(), thread_blocks.begin(), thread_blocks.end());
+    }
+    CheckBlocks(blocks);
+    pool.Reset();
+  }
+  return 0;
+}
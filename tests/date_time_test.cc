@@ -0,0 +1,418 @@
+#include <aliases.h>
+#include <rose_time.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iterator>
+#include <random>
+
+#include "check.h"
+
+using bee::test::Check;
+using namespace rose::time;
+using namespace rose::time::literals;
+
+namespace {
+
+std::mt19937_64 rng(1);
+
+constexpr s64 kFirstSecond = -62167219200;  // 0000-01-01T00:00:00Z
+constexpr s64 kLastSecond = 253402300799;   // 9999-12-31T23:59:59Z
+
+// Every day that ended with a leap second.
+constexpr const char *kLeapSecondDays[] = {
+    "1972-06-30", "1972-12-31", "1973-12-31", "1974-12-31", "1975-12-31",
+    "1976-12-31", "1977-12-31", "1978-12-31", "1979-12-31", "1981-06-30",
+    "1982-06-30", "1983-06-30", "1985-06-30", "1987-12-31", "1989-12-31",
+    "1990-12-31", "1992-06-30", "1993-06-30", "1994-06-30", "1995-12-31",
+    "1997-06-30", "1998-12-31", "2005-12-31", "2008-12-31", "2012-06-30",
+    "2015-06-30", "2016-12-31"};
+
+s64 RandomSecond(const s64 first = kFirstSecond,
+                 const s64 last = kLastSecond) {
+  return first + static_cast<s64>(rng() % (last - first + 1));
+}
+
+// The civil fields of `seconds`, as gmtime reads them.
+std::tm Civil(const s64 seconds) {
+  const std::time_t time = seconds;
+  std::tm fields{};
+  gmtime_r(&time, &fields);
+  return fields;
+}
+
+// Returns `fields` as YYYY-MM-DDTHH:MM:SS followed by `suffix`.
+str IsoString(const std::tm &fields, const str_view suffix) {
+  char out[96];
+  std::snprintf(out, sizeof(out), "%04d-%02d-%02dT%02d:%02d:%02d",
+                fields.tm_year + 1900, fields.tm_mon + 1, fields.tm_mday,
+                fields.tm_hour, fields.tm_min, fields.tm_sec);
+  return out + str(suffix);
+}
+
+// Returns `minutes` east of UTC as +HH:MM or -HH:MM.
+str OffsetString(const s32 minutes) {
+  char out[32];
+  std::snprintf(out, sizeof(out), "%c%02d:%02d", minutes < 0 ? '-' : '+',
+                std::abs(minutes) / 60, std::abs(minutes) % 60);
+  return out;
+}
+
+// Returns the seconds since the epoch `iso_string` names, read one field at
+// a time, or nullopt if it isn't valid. Only takes strings ending in Z.
+opt<s64> SlowParse(const str_view iso_string) {
+  constexpr str_view kLayout = "DDDD-DD-DDTDD:DD:DDZ";
+  if (iso_string.size() != kLayout.size()) return std::nullopt;
+  for (u64 i = 0; i < kLayout.size(); ++i) {
+    const char c = iso_string[i];
+    const bool ok = kLayout[i] == 'D' ? c >= '0' && c <= '9' : c == kLayout[i];
+    if (!ok) return std::nullopt;
+  }
+  const auto number = [&](const u64 at, const u64 digits) {
+    s32 n = 0;
+    for (u64 i = at; i < at + digits; ++i) n = n * 10 + (iso_string[i] - '0');
+    return n;
+  };
+  const s32 year = number(0, 4);
+  const s32 month = number(5, 2);
+  const s32 day = number(8, 2);
+  const s32 hour = number(11, 2);
+  const s32 minute = number(14, 2);
+  const s32 second = number(17, 2);
+  if (month < 1 || month > 12 || hour > 23 || minute > 59 || second > 60) {
+    return std::nullopt;
+  }
+  const s64 first_of_month = DaysFromCivil(year, month, 1);
+  const s64 first_of_next = month == 12 ? DaysFromCivil(year + 1, 1, 1)
+                                        : DaysFromCivil(year, month + 1, 1);
+  if (day < 1 || day > first_of_next - first_of_month) return std::nullopt;
+  if (second == 60) {
+    const str_view date = iso_string.substr(0, 10);
+    const bool leap_day = std::ranges::find(kLeapSecondDays, date)
+                       != std::end(kLeapSecondDays);
+    if (!leap_day || hour != 23 || minute != 59) return std::nullopt;
+  }
+  return (first_of_month + day - 1) * Duration::kSecondsPerDay
+       + hour * 3600 + minute * 60 + std::min(second, 59);
+}
+
+void CheckParsing() {
+  for (u32 i = 0; i < 100000; ++i) {
+    const s64 seconds = RandomSecond();
+    const std::tm fields = Civil(seconds);
+    const opt<DateTime> utc = DateTime::Parse(IsoString(fields, "Z"));
+    Check(utc && utc->seconds_since_epoch() == seconds);
+    Check(!utc->is_leap_second());
+
+    // The same instant written in local time somewhere else.
+    const s32 offset = static_cast<s32>(rng() % 2879) - 1439;
+    const s64 local = seconds + offset * 60;
+    if (local < kFirstSecond || local > kLastSecond) continue;
+    const str with_offset = IsoString(Civil(local), OffsetString(offset));
+    const opt<DateTime> offset_utc = DateTime::Parse(with_offset);
+    Check(offset_utc && *offset_utc == *utc);
+  }
+
+  // Damaged strings parse exactly when a field-by-field reading does.
+  constexpr str_view kAlphabet = "0123456789-:TZ+ x";
+  for (u32 i = 0; i < 100000; ++i) {
+    str iso_string = IsoString(Civil(RandomSecond()), "Z");
+    for (u64 changes = 1 + rng() % 2; changes-- > 0;) {
+      iso_string[rng() % iso_string.size()] =
+          kAlphabet[rng() % kAlphabet.size()];
+    }
+    if (rng() % 10 == 0) iso_string.replace(17, 2, "60");
+    const opt<DateTime> parsed = DateTime::Parse(iso_string);
+    const opt<s64> expected = SlowParse(iso_string);
+    Check(parsed.has_value() == expected.has_value());
+    if (parsed) Check(parsed->seconds_since_epoch() == *expected);
+  }
+
+  // Every leap second, written in UTC and an hour ahead of it.
+  for (const str_view day : kLeapSecondDays) {
+    const opt<DateTime> utc = DateTime::Parse(str(day) + "T23:59:60Z");
+    Check(utc && utc->is_leap_second());
+    const s64 next_day = utc->days_since_epoch() + 1;
+    const str ahead = IsoString(Civil(next_day * Duration::kSecondsPerDay),
+                                "+01:00")
+                          .replace(14, 5, "59:60");
+    Check(DateTime::Parse(ahead) == utc);
+  }
+
+  struct Case {
+    const char *iso_string;
+    ParseError error;
+  };
+  constexpr Case kCases[] = {
+      {"2024-02-29T12:00:00Z", ParseError::kNone},
+      {"2024-02-29T12:00:00-05:30", ParseError::kNone},
+      {"2024-01-01T00:00:00+23:59", ParseError::kNone},
+      {"2024-01-01 00:00:00Z", ParseError::kLayout},
+      {"2024-01-01T00:00:00", ParseError::kLayout},
+      {"2024-01-01T00:00:00z", ParseError::kLayout},
+      {"2024-01-01T00:00:00*01:00", ParseError::kLayout},
+      {"2024-01-01T00:00:00+0100", ParseError::kLayout},
+      {"2024-13-01T00:00:00Z", ParseError::kMonth},
+      {"2024-00-01T00:00:00Z", ParseError::kMonth},
+      {"2023-02-29T00:00:00Z", ParseError::kDay},
+      {"2024-04-31T00:00:00Z", ParseError::kDay},
+      {"2024-01-01T24:00:00Z", ParseError::kHour},
+      {"2024-01-01T00:60:00Z", ParseError::kMinute},
+      {"2024-01-01T00:00:61Z", ParseError::kSecond},
+      {"2017-12-31T23:59:60Z", ParseError::kLeapSecond},
+      {"2016-12-31T23:58:60Z", ParseError::kLeapSecond},
+      {"2016-12-31T23:59:60+01:00", ParseError::kLeapSecond},
+      {"2024-01-01T00:00:00+24:00", ParseError::kOffset},
+      {"2024-01-01T00:00:00-01:60", ParseError::kOffset},
+  };
+  vector<str_view> strings;
+  for (const Case &test : kCases) {
+    ParseError error = ParseError::kNone;
+    const opt<DateTime> parsed = DateTime::Parse(test.iso_string, &error);
+    Check(error == test.error);
+    Check(parsed.has_value() == (test.error == ParseError::kNone));
+    Check(!DateTime::ErrorMessage(test.iso_string, error).empty());
+    strings.push_back(test.iso_string);
+  }
+
+  // ParseAll agrees with Parse string by string.
+  vector<opt<DateTime>> parsed(strings.size());
+  const u64 count = DateTime::ParseAll(strings, parsed);
+  u64 expected_count = 0;
+  for (u64 i = 0; i < strings.size(); ++i) {
+    Check(parsed[i] == DateTime::Parse(strings[i]));
+    expected_count += parsed[i].has_value();
+  }
+  Check(count == expected_count);
+}
+
+// Checks that the fields computed from the packed value agree with gmtime.
+void CheckFields() {
+  for (u32 i = 0; i < 100000; ++i) {
+    const s64 seconds = RandomSecond();
+    const DateTime date_time = DateTime::FromSecondsSinceEpoch(seconds);
+    const std::tm fields = Civil(seconds);
+    Check(date_time.seconds_since_epoch() == seconds);
+    Check(date_time.year() == fields.tm_year + 1900);
+    Check(date_time.month() == fields.tm_mon + 1);
+    Check(date_time.day() == fields.tm_mday);
+    Check(date_time.hour() == fields.tm_hour);
+    Check(date_time.minute() == fields.tm_min);
+    Check(date_time.second() == fields.tm_sec);
+    Check(date_time.weekday() == static_cast<Weekday>(fields.tm_wday));
+    Check(date_time.day_of_year() == fields.tm_yday + 1);
+    Check(static_cast<s32>(date_time.second_of_day())
+          == fields.tm_hour * 3600 + fields.tm_min * 60 + fields.tm_sec);
+
+    const s64 days = date_time.days_since_epoch();
+    const CivilDate civil = CivilFromDays(days);
+    Check(DaysFromCivil(civil.year, civil.month, civil.day) == days);
+    // The length of the month, from gmtime's reading of its last day.
+    const s64 first_of_next =
+        DaysFromCivil(civil.year + (civil.month == 12), civil.month % 12 + 1,
+                      1);
+    Check(date_time.DaysInMonth()
+          == Civil((first_of_next - 1) * Duration::kSecondsPerDay).tm_mday);
+    Check(date_time.IsLeapYear()
+          == (Civil(DaysFromCivil(civil.year, 3, 1) * Duration::kSecondsPerDay
+                    - 1)
+                  .tm_mday
+              == 29));
+
+    // Packed values order and subtract like the instants they stand for.
+    const s64 other_seconds = RandomSecond();
+    const DateTime other = DateTime::FromSecondsSinceEpoch(other_seconds);
+    Check((date_time < other) == (seconds < other_seconds));
+    Check((date_time == other) == (seconds == other_seconds));
+    Check((other - date_time).seconds() == other_seconds - seconds);
+    Check(date_time + (other - date_time) == other);
+  }
+
+  // A leap second sorts between the seconds around it, and counts as the
+  // second before it in arithmetic.
+  const DateTime before = DateTime("2016-12-31T23:59:59Z");
+  const DateTime leap = DateTime("2016-12-31T23:59:60Z");
+  const DateTime after = DateTime("2017-01-01T00:00:00Z");
+  Check(before < leap && leap < after);
+  Check(leap.is_leap_second() && !before.is_leap_second());
+  Check(leap.second() == 60 && leap.minute() == 59 && leap.hour() == 23);
+  Check(leap.day() == 31 && leap.HasLeapSecond());
+  Check((leap - before).seconds() == 0 && (after - leap).seconds() == 1);
+  Check(leap + Duration::Seconds(1) == after);
+  Check(leap.seconds_since_epoch() == before.seconds_since_epoch());
+}
+
+// Literals and constexpr parsing are checked as they compile.
+static_assert("1970-01-01T00:00:00Z"_dt == DateTime());
+static_assert("2000-03-01T12:30:00+05:30"_dt
+              == DateTime::FromSecondsSinceEpoch(951894000));
+static_assert("0000-01-01T00:00:00Z"_dt.seconds_since_epoch() == kFirstSecond);
+static_assert("9999-12-31T23:59:59Z"_dt.seconds_since_epoch() == kLastSecond);
+static_assert("2016-12-31T23:59:60Z"_dt.is_leap_second());
+static_assert("2016-12-31T23:59:60Z"_dt.second() == 60);
+static_assert("2024-02-29T00:00:00Z"_dt.weekday() == Weekday::kThursday);
+static_assert(DateTime("1969-12-31T23:59:59Z").seconds_since_epoch() == -1);
+static_assert(!DateTime::Parse("2017-12-31T23:59:60Z"));
+static_assert(!DateTime::IsValidDateTime("2023-02-29T00:00:00Z"));
+static_assert(DateTime::IsValidDateTime("2023-02-28T00:00:00-23:59"));
+
+// Checks that parsing at run time gives the same DateTimes as the literals.
+void CheckLiterals() {
+  constexpr DateTime kLiterals[] = {
+      "1970-01-01T00:00:00Z"_dt, "2000-03-01T12:30:00+05:30"_dt,
+      "0000-01-01T00:00:00Z"_dt, "9999-12-31T23:59:59Z"_dt,
+      "2016-12-31T23:59:60Z"_dt, "1900-02-28T23:00:00-01:00"_dt};
+  constexpr const char *kStrings[] = {
+      "1970-01-01T00:00:00Z", "2000-03-01T12:30:00+05:30",
+      "0000-01-01T00:00:00Z", "9999-12-31T23:59:59Z",
+      "2016-12-31T23:59:60Z", "1900-02-28T23:00:00-01:00"};
+  for (u64 i = 0; i < std::size(kLiterals); ++i) {
+    Check(DateTime(str(kStrings[i])) == kLiterals[i]);
+  }
+}
+
+// Returns what `format` should print for `fields`, built with snprintf.
+str Expected(const std::tm &fields, const DateTimeFormat format) {
+  char date[48];
+  char time[48];
+  std::snprintf(date, sizeof(date), "%04d%02d%02d", fields.tm_year + 1900,
+                fields.tm_mon + 1, fields.tm_mday);
+  std::snprintf(time, sizeof(time), "%02d%02d%02d", fields.tm_hour,
+                fields.tm_min, fields.tm_sec);
+  const str d(date);
+  const str t(time);
+  const str iso_date = d.substr(0, 4) + '-' + d.substr(4, 2) + '-'
+                     + d.substr(6, 2);
+  const str iso_time = 'T' + t.substr(0, 2) + ':' + t.substr(2, 2) + ':'
+                     + t.substr(4, 2) + 'Z';
+  switch (format) {
+    case DateTimeFormat::kIso: return iso_date + iso_time;
+    case DateTimeFormat::kCompact: return d + 'T' + t + 'Z';
+    case DateTimeFormat::kIsoDate: return iso_date;
+    case DateTimeFormat::kCompactDate: return d;
+    case DateTimeFormat::kIsoTime: return iso_time;
+    case DateTimeFormat::kCompactTime: return 'T' + t + 'Z';
+  }
+  return "";
+}
+
+void CheckFormatting() {
+  constexpr DateTimeFormat kFormats[] = {
+      DateTimeFormat::kIso,     DateTimeFormat::kCompact,
+      DateTimeFormat::kIsoDate, DateTimeFormat::kCompactDate,
+      DateTimeFormat::kIsoTime, DateTimeFormat::kCompactTime};
+  for (const DateTimeFormat format : kFormats) {
+    const u64 length = FormattedLength(format);
+    vector<DateTime> date_times;
+    str expected_all;
+    for (u32 i = 0; i < 20000; ++i) {
+      const s64 seconds = RandomSecond();
+      const DateTime date_time = DateTime::FromSecondsSinceEpoch(seconds);
+      const str expected = Expected(Civil(seconds), format);
+      Check(expected.size() == length);
+      char out[32];
+      const std::to_chars_result result = date_time.ToChars(out, format);
+      Check(result.ec == std::errc() && result.ptr == out + length);
+      Check(str_view(out, length) == expected);
+      date_times.push_back(date_time);
+      expected_all += expected;
+    }
+    // FormatAll lays the same strings end to end, or writes nothing if
+    // they don't fit.
+    str all(expected_all.size(), '?');
+    Check(DateTime::FormatAll(date_times, all, format) == all.size());
+    Check(all == expected_all);
+    str short_out(expected_all.size() - 1, '?');
+    Check(DateTime::FormatAll(date_times, short_out, format) == 0);
+    Check(short_out == str(short_out.size(), '?'));
+
+    char too_short[32];
+    std::ranges::fill(too_short, '?');
+    const std::to_chars_result result = date_times[0].ToChars(
+        std::span<char>(too_short, length - 1), format);
+    Check(result.ec == std::errc::value_too_large);
+    Check(static_cast<u64>(std::ranges::count(too_short, '?'))
+          == std::size(too_short));
+  }
+
+  // Printing and parsing round-trip, leap seconds included.
+  for (u32 i = 0; i < 20000; ++i) {
+    const DateTime date_time = DateTime::FromSecondsSinceEpoch(RandomSecond());
+    Check(DateTime(date_time.AsNiceString()) == date_time);
+  }
+  const DateTime leap("2016-12-31T23:59:60Z");
+  Check(leap.AsNiceString() == "2016-12-31T23:59:60Z");
+  Check(leap.AsString() == "20161231T235960Z");
+  Check(leap.NiceTimeString() == "T23:59:60Z");
+  Check(leap.TimeString() == "T235960Z");
+  Check(leap.NiceDateString() == "2016-12-31");
+  Check(leap.DateString() == "20161231");
+}
+
+// Checks that offsets can't carry a time outside the years that can be
+// printed.
+void CheckRange() {
+  struct Case {
+    const char *iso_string;
+    ParseError error;
+  };
+  constexpr Case kCases[] = {
+      {"0000-01-01T00:00:00Z", ParseError::kNone},
+      {"0000-01-01T00:00:00-00:01", ParseError::kNone},
+      {"0000-01-01T00:00:00+00:00", ParseError::kNone},
+      {"0000-01-01T00:00:00+00:01", ParseError::kRange},
+      {"0000-01-01T00:00:00+01:00", ParseError::kRange},
+      {"0000-01-01T23:58:59+23:59", ParseError::kRange},
+      {"0000-01-01T23:59:00+23:59", ParseError::kNone},
+      {"9999-12-31T23:59:59Z", ParseError::kNone},
+      {"9999-12-31T23:59:59+00:01", ParseError::kNone},
+      {"9999-12-31T23:59:59-00:00", ParseError::kNone},
+      {"9999-12-31T23:59:59-00:01", ParseError::kRange},
+      {"9999-12-31T23:59:59-23:59", ParseError::kRange},
+      {"9999-12-31T00:00:59-23:59", ParseError::kNone},
+      {"9999-12-31T00:01:00-23:59", ParseError::kRange},
+  };
+  for (const Case &test : kCases) {
+    ParseError error = ParseError::kNone;
+    const opt<DateTime> parsed = DateTime::Parse(test.iso_string, &error);
+    Check(error == test.error);
+    Check(parsed.has_value() == (test.error == ParseError::kNone));
+    if (!parsed) continue;
+    // Whatever parses prints as a real date.
+    const str printed = parsed->AsNiceString();
+    Check(DateTime::Parse(printed) == parsed);
+    Check(printed == IsoString(Civil(parsed->seconds_since_epoch()), "Z"));
+  }
+
+  // Near either end, a time with an offset parses exactly when it lands in
+  // range.
+  for (u32 i = 0; i < 100000; ++i) {
+    const bool low = rng() % 2;
+    const s64 local =
+        low ? RandomSecond(kFirstSecond, kFirstSecond + 2 * 86400)
+            : RandomSecond(kLastSecond - 2 * 86400, kLastSecond);
+    const s32 offset = static_cast<s32>(rng() % 2879) - 1439;
+    const s64 utc = local - offset * 60;
+    const str iso_string = IsoString(Civil(local), OffsetString(offset));
+    ParseError error = ParseError::kNone;
+    const opt<DateTime> parsed = DateTime::Parse(iso_string, &error);
+    if (utc < kFirstSecond || utc > kLastSecond) {
+      Check(!parsed && error == ParseError::kRange);
+    } else {
+      Check(parsed && parsed->seconds_since_epoch() == utc);
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  CheckParsing();
+  CheckFields();
+  CheckLiterals();
+  CheckFormatting();
+  CheckRange();
+  return 0;
+}
@@ -0,0 +1,106 @@
+#include <aliases.h>
+#include <rose_time.h>
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+
+#include "check.h"
+#include "src/structures/board.h"
+#include "src/structures/deadline_scheduler.h"
+#include "src/structures/task.h"
+
+using bee::Board;
+using bee::Deadline;
+using bee::DeadlineScheduler;
+using bee::Flags;
+using bee::Milestone;
+using bee::Task;
+using bee::test::Check;
+using rose::time::DateTime;
+using rose::time::Duration;
+
+namespace {
+
+std::mt19937_64 rng(1);
+
+// A milestone as (when, task, milestone), which sorts like PopExpired.
+using Entry = std::tuple<DateTime, u32, Milestone>;
+
+opt<Task::Dates> RandomDates() {
+  if (rng() % 4 == 0) return std::nullopt;
+  const DateTime finish_by = DateTime::FromSecondsSinceEpoch(rng() % 1000);
+  const DateTime due = finish_by + Duration::Seconds(rng() % 100);
+  if (rng() % 2) return Task::Dates(finish_by, due);
+  return Task::Dates(finish_by - Duration::Seconds(rng() % 100), finish_by,
+                     due);
+}
+
+vector<Entry> Milestones(const vector<opt<Task::Dates>> &model) {
+  vector<Entry> entries;
+  for (u32 task = 0; task < model.size(); ++task) {
+    if (!model[task]) continue;
+    const Task::Dates &dates = *model[task];
+    if (dates.start_by()) {
+      entries.emplace_back(*dates.start_by(), task, Milestone::kStartBy);
+    }
+    entries.emplace_back(dates.finish_by(), task, Milestone::kFinishBy);
+    entries.emplace_back(dates.due(), task, Milestone::kDue);
+  }
+  std::ranges::sort(entries);
+  return entries;
+}
+
+}  // namespace
+
+int main() {
+  for (u32 round = 0; round < 100; ++round) {
+    Board board(0.0, "Deadlines");
+    DeadlineScheduler scheduler;
+    // Each Task's dates, by its index in `board`.
+    vector<opt<Task::Dates>> model;
+    for (u32 step = 0; step < 300; ++step) {
+      const u64 op = rng() % 3;
+      if (model.empty() || op == 0) {
+        const opt<Task::Dates> dates = RandomDates();
+        board.AddTask(Task("task", std::nullopt, std::nullopt, Flags(), dates,
+                           std::nullopt));
+        model.push_back(dates);
+        if (dates) scheduler.Schedule(model.size() - 1, *dates);
+      } else if (op == 1) {
+        const u32 task = rng() % model.size();
+        scheduler.Cancel(task);
+        if (const opt<u64> moved = board.RemoveTask(task)) {
+          scheduler.Renumber(*moved, task);
+        }
+        model[task] = model.back();
+        model.pop_back();
+      } else {
+        const u32 task = rng() % model.size();
+        model[task] = RandomDates();
+        if (model[task]) {
+          scheduler.Schedule(task, *model[task]);
+        } else {
+          scheduler.Cancel(task);
+        }
+      }
+    }
+    Check(board.tasks().size() == model.size());
+
+    const vector<Entry> expected = Milestones(model);
+    Check(scheduler.size() == expected.size());
+    vector<Entry> got;
+    while (const opt<Deadline> next = scheduler.Next()) {
+      vector<Deadline> expired;
+      Check(scheduler.PopExpired(next->when, expired) > 0);
+      for (const Deadline &deadline : expired) {
+        Check(deadline.when == next->when);
+        got.emplace_back(deadline.when, deadline.task, deadline.milestone);
+      }
+    }
+    // Milestones due at the same time may come out in any order.
+    std::ranges::sort(got);
+    Check(got == expected);
+  }
+  return 0;
+}
@@ -0,0 +1,127 @@
+#include <aliases.h>
+#include <arena_allocator.h>
+#include <json.h>
+#include <rose_time.h>
+
+#include <random>
+#include <sstream>
+
+#include "check.h"
+#include "src/structures/event.h"
+#include "src/structures/event_generator.h"
+
+using namespace rose::json;
+using namespace rose::time;
+using namespace rose::time::literals;
+using bee::Event;
+using bee::EventGenerator;
+using bee::test::Check;
+
+namespace {
+
+std::mt19937_64 rng(1);
+
+// A week of evenings every other month, and one without a description or
+// label.
+constexpr const char *kGenerators = R"([
+  {
+    "name": "Retreat",
+    "desc": "Up in the hills",
+    "label": "Away",
+    "start_dates": {
+      "start": "2001-02-03T18:00:00Z",
+      "end": "2001-02-10T22:30:00Z"
+    },
+    "recurrence_rule": {
+      "frequency_mode": "monthly",
+      "interval": 2
+    }
+  },
+  {
+    "name": "Standup",
+    "start_dates": {
+      "start": "2020-01-06T09:00:00Z",
+      "end": "2020-01-06T09:15:00Z"
+    },
+    "recurrence_rule": {
+      "frequency_mode": "weekly",
+      "filters": {"weekdays": ["monday", "wednesday", "friday"]}
+    }
+  }
+])";
+
+// The occurrences of `generator` that overlap [from, to), found by walking
+// its rule from the start.
+vector<Event::Dates> SlowOccurrences(const EventGenerator &generator,
+                                     const DateTime from, const DateTime to) {
+  vector<Event::Dates> occurrences;
+  for (const DateTime start : generator.rule()) {
+    if (!(start < to)) break;
+    const DateTime end = start + generator.length();
+    if (from <= end) occurrences.emplace_back(start, end);
+  }
+  return occurrences;
+}
+
+bool SameDates(const vector<Event::Dates> &a, const vector<Event::Dates> &b) {
+  if (a.size() != b.size()) return false;
+  for (u64 i = 0; i < a.size(); ++i) {
+    if (a[i].start() != b[i].start() || a[i].end() != b[i].end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  rose::ArenaAllocator allocator(1 << 20);
+  std::istringstream in(kGenerators);
+  Tokenizer tokenizer(in, allocator);
+  Parser parser(tokenizer.Tokenize(), allocator);
+  parser.Parse();
+  const Array &array = *parser.root()->as_array().value();
+  vector<EventGenerator> generators;
+  for (const Node *node : array) {
+    Check(EventGenerator::MatchesStructure(*node));
+    generators.push_back(EventGenerator::FromJson(*node));
+  }
+  Check(generators[0].desc() == "Up in the hills");
+  Check(generators[0].label() == "Away");
+  Check(!generators[1].desc() && !generators[1].label());
+
+  const s64 first = "2000-01-01T00:00:00Z"_dt.seconds_since_epoch();
+  const s64 last = "2040-01-01T00:00:00Z"_dt.seconds_since_epoch();
+  for (const EventGenerator &generator : generators) {
+    for (u32 i = 0; i < 300; ++i) {
+      // Mostly windows of a few weeks, which the cache answers, and some
+      // too long to cache.
+      const DateTime from =
+          DateTime::FromSecondsSinceEpoch(first + rng() % (last - first));
+      const s64 days = rng() % 10 ? rng() % 60 : rng() % 200000;
+      const DateTime to = from + Duration::Days(days);
+      const vector<Event::Dates> expected =
+          SlowOccurrences(generator, from, to);
+      Check(SameDates(generator.OccurrencesBetween(from, to), expected));
+
+      // Events made from it carry its name, description and label.
+      const vector<Event> events = generator.EventsBetween(from, to);
+      Check(events.size() == expected.size());
+      for (const Event &event : events) {
+        Check(event.name() == generator.name());
+        Check(event.desc() == generator.desc());
+        Check(event.label() == generator.label());
+      }
+    }
+  }
+
+  // Copies keep the description and label, and start with nothing cached.
+  const EventGenerator copy(generators[0]);
+  Check(copy.desc() == generators[0].desc());
+  Check(copy.label() == generators[0].label());
+  EventGenerator assigned = generators[1];
+  assigned = generators[0];
+  Check(assigned.label() == "Away");
+  return 0;
+}
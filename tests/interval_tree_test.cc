@@ -0,0 +1,133 @@
+#include <aliases.h>
+#include <interval_tree.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <memory_resource>
+#include <random>
+
+#include "check.h"
+
+using bee::test::Check;
+using rose::IntervalTree;
+
+namespace {
+
+std::mt19937_64 rng(1);
+
+using Tree = IntervalTree<s32, u64>;
+using Handle = Tree::Handle;
+
+// An interval as the tree should hold it.
+struct Interval {
+  s32 start;
+  s32 end;
+  u64 value;
+};
+
+// Returns the handles in `model` that `keep` accepts, in the tree's order:
+// by start, then handle.
+vector<Handle> Where(const std::map<Handle, Interval> &model,
+                     const auto &keep) {
+  vector<std::pair<s32, Handle>> kept;
+  for (const auto &[handle, interval] : model) {
+    if (keep(interval)) kept.emplace_back(interval.start, handle);
+  }
+  std::ranges::sort(kept);
+  vector<Handle> handles;
+  for (const auto &[start, handle] : kept) handles.push_back(handle);
+  return handles;
+}
+
+void CheckQueries(const Tree &tree, const std::map<Handle, Interval> &model,
+                  const s32 keys) {
+  Check(tree.size() == model.size());
+  Check(tree.empty() == model.empty());
+  for (const auto &[handle, interval] : model) {
+    Check(tree.start(handle) == interval.start);
+    Check(tree.end(handle) == interval.end);
+    Check(tree.value(handle) == interval.value);
+  }
+
+  for (u32 i = 0; i < 20; ++i) {
+    const s32 from = static_cast<s32>(rng() % (keys + 20)) - 10;
+    const s32 to = from + static_cast<s32>(rng() % (keys / 4 + 1));
+    vector<Handle> got;
+    tree.ForEachOverlapping(
+        from, to, [&](const Handle handle) { got.push_back(handle); });
+    Check(got == Where(model, [&](const Interval &interval) {
+      return interval.start < to && interval.end >= from;
+    }));
+
+    got.clear();
+    tree.ForEachContaining(from,
+                           [&](const Handle handle) { got.push_back(handle); });
+    Check(got == Where(model, [&](const Interval &interval) {
+      return interval.start <= from && from <= interval.end;
+    }));
+
+    got.clear();
+    const u64 limit = rng() % 8 == 0 ? model.size() + 1 : rng() % 6;
+    tree.ForEachStartingFrom(
+        from, limit, [&](const Handle handle) { got.push_back(handle); });
+    vector<Handle> expected = Where(model, [&](const Interval &interval) {
+      return interval.start >= from;
+    });
+    if (expected.size() > limit) expected.resize(limit);
+    Check(got == expected);
+  }
+}
+
+}  // namespace
+
+int main() {
+  for (u32 round = 0; round < 12; ++round) {
+    // Few keys make many equal starts and ends; many keys make few.
+    const s32 keys = round % 2 ? 50 : 100000;
+    std::pmr::monotonic_buffer_resource resource;
+    Tree tree(&resource);
+    Check(tree.get_allocator().resource() == &resource);
+    std::map<Handle, Interval> model;
+    vector<Handle> freed;
+    Handle next_new = 0;
+    for (u32 step = 0; step < 2000; ++step) {
+      const u64 op = rng() % 10;
+      if (model.empty() || op < 6) {
+        const s32 start = static_cast<s32>(rng() % keys);
+        const s32 end = start + static_cast<s32>(rng() % (keys / 5 + 1));
+        const u64 value = rng();
+        const Handle handle = tree.Insert(start, end, value);
+        // Erased handles are reused, most recent first.
+        if (freed.empty()) {
+          Check(handle == next_new++);
+        } else {
+          Check(handle == freed.back());
+          freed.pop_back();
+        }
+        Check(!model.contains(handle));
+        model[handle] = {start, end, value};
+      } else if (op < 9) {
+        auto it = model.begin();
+        std::advance(it, rng() % model.size());
+        tree.Erase(it->first);
+        freed.push_back(it->first);
+        model.erase(it);
+      } else {
+        auto it = model.begin();
+        std::advance(it, rng() % model.size());
+        it->second.value = rng();
+        tree.value(it->first) = it->second.value;
+      }
+      if (step % 100 == 0) CheckQueries(tree, model, keys);
+    }
+    CheckQueries(tree, model, keys);
+
+    tree.clear();
+    model.clear();
+    Check(tree.empty());
+    CheckQueries(tree, model, keys);
+    Check(tree.Insert(1, 2, 3) == 0);
+  }
+  return 0;
+}
@@ -0,0 +1,258 @@
+#include <aliases.h>
+#include <rose_time.h>
+
+#include <algorithm>
+#include <random>
+#include <set>
+
+#include "check.h"
+
+using bee::test::Check;
+using namespace rose::time;
+
+namespace {
+
+std::mt19937_64 rng(1);
+
+s64 DaysInMonth(const s64 year, const u32 month) {
+  return month == 12 ? 31
+                     : DaysFromCivil(year, month + 1, 1)
+                           - DaysFromCivil(year, month, 1);
+}
+
+Weekday WeekdayOf(const s64 day) {
+  return DateTime::FromSecondsSinceEpoch(day * Duration::kSecondsPerDay)
+      .weekday();
+}
+
+// The days on or before `last_day` that `rule` has occurrences on, found by
+// testing every day of every period against RFC 5545 as written.
+vector<s64> Expand(const RecurrenceRule &rule,
+                   const RecurrenceRule::Filters &filters,
+                   const s64 last_day) {
+  const DateTime start = rule.start();
+  const CivilDate start_date = start.date();
+  const s64 start_day = start.days_since_epoch();
+  const bool any_day_filter = !filters.months.empty()
+                           || !filters.weekdays.empty()
+                           || !filters.month_days.empty();
+  const Frequency frequency = rule.frequency();
+  const auto keeps = [&](const s64 day) {
+    const CivilDate date = CivilFromDays(day);
+    if (!filters.months.empty()) {
+      if (std::ranges::find(filters.months, date.month)
+          == filters.months.end()) {
+        return false;
+      }
+    } else if (frequency == Frequency::kYearly && !any_day_filter
+               && date.month != start_date.month) {
+      return false;
+    }
+    if (!filters.weekdays.empty()) {
+      if (std::ranges::find(filters.weekdays, WeekdayOf(day))
+          == filters.weekdays.end()) {
+        return false;
+      }
+    } else if (frequency == Frequency::kWeekly
+               && WeekdayOf(day) != start.weekday()) {
+      return false;
+    }
+    if (!filters.month_days.empty()) {
+      const s64 size = DaysInMonth(date.year, date.month);
+      const bool kept = std::ranges::any_of(filters.month_days,
+                                            [&](const s8 month_day) {
+        return month_day > 0 ? month_day == date.day
+                             : size + month_day + 1 == date.day;
+      });
+      if (!kept) return false;
+    } else if ((frequency == Frequency::kYearly
+                || frequency == Frequency::kMonthly)
+               && filters.weekdays.empty() && date.day != start_date.day) {
+      return false;
+    }
+    return true;
+  };
+
+  vector<s64> out;
+  // Takes one period's kept days; returns false once the rule has ended.
+  const auto emit = [&](vector<s64> days) {
+    if (!filters.set_positions.empty()) {
+      const s64 size = static_cast<s64>(days.size());
+      std::set<s64> picked;
+      for (const s16 position : filters.set_positions) {
+        const s64 i = position > 0 ? position - 1 : size + position;
+        if (i >= 0 && i < size) picked.insert(days[i]);
+      }
+      days.assign(picked.begin(), picked.end());
+    }
+    for (const s64 day : days) {
+      if (day < start_day) continue;
+      const DateTime at = DateTime::FromSecondsSinceEpoch(
+          day * Duration::kSecondsPerDay + start.second_of_day());
+      if (rule.until() && *rule.until() < at) return false;
+      if (rule.count() && out.size() == *rule.count()) return false;
+      out.push_back(day);
+    }
+    return true;
+  };
+  const u32 interval = rule.interval();
+  switch (frequency) {
+    case Frequency::kDaily:
+      for (s64 day = start_day; day <= last_day; day += interval) {
+        if (keeps(day) && !emit({day})) break;
+      }
+      break;
+    case Frequency::kWeekly: {
+      s64 monday = start_day;
+      while (WeekdayOf(monday) != Weekday::kMonday) --monday;
+      for (; monday <= last_day; monday += 7 * s64{interval}) {
+        vector<s64> days;
+        for (s64 day = monday; day < monday + 7; ++day) {
+          if (keeps(day)) days.push_back(day);
+        }
+        if (!emit(days)) break;
+      }
+      break;
+    }
+    case Frequency::kMonthly:
+      for (s64 month = start_date.year * 12 + start_date.month - 1;;
+           month += interval) {
+        const s64 year = month / 12;
+        const u32 month_of_year = month % 12 + 1;
+        const s64 first = DaysFromCivil(year, month_of_year, 1);
+        if (first > last_day) break;
+        vector<s64> days;
+        for (s64 day = first;
+             day < first + DaysInMonth(year, month_of_year); ++day) {
+          if (keeps(day)) days.push_back(day);
+        }
+        if (!emit(days)) break;
+      }
+      break;
+    case Frequency::kYearly:
+      for (s64 year = start_date.year;; year += interval) {
+        const s64 first = DaysFromCivil(year, 1, 1);
+        if (first > last_day) break;
+        vector<s64> days;
+        for (s64 day = first; day < DaysFromCivil(year + 1, 1, 1); ++day) {
+          if (keeps(day)) days.push_back(day);
+        }
+        if (!emit(days)) break;
+      }
+      break;
+  }
+  while (!out.empty() && out.back() > last_day) out.pop_back();
+  return out;
+}
+
+RecurrenceRule::Filters RandomFilters(const Frequency frequency) {
+  RecurrenceRule::Filters filters;
+  if (rng() % 2) {
+    for (u64 i = rng() % 3; i-- > 0;) filters.months.push_back(1 + rng() % 12);
+  }
+  if (rng() % 2) {
+    for (u64 i = rng() % 3; i-- > 0;) {
+      filters.weekdays.push_back(static_cast<Weekday>(rng() % 7));
+    }
+  }
+  if (rng() % 3 == 0) {
+    for (u64 i = 1 + rng() % 3; i-- > 0;) {
+      const s8 day = static_cast<s8>(1 + rng() % 31);
+      filters.month_days.push_back(rng() % 2 ? day : -day);
+    }
+  }
+  if (rng() % 3 == 0) {
+    const u64 most = frequency == Frequency::kYearly ? 60 : 6;
+    for (u64 i = 1 + rng() % 2; i-- > 0;) {
+      const s16 position = static_cast<s16>(1 + rng() % most);
+      filters.set_positions.push_back(rng() % 2 ? position : -position);
+    }
+  }
+  return filters;
+}
+
+}  // namespace
+
+int main() {
+  for (u32 round = 0; round < 600; ++round) {
+    const Frequency frequency = static_cast<Frequency>(rng() % 4);
+    const u32 interval = 1 + (rng() % 3 ? rng() % 4 : rng() % 40);
+    const RecurrenceRule::Filters filters = RandomFilters(frequency);
+    const s64 start_day =
+        DaysFromCivil(1900 + rng() % 200, 1 + rng() % 12, 1 + rng() % 28);
+    const DateTime start = DateTime::FromSecondsSinceEpoch(
+        start_day * Duration::kSecondsPerDay
+        + rng() % Duration::kSecondsPerDay);
+    opt<u64> count;
+    opt<DateTime> until;
+    if (rng() % 5 == 0) count = rng() % 30;
+    if (rng() % 5 == 0) until = start + Duration::Days(rng() % 5000);
+    const RecurrenceRule rule(start, frequency, interval, filters, count,
+                              until);
+    const s64 last_day =
+        start_day + (frequency == Frequency::kYearly ? 40000 : 8000);
+    const vector<s64> expected = Expand(rule, filters, last_day);
+
+    vector<s64> walked;
+    for (const DateTime occurrence : rule) {
+      if (occurrence.days_since_epoch() > last_day) break;
+      Check(occurrence.second_of_day() == start.second_of_day());
+      walked.push_back(occurrence.days_since_epoch());
+    }
+    Check(walked == expected);
+
+    // Windows anywhere in the range, and picking up a walk part way.
+    for (u32 i = 0; i < 4; ++i) {
+      const s64 from = start_day - 100 + rng() % (last_day - start_day);
+      const s64 to =
+          std::min(last_day, from + static_cast<s64>(rng() % 2000));
+      vector<DateTime> between;
+      rule.Between(
+          DateTime::FromSecondsSinceEpoch(from * Duration::kSecondsPerDay),
+          DateTime::FromSecondsSinceEpoch(to * Duration::kSecondsPerDay),
+          between);
+      vector<s64> got;
+      for (const DateTime t : between) got.push_back(t.days_since_epoch());
+      vector<s64> window;
+      for (const s64 day : expected) {
+        if (day >= from && day < to) window.push_back(day);
+      }
+      Check(got == window);
+
+      const DateTime resume_from =
+          DateTime::FromSecondsSinceEpoch(from * Duration::kSecondsPerDay);
+      const u64 seen = std::ranges::count_if(
+          expected, [&](const s64 day) { return day < from; });
+      auto it = rule.Resume(resume_from, seen);
+      for (u64 k = seen; k < expected.size() && k < seen + 20; ++k, ++it) {
+        Check(it != rule.end() && (*it).days_since_epoch() == expected[k]);
+      }
+    }
+  }
+
+  // Daily rules that match rarely or never: February 30th never comes, and
+  // February 29th every `interval` days can take several calendar cycles.
+  const DateTime start = DateTime::FromSecondsSinceEpoch(0);
+  RecurrenceRule::Filters never;
+  never.months = {2};
+  never.month_days = {30};
+  for (const u32 interval : {1, 7, 400}) {
+    const RecurrenceRule rule(start, Frequency::kDaily, interval, never,
+                              std::nullopt, std::nullopt);
+    Check(rule.begin() == rule.end());
+  }
+  RecurrenceRule::Filters leap_day;
+  leap_day.months = {2};
+  leap_day.month_days = {29};
+  for (const u32 interval : {1, 5, 13, 1000}) {
+    const RecurrenceRule rule(start, Frequency::kDaily, interval, leap_day,
+                              std::nullopt, std::nullopt);
+    s64 day = 0;
+    while (CivilFromDays(day).month != 2 || CivilFromDays(day).day != 29) {
+      day += interval;
+    }
+    Check(rule.begin() != rule.end()
+          && (*rule.begin()).days_since_epoch() == day);
+  }
+  return 0;
+}
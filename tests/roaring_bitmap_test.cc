@@ -0,0 +1,113 @@
+#include <aliases.h>
+#include <roaring_bitmap.h>
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <set>
+#include <sstream>
+
+#include "check.h"
+
+using bee::test::Check;
+using rose::RoaringBitmap;
+
+namespace {
+
+std::mt19937_64 rng(1);
+
+// Values that land in a few chunks, some sparse enough to stay arrays and
+// some dense enough to become bitmaps.
+u32 RandomValue(const u32 chunks, const u32 spread) {
+  return static_cast<u32>(rng() % chunks) << 16
+       | static_cast<u32>(rng() % spread);
+}
+
+void CheckSame(const RoaringBitmap &bitmap, const std::set<u32> &model) {
+  Check(bitmap.Cardinality() == model.size());
+  Check(bitmap.empty() == model.empty());
+  const vector<u32> values = bitmap.ToVector();
+  Check(std::ranges::equal(values, model));
+  vector<u32> visited;
+  bitmap.ForEach([&](const u32 value) { visited.push_back(value); });
+  Check(visited == values);
+  Check(bitmap.Max() == (model.empty() ? std::nullopt
+                                       : mk_opt<u32>(*model.rbegin())));
+}
+
+std::set<u32> Combine(const std::set<u32> &a, const std::set<u32> &b,
+                      const char op) {
+  std::set<u32> out;
+  const auto into = std::inserter(out, out.end());
+  switch (op) {
+    case '&':
+      std::ranges::set_intersection(a, b, into);
+      break;
+    case '|':
+      std::ranges::set_union(a, b, into);
+      break;
+    default:
+      std::ranges::set_difference(a, b, into);
+  }
+  return out;
+}
+
+}  // namespace
+
+int main() {
+  for (u32 round = 0; round < 60; ++round) {
+    const u32 chunks = 1 + round % 4;
+    // Dense enough for bitmap chunks past kMaxArraySize, sparse arrays, or
+    // chunks of just a few values.
+    constexpr u32 kSpreads[] = {1 << 16, 6000, 40};
+    constexpr u32 kOperations[] = {30000, 3000, 30};
+    const u32 spread = kSpreads[round % 3];
+    const u32 operations = kOperations[round % 3];
+    RoaringBitmap a;
+    RoaringBitmap b;
+    std::set<u32> model_a;
+    std::set<u32> model_b;
+    for (u32 i = 0; i < operations; ++i) {
+      const u32 value = RandomValue(chunks, spread);
+      if (rng() % 4 == 0) {
+        Check(a.Remove(value) == (model_a.erase(value) == 1));
+      } else {
+        Check(a.Add(value) == model_a.insert(value).second);
+      }
+      const u32 other = RandomValue(chunks, spread);
+      b.Add(other);
+      model_b.insert(other);
+    }
+    if (round % 5 == 0) {
+      const u32 from = RandomValue(chunks, spread);
+      const u32 to = from + static_cast<u32>(rng() % 100000);
+      a.AddRange(from, to);
+      for (u32 value = from; value < to; ++value) model_a.insert(value);
+    }
+    for (u32 i = 0; i < 1000; ++i) {
+      const u32 value = RandomValue(chunks, spread);
+      Check(a.Contains(value) == model_a.contains(value));
+    }
+    CheckSame(a, model_a);
+    CheckSame(b, model_b);
+
+    for (const char op : {'&', '|', '-'}) {
+      const RoaringBitmap result =
+          op == '&' ? (a & b) : op == '|' ? (a | b) : (a - b);
+      const std::set<u32> expected = Combine(model_a, model_b, op);
+      CheckSame(result, expected);
+      // Equal sets compare equal however they were built.
+      RoaringBitmap rebuilt;
+      for (const u32 value : expected) rebuilt.Add(value);
+      Check(rebuilt == result);
+    }
+
+    std::stringstream stream;
+    a.Save(stream);
+    CheckSame(RoaringBitmap::Load(stream), model_a);
+
+    for (const u32 value : model_a) a.Remove(value);
+    CheckSame(a, {});
+  }
+  return 0;
+}
@@ -0,0 +1,268 @@
+#include <aliases.h>
+#include <arena_allocator.h>
+#include <json.h>
+#include <rose_time.h>
+
+#include <cmath>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include "check.h"
+#include "src/structures/board.h"
+#include "src/structures/exceptions.h"
+#include "src/structures/task.h"
+#include "src/structures/task_query.h"
+
+using namespace rose::json;
+using bee::BadQueryException;
+using bee::Board;
+using bee::Flags;
+using bee::Task;
+using bee::TaskQuery;
+using bee::TaskQueryCache;
+using bee::TaskRef;
+using bee::test::Check;
+using rose::time::DateTime;
+using rose::time::Duration;
+using namespace rose::time::literals;
+
+namespace {
+
+std::mt19937_64 rng(1);
+
+// L0 and L1 weigh the same, so only their ids tell them apart. The Tasks
+// read from it are checked field by field before the random ones go in.
+constexpr const char *kBoard = R"({
+  "__metadata__": {
+    "board_bee_version": 0.0,
+    "name": "Queries",
+    "labels": {"L0": 2, "L1": 2, "L2": 1, "L3": 5},
+    "flags": ["f0", "f1", "f2", "f3"]
+  },
+  "tasks": [
+    {
+      "name": "Paint the fence",
+      "desc": "Two coats, white",
+      "label": "L3",
+      "flags": {"f0": false, "f1": true, "f2": false, "f3": true},
+      "dates": {
+        "start_by": "2024-05-01T09:00:00Z",
+        "finish_by": "2024-05-03T17:00:00Z",
+        "due": "2024-05-04T00:00:00Z"
+      },
+      "completion": 0.25
+    },
+    {
+      "name": "Call home",
+      "flags": {"f0": true, "f1": true, "f2": true, "f3": true}
+    }
+  ],
+  "events": [],
+  "task_generators": [],
+  "event_generators": []
+})";
+constexpr u32 kLabels = 4;
+constexpr u32 kFlags = 4;
+
+enum class Comparison : u8 { kLess, kAtMost, kGreater, kAtLeast, kEqual };
+constexpr const char *kComparisons[] = {"<", "<=", ">", ">=", "="};
+
+template <typename T>
+bool Compare(const T &a, const Comparison comparison, const T &b) {
+  switch (comparison) {
+    case Comparison::kLess:
+      return a < b;
+    case Comparison::kAtMost:
+      return a <= b;
+    case Comparison::kGreater:
+      return a > b;
+    case Comparison::kAtLeast:
+      return a >= b;
+    case Comparison::kEqual:
+      return a == b;
+  }
+  return false;
+}
+
+// A random hour of 2024.
+DateTime RandomTime() {
+  return DateTime("2024-01-01T00:00:00Z") + Duration::Hours(rng() % 8784);
+}
+
+Task RandomTask() {
+  opt<u32> label;
+  if (rng() % 4) label = rng() % kLabels;
+  opt<Task::Dates> dates;
+  if (rng() % 4) {
+    const DateTime due = RandomTime();
+    dates = Task::Dates(due - Duration::Hours(1), due);
+  }
+  opt<f64> completion;
+  if (rng() % 3) completion = (rng() % 11) / 10.0;
+  const u64 present = rng() & ((u64{1} << kFlags) - 1);
+  return Task("task", std::nullopt, label, Flags(rng(), present), dates,
+              completion);
+}
+
+// A random query and the test it stands for, applied row by row.
+struct Query {
+  str text;
+  opt<u32> label;
+  bool contradictory = false;
+  // -1 untested, 0 or 1 the value required.
+  s32 flags[kFlags] = {-1, -1, -1, -1};
+  opt<Comparison> due_comparison;
+  DateTime due;
+  bool whole_day = false;
+  opt<Comparison> completion_comparison;
+  f64 completion = 0;
+
+  bool Passes(const TaskRef task) const {
+    if (contradictory) return false;
+    if (label && task.label() != label) return false;
+    for (u32 flag = 0; flag < kFlags; ++flag) {
+      if (flags[flag] >= 0 && task.flags().Get(flag) != (flags[flag] == 1)) {
+        return false;
+      }
+    }
+    if (due_comparison) {
+      if (!task.dates()) return false;
+      const DateTime task_due = task.dates()->due();
+      const bool passes =
+          whole_day ? Compare(task_due.days_since_epoch(), *due_comparison,
+                              due.days_since_epoch())
+                    : Compare(task_due, *due_comparison, due);
+      if (!passes) return false;
+    }
+    if (completion_comparison) {
+      if (!task.completion()) return false;
+      if (!Compare(*task.completion(), *completion_comparison, completion)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+Query RandomQuery() {
+  Query query;
+  for (u64 labels = rng() % 3; labels-- > 0;) {
+    const u32 label = rng() % kLabels;
+    if (query.label && *query.label != label) query.contradictory = true;
+    query.label = label;
+    query.text += "label:L" + std::to_string(label) + ' ';
+  }
+  for (u64 tests = rng() % 3; tests-- > 0;) {
+    const u32 flag = rng() % kFlags;
+    const s32 value = rng() % 2;
+    if (query.flags[flag] >= 0 && query.flags[flag] != value) {
+      query.contradictory = true;
+    }
+    query.flags[flag] = value;
+    query.text += (value ? "f" : "!f") + std::to_string(flag) + ' ';
+  }
+  if (rng() % 2) {
+    const u32 comparison = rng() % 5;
+    query.due_comparison = static_cast<Comparison>(comparison);
+    query.due = RandomTime();
+    query.whole_day = rng() % 2;
+    if (query.whole_day) {
+      query.due = DateTime(query.due.NiceDateString() + "T00:00:00Z");
+    }
+    query.text += str("due") + kComparisons[comparison]
+                + (query.whole_day ? query.due.NiceDateString()
+                                   : query.due.AsNiceString())
+                + ' ';
+  }
+  if (rng() % 2) {
+    const u32 comparison = rng() % 5;
+    query.completion_comparison = static_cast<Comparison>(comparison);
+    query.completion = (rng() % 11) / 10.0;
+    std::ostringstream number;
+    number << query.completion;
+    query.text += str("completion") + kComparisons[comparison] + number.str();
+  }
+  return query;
+}
+
+}  // namespace
+
+int main() {
+  rose::ArenaAllocator allocator(1 << 20);
+  std::istringstream in(kBoard);
+  Tokenizer tokenizer(in, allocator);
+  Parser parser(tokenizer.Tokenize(), allocator);
+  parser.Parse();
+  Board board = Board::FromJson(*parser.root());
+  Check(board.tasks().size() == 2);
+  const TaskRef fence = board.tasks()[0];
+  Check(fence.name() == "Paint the fence");
+  Check(fence.desc() == "Two coats, white");
+  Check(fence.label() == 3u);
+  Check(fence.weight() == 5);
+  Check(fence.flags().Get(0) == false && fence.flags().Get(1) == true
+        && fence.flags().Get(2) == false && fence.flags().Get(3) == true);
+  Check(fence.dates()->start_by() == "2024-05-01T09:00:00Z"_dt);
+  Check(fence.dates()->finish_by() == "2024-05-03T17:00:00Z"_dt);
+  Check(fence.dates()->due() == "2024-05-04T00:00:00Z"_dt);
+  Check(fence.completion() == 0.25);
+  const TaskRef call = board.tasks()[1];
+  Check(call.name() == "Call home" && !call.desc() && !call.label()
+        && call.weight() == 1 && !call.dates() && !call.completion()
+        && call.flags().Get(2) == true);
+  Check(board.Search("coats", 10).size() == 1);
+
+  // Out of range, which changes nothing.
+  for (const auto &change : {
+           std::function<void()>([&] { board.RemoveTask(2); }),
+           std::function<void()>([&] { board.ReplaceTask(2, RandomTask()); }),
+           std::function<void()>([&] { board.RemoveEvent(0); })}) {
+    bool threw = false;
+    try {
+      change();
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    Check(threw);
+  }
+  Check(board.tasks().size() == 2 && board.events().empty());
+
+  TaskQueryCache cache(board);
+  for (u32 round = 0; round < 8; ++round) {
+    // Grows the Board, so that candidates are sometimes few enough to be
+    // tested row by row and sometimes not.
+    for (u32 i = 0; i < 400; ++i) board.AddTask(RandomTask());
+    for (u32 i = 0; i < 100; ++i) {
+      board.RemoveTask(rng() % board.tasks().size());
+    }
+    for (u32 i = 0; i < 300; ++i) {
+      const Query query = RandomQuery();
+      vector<u64> expected;
+      for (const TaskRef task : board.tasks()) {
+        if (query.Passes(task)) expected.push_back(task.row());
+      }
+      vector<u64> got;
+      for (const TaskRef task : cache.Run(query.text)) {
+        got.push_back(task.row());
+      }
+      Check(got == expected);
+      const vector<TaskRef> compiled =
+          TaskQuery::Compile(query.text, board).Run(board.tasks());
+      Check(compiled.size() == expected.size());
+    }
+  }
+
+  for (const char *bad : {"label:L9", "nope", "due<tomorrow", "completion>x",
+                          "size>3", "due<", "label:L1 color:red"}) {
+    bool threw = false;
+    try {
+      TaskQuery::Compile(bad, board);
+    } catch (const BadQueryException &) {
+      threw = true;
+    }
+    Check(threw);
+  }
+  return 0;
+}
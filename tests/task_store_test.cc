@@ -0,0 +1,197 @@
+#include <aliases.h>
+#include <roaring_bitmap.h>
+#include <rose_time.h>
+
+#include <cmath>
+#include <random>
+
+#include "check.h"
+#include "src/structures/flags.h"
+#include "src/structures/task.h"
+#include "src/structures/task_store.h"
+
+using bee::FlagPredicate;
+using bee::Flags;
+using bee::Rollup;
+using bee::Task;
+using bee::TaskRef;
+using bee::TaskStore;
+using bee::test::Check;
+using rose::RoaringBitmap;
+using rose::time::DateTime;
+using rose::time::Duration;
+
+namespace {
+
+std::mt19937_64 rng(1);
+
+constexpr u32 kLabels = 5;
+constexpr u32 kFlags = 6;
+// Labels 0 and 1 weigh the same, so only their ids tell them apart.
+constexpr s32 kWeights[kLabels] = {2, 2, 1, 5, 3};
+
+// A row as the store should hold it.
+struct Row {
+  Task task;
+  s32 weight;
+};
+
+DateTime RandomTime() {
+  return DateTime::FromSecondsSinceEpoch(rng() % 100000);
+}
+
+Row RandomRow() {
+  opt<u32> label;
+  if (rng() % 4) label = rng() % kLabels;
+  const u64 present = rng() & ((u64{1} << kFlags) - 1);
+  opt<Task::Dates> dates;
+  if (rng() % 4) {
+    const DateTime finish_by = RandomTime();
+    const DateTime due = finish_by + Duration::Seconds(rng() % 1000);
+    dates = rng() % 2 ? Task::Dates(finish_by, due)
+                      : Task::Dates(finish_by - Duration::Seconds(10),
+                                    finish_by, due);
+  }
+  opt<f64> completion;
+  if (rng() % 3) completion = (rng() % 5) / 4.0;
+  const str name = "task " + std::to_string(rng() % 1000);
+  opt<str> desc;
+  if (rng() % 2) desc = str(rng() % 40, 'd');
+  Task task(name, desc, label, Flags(rng(), present), dates, completion);
+  return {std::move(task), label ? kWeights[*label] : 1};
+}
+
+RoaringBitmap RowsWhere(const vector<Row> &model, const auto &keep) {
+  RoaringBitmap rows;
+  for (u32 row = 0; row < model.size(); ++row) {
+    if (keep(model[row].task)) rows.Add(row);
+  }
+  return rows;
+}
+
+bool Close(const f64 a, const f64 b) { return std::abs(a - b) < 1e-6; }
+
+void CheckRollup(const Rollup &rollup, const vector<Row> &model,
+                 const DateTime now, const auto &in_group) {
+  Rollup expected;
+  for (const Row &row : model) {
+    if (!in_group(row.task)) continue;
+    const f64 completion = row.task.completion().value_or(0);
+    ++expected.count;
+    expected.completion += completion;
+    expected.weight += row.weight;
+    expected.weighted_completion += row.weight * completion;
+    if (row.task.dates() && completion < 1 && row.task.dates()->due() < now) {
+      ++expected.overdue;
+    }
+  }
+  Check(rollup.count == expected.count);
+  Check(rollup.overdue == expected.overdue);
+  Check(Close(rollup.completion, expected.completion));
+  Check(Close(rollup.weight, expected.weight));
+  Check(Close(rollup.weighted_completion, expected.weighted_completion));
+}
+
+void CheckStore(const TaskStore &store, const vector<Row> &model) {
+  Check(store.size() == model.size());
+  for (u64 row = 0; row < model.size(); ++row) {
+    const TaskRef ref = store[row];
+    const Task &task = model[row].task;
+    Check(ref.name() == task.name());
+    Check(ref.desc() == task.desc());
+    Check(ref.label() == task.label());
+    Check(ref.weight() == model[row].weight);
+    Check(ref.flags().values() == task.flags().values());
+    Check(ref.flags().present() == task.flags().present());
+    Check(ref.completion() == task.completion());
+    Check(ref.dates().has_value() == task.dates().has_value());
+    if (task.dates()) {
+      Check(ref.dates()->start_by() == task.dates()->start_by());
+      Check(ref.dates()->finish_by() == task.dates()->finish_by());
+      Check(ref.dates()->due() == task.dates()->due());
+    }
+  }
+
+  const DateTime now = store.now();
+  CheckRollup(store.total(), model, now, [](const Task &) { return true; });
+  for (u32 label = 0; label < kLabels; ++label) {
+    const auto has_label = [&](const Task &task) {
+      return task.label() == label;
+    };
+    const RoaringBitmap expected = RowsWhere(model, has_label);
+    Check(store.WithLabel(label) == expected);
+    Check(store.label_index().contains(label) == !expected.empty());
+    CheckRollup(store.LabelRollup(label), model, now, has_label);
+    vector<u8> mask(store.size(), 1);
+    store.KeepLabel(label, mask);
+    Check(TaskStore::Rows(mask) == expected.ToVector());
+  }
+  for (u32 flag = 0; flag < kFlags; ++flag) {
+    for (const bool value : {false, true}) {
+      const auto has_flag = [&](const Task &task) {
+        return task.flags().Get(flag) == value;
+      };
+      Check(store.WithFlag(flag, value) == RowsWhere(model, has_flag));
+      CheckRollup(store.FlagRollup(flag, value), model, now, has_flag);
+    }
+  }
+
+  FlagPredicate predicate;
+  for (u64 tests = rng() % 4; tests-- > 0;) {
+    predicate.Require(rng() % kFlags, rng() % 2);
+  }
+  const RoaringBitmap matching = RowsWhere(
+      model, [&](const Task &task) { return predicate.Matches(task.flags()); });
+  Check(store.Matching(predicate) == matching);
+  vector<u8> mask(store.size(), 1);
+  store.KeepFlags(predicate, mask);
+  Check(TaskStore::Rows(mask) == matching.ToVector());
+
+  const DateTime from = RandomTime();
+  const DateTime to = from + Duration::Seconds(rng() % 50000);
+  const f64 min = (rng() % 5) / 4.0;
+  const f64 max = min + (rng() % 3) / 4.0;
+  mask.assign(store.size(), 1);
+  store.KeepDueBetween(from, to, mask);
+  store.KeepCompletionBetween(min, max, mask);
+  const RoaringBitmap between = RowsWhere(model, [&](const Task &task) {
+    return task.dates() && !(task.dates()->due() < from)
+        && task.dates()->due() < to && task.completion()
+        && *task.completion() >= min && *task.completion() <= max;
+  });
+  Check(TaskStore::Rows(mask) == between.ToVector());
+}
+
+}  // namespace
+
+int main() {
+  for (u32 round = 0; round < 20; ++round) {
+    TaskStore store;
+    vector<Row> model;
+    for (u32 step = 0; step < 1500; ++step) {
+      const u64 op = rng() % 10;
+      if (model.empty() || op < 5) {
+        Row row = RandomRow();
+        store.Add(row.task, row.weight);
+        model.push_back(std::move(row));
+      } else if (op < 7) {
+        const u64 i = rng() % model.size();
+        Row row = RandomRow();
+        store.Replace(i, row.task, row.weight);
+        model[i] = std::move(row);
+      } else if (op < 9) {
+        const u64 i = rng() % model.size();
+        store.Remove(i);
+        model[i] = std::move(model.back());
+        model.pop_back();
+      } else {
+        // Mostly forward, sometimes back.
+        store.SetNow(rng() % 4 ? store.now() + Duration::Seconds(rng() % 5000)
+                               : RandomTime());
+      }
+      if (step % 100 == 0) CheckStore(store, model);
+    }
+    CheckStore(store, model);
+  }
+  return 0;
+}
@@ -0,0 +1,167 @@
+#include <aliases.h>
+#include <text_index.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "check.h"
+
+using bee::test::Check;
+using rose::TextIndex;
+
+namespace {
+
+std::mt19937_64 rng(1);
+
+constexpr const char *kWords[] = {"Math",   "homework", "READ", "chapter",
+                                  "essay",  "lab",      "quiz", "exam",
+                                  "review", "x1",       "Ünï"};
+constexpr u64 kWordCount = std::size(kWords);
+
+struct Document {
+  str title;
+  str body;
+};
+
+str Sentence(const u64 words) {
+  str sentence;
+  for (u64 i = 0; i < words; ++i) {
+    if (i > 0) sentence += rng() % 3 ? " " : ", ";
+    sentence += kWords[rng() % kWordCount];
+  }
+  return sentence;
+}
+
+str Fold(str text) {
+  for (char &c : text) {
+    if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+  }
+  return text;
+}
+
+// Splits folded `text` like TextIndex does.
+vector<str> Tokens(const str_view text) {
+  vector<str> tokens;
+  str token;
+  for (const char c : Fold(str(text)) + ' ') {
+    const u8 byte = static_cast<u8>(c);
+    if ((byte >= '0' && byte <= '9') || (byte >= 'a' && byte <= 'z')
+        || byte >= 0x80) {
+      token += c;
+    } else if (!token.empty()) {
+      tokens.push_back(std::move(token));
+      token.clear();
+    }
+  }
+  return tokens;
+}
+
+std::set<u32> Docs(const vector<TextIndex::Hit> &hits) {
+  std::set<u32> docs;
+  for (const TextIndex::Hit &hit : hits) docs.insert(hit.doc);
+  return docs;
+}
+
+bool SameHits(const vector<TextIndex::Hit> &a,
+              const vector<TextIndex::Hit> &b) {
+  return std::ranges::equal(a, b, [](const auto &x, const auto &y) {
+    return x.doc == y.doc && x.score == y.score;
+  });
+}
+
+void CheckSearches(const TextIndex &index,
+                   const std::map<u32, Document> &model) {
+  Check(index.size() == model.size());
+  for (const auto &[doc, document] : model) Check(index.Contains(doc));
+
+  const str query = Sentence(1 + rng() % 2);
+  std::set<u32> expected;
+  for (const auto &[doc, document] : model) {
+    vector<str> tokens = Tokens(document.title);
+    std::ranges::copy(Tokens(document.body), std::back_inserter(tokens));
+    const bool has_all =
+        std::ranges::all_of(Tokens(query), [&](const str &token) {
+          return std::ranges::find(tokens, token) != tokens.end();
+        });
+    if (has_all) expected.insert(doc);
+  }
+  const vector<TextIndex::Hit> hits = index.Search(query, model.size());
+  Check(Docs(hits) == expected);
+  Check(std::ranges::is_sorted(hits, std::greater<>(), &TextIndex::Hit::score));
+
+  const str word = Fold(kWords[rng() % kWordCount]);
+  const str needle = word.substr(rng() % 2, 1 + rng() % 4);
+  expected.clear();
+  for (const auto &[doc, document] : model) {
+    if (Fold(document.title).find(needle) != str::npos
+        || Fold(document.body).find(needle) != str::npos) {
+      expected.insert(doc);
+    }
+  }
+  Check(Docs(index.SearchSubstring(needle, model.size())) == expected);
+
+  // A loaded index answers exactly like the one saved.
+  std::stringstream stream;
+  const u64 stamp = rng();
+  index.Save(stream, stamp);
+  u64 loaded_stamp = 0;
+  const TextIndex loaded = TextIndex::Load(stream, &loaded_stamp);
+  Check(loaded_stamp == stamp);
+  Check(loaded.size() == index.size());
+  Check(SameHits(loaded.Search(query, 10), index.Search(query, 10)));
+  Check(SameHits(loaded.SearchSubstring(needle, 10),
+                 index.SearchSubstring(needle, 10)));
+}
+
+}  // namespace
+
+int main() {
+  TextIndex index;
+  std::map<u32, Document> model;
+  for (u32 step = 0; step < 6000; ++step) {
+    const u32 doc = rng() % 300;
+    const u64 op = rng() % 10;
+    if (op < 6) {
+      Document document{Sentence(1 + rng() % 4), Sentence(rng() % 8)};
+      index.Set(doc, document.title, document.body);
+      model[doc] = std::move(document);
+    } else if (op < 8) {
+      Check(index.Remove(doc) == model.contains(doc));
+      model.erase(doc);
+    } else if (model.contains(doc)) {
+      const u32 to = 300 + rng() % 300;
+      if (!model.contains(to)) {
+        index.Renumber(doc, to);
+        model[to] = std::move(model[doc]);
+        model.erase(doc);
+      }
+    }
+    if (step % 200 == 0) CheckSearches(index, model);
+  }
+  CheckSearches(index, model);
+
+  // Damaged files either fail to load or load an index that can be
+  // searched.
+  std::stringstream stream;
+  index.Save(stream, 0);
+  const str saved = stream.str();
+  for (u32 round = 0; round < 2000; ++round) {
+    str damaged = saved;
+    for (u64 flips = 1 + rng() % 3; flips-- > 0;) {
+      damaged[rng() % damaged.size()] ^= static_cast<char>(1 << rng() % 8);
+    }
+    if (rng() % 4 == 0) damaged.resize(rng() % damaged.size());
+    std::stringstream in(damaged);
+    try {
+      const TextIndex loaded = TextIndex::Load(in);
+      loaded.Search(Sentence(2), 10);
+      loaded.SearchSubstring(Fold(kWords[rng() % kWordCount]), 10);
+    } catch (const std::runtime_error &) {
+    }
+  }
+  return 0;
+}
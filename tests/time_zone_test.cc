@@ -0,0 +1,243 @@
+#include <aliases.h>
+#include <rose_time.h>
+
+#include <algorithm>
+#include <random>
+
+#include "check.h"
+
+using bee::test::Check;
+using namespace rose::time;
+using namespace rose::time::literals;
+
+namespace {
+
+std::mt19937_64 rng(1);
+
+constexpr s64 kSecondsPerDay = Duration::kSecondsPerDay;
+
+// Mm.w.d/time in a POSIX TZ rule.
+struct MonthRule {
+  u32 month;
+  u32 week;
+  u32 weekday;
+  s32 time;
+};
+
+// A POSIX TZ rule and what it says, spelled out.
+struct Zone {
+  const char *posix;
+  s32 std_offset;
+  s32 dst_offset;
+  MonthRule start;
+  MonthRule end;
+};
+
+constexpr Zone kZones[] = {
+    {"CET-1CEST,M3.5.0,M10.5.0/3", 3600, 7200, {3, 5, 0, 7200},
+     {10, 5, 0, 10800}},
+    {"EST5EDT,M3.2.0,M11.1.0", -18000, -14400, {3, 2, 0, 7200},
+     {11, 1, 0, 7200}},
+    // Southern zones, whose daylight saving time spans New Year.
+    {"AEST-10AEDT,M10.1.0,M4.1.0/3", 36000, 39600, {10, 1, 0, 7200},
+     {4, 1, 0, 10800}},
+    {"NZST-12NZDT,M9.5.0,M4.1.0/3", 43200, 46800, {9, 5, 0, 7200},
+     {4, 1, 0, 10800}},
+    // Changes at negative local times, as in America/Nuuk.
+    {"<-02>2<-01>,M3.5.0/-1,M10.5.0/0", -7200, -3600, {3, 5, 0, -3600},
+     {10, 5, 0, 0}},
+};
+
+// Returns the day `rule` names in `year`, found by walking the month.
+s64 SlowDay(const s64 year, const MonthRule &rule) {
+  vector<s64> matching;
+  const s64 first = DaysFromCivil(year, rule.month, 1);
+  for (s64 day = first; CivilFromDays(day).month == rule.month; ++day) {
+    const DateTime midnight =
+        DateTime::FromSecondsSinceEpoch(day * kSecondsPerDay);
+    if (midnight.weekday() == static_cast<Weekday>(rule.weekday)) {
+      matching.push_back(day);
+    }
+  }
+  return matching[std::min<u64>(rule.week, matching.size()) - 1];
+}
+
+// Returns every change `zone` makes in years `first` through `last`, as
+// (UTC seconds, offset from then on), in order.
+vector<std::pair<s64, s32>> SlowChanges(const Zone &zone, const s64 first,
+                                        const s64 last) {
+  vector<std::pair<s64, s32>> changes;
+  for (s64 year = first; year <= last; ++year) {
+    // Each change happens at a local time in the offset it ends.
+    changes.emplace_back(SlowDay(year, zone.start) * kSecondsPerDay
+                             + zone.start.time - zone.std_offset,
+                         zone.dst_offset);
+    changes.emplace_back(SlowDay(year, zone.end) * kSecondsPerDay
+                             + zone.end.time - zone.dst_offset,
+                         zone.std_offset);
+  }
+  std::ranges::sort(changes);
+  return changes;
+}
+
+s32 SlowOffsetAt(const Zone &zone, const s64 utc) {
+  const s64 year = CivilFromDays(FloorDiv(utc, kSecondsPerDay)).year;
+  s32 offset = 0;
+  for (const auto &[at, to] : SlowChanges(zone, year - 1, year + 1)) {
+    if (at <= utc) offset = to;
+  }
+  return offset;
+}
+
+// Returns the instant FromLocal should give for `local`: the earliest one
+// shown as `local`, or for a skipped time, the one read with the offset
+// from before clocks went forward.
+s64 SlowFromLocal(const Zone &zone, const s64 local) {
+  opt<s64> earliest;
+  for (const s32 offset : {zone.std_offset, zone.dst_offset}) {
+    const s64 utc = local - offset;
+    if (SlowOffsetAt(zone, utc) == offset) {
+      earliest = std::min(earliest.value_or(utc), utc);
+    }
+  }
+  return earliest.value_or(local - zone.std_offset);
+}
+
+void CheckZone(const Zone &zone) {
+  const TimeZone time_zone = TimeZone::FromPosix(zone.posix);
+  Check(time_zone.name() == zone.posix);
+  // Years on both sides of the table's 1970 start and its 2100 end.
+  const s64 first = DaysFromCivil(1900, 1, 1) * kSecondsPerDay;
+  const s64 last = DaysFromCivil(2200, 1, 1) * kSecondsPerDay;
+  for (u32 i = 0; i < 20000; ++i) {
+    const s64 utc = first + rng() % (last - first);
+    const s32 offset = SlowOffsetAt(zone, utc);
+    Check(time_zone.OffsetAt(DateTime::FromSecondsSinceEpoch(utc)) == offset);
+    // Nearby instants, which the cache may answer.
+    for (u32 j = 0; j < 3; ++j) {
+      const s64 near = utc + static_cast<s64>(rng() % 7200) - 3600;
+      Check(time_zone.OffsetAt(DateTime::FromSecondsSinceEpoch(near))
+            == SlowOffsetAt(zone, near));
+    }
+    const DateTime local = DateTime::FromSecondsSinceEpoch(utc + offset);
+    Check(time_zone.ToLocal(DateTime::FromSecondsSinceEpoch(utc)) == local);
+    Check(time_zone.FromLocal(local).seconds_since_epoch()
+          == SlowFromLocal(zone, utc + offset));
+  }
+
+  // Local times within two hours of every change, so each gap and overlap
+  // is crossed.
+  const s64 first_year = 1960 + rng() % 150;
+  for (const auto &[at, to] : SlowChanges(zone, first_year, first_year + 5)) {
+    for (s64 local = at + to - 7200; local < at + to + 7200; local += 599) {
+      Check(time_zone.FromLocal(DateTime::FromSecondsSinceEpoch(local))
+                .seconds_since_epoch()
+            == SlowFromLocal(zone, local));
+    }
+  }
+}
+
+// Returns `value` as `bytes` big-endian bytes.
+str BigEndian(const u64 value, const u32 bytes) {
+  str out;
+  for (u32 i = bytes; i-- > 0;) out += static_cast<char>(value >> (8 * i));
+  return out;
+}
+
+// A TZif header with the given counts.
+str TzifHeader(const u32 times, const u32 types, const u32 chars) {
+  return "TZif2" + str(15, '\0') + BigEndian(0, 4) + BigEndian(0, 4)
+       + BigEndian(0, 4) + BigEndian(times, 4) + BigEndian(types, 4)
+       + BigEndian(chars, 4);
+}
+
+// Checks a TZif history followed by a rule: Berlin's local mean time, then
+// CET with one summer of CEST in 1960, then the modern rule.
+void CheckTzif() {
+  const s64 cet = "1893-04-01T00:00:00Z"_dt.seconds_since_epoch();
+  const s64 summer = "1960-06-01T00:00:00Z"_dt.seconds_since_epoch();
+  const s64 autumn = "1960-10-01T00:00:00Z"_dt.seconds_since_epoch();
+  constexpr s32 kOffsets[] = {3208, 3600, 7200};
+  str data = TzifHeader(0, 1, 1) + BigEndian(3208, 4) + str(3, '\0');
+  data += TzifHeader(3, 3, 1);
+  for (const s64 time : {cet, summer, autumn}) data += BigEndian(time, 8);
+  data += str{1, 2, 1};
+  for (const s32 offset : kOffsets) {
+    data += BigEndian(offset, 4) + str(2, '\0');
+  }
+  data += '\0';
+  data += "\nCET-1CEST,M3.5.0,M10.5.0/3\n";
+  const TimeZone zone = TimeZone::FromTzif("Test/Berlin", data);
+  Check(zone.name() == "Test/Berlin");
+
+  const auto offset_at = [&](const s64 seconds) {
+    return zone.OffsetAt(DateTime::FromSecondsSinceEpoch(seconds));
+  };
+  Check(offset_at(cet - 1) == 3208);
+  Check(offset_at(cet) == 3600);
+  Check(offset_at(summer - 1) == 3600);
+  Check(offset_at(summer) == 7200);
+  Check(offset_at(autumn - 1) == 7200);
+  Check(offset_at(autumn) == 3600);
+  // After the history the rule applies, from 1961 rather than 1970. (The
+  // history ended 1960's summer early.)
+  const Zone &rule = kZones[0];
+  const s64 next_year = "1961-01-01T00:00:00Z"_dt.seconds_since_epoch();
+  for (u32 i = 0; i < 20000; ++i) {
+    const s64 utc = next_year + rng() % (300 * 365 * kSecondsPerDay);
+    Check(offset_at(utc) == SlowOffsetAt(rule, utc));
+  }
+
+  bool threw = false;
+  try {
+    TimeZone::FromTzif("Test/Truncated", data.substr(0, data.size() / 2));
+  } catch (const BadTimeZoneException &) {
+    threw = true;
+  }
+  Check(threw);
+}
+
+}  // namespace
+
+int main() {
+  for (const Zone &zone : kZones) CheckZone(zone);
+
+  // Known changes, in Berlin and Sydney.
+  const TimeZone berlin = TimeZone::FromPosix("CET-1CEST,M3.5.0,M10.5.0/3");
+  Check(berlin.OffsetAt("2024-03-31T00:59:59Z"_dt) == 3600);
+  Check(berlin.OffsetAt("2024-03-31T01:00:00Z"_dt) == 7200);
+  Check(berlin.OffsetAt("2024-10-27T00:59:59Z"_dt) == 7200);
+  Check(berlin.OffsetAt("2024-10-27T01:00:00Z"_dt) == 3600);
+  // 02:30 was skipped, and 02:30 in October happened twice.
+  Check(berlin.FromLocal("2024-03-31T02:30:00Z"_dt)
+        == "2024-03-31T01:30:00Z"_dt);
+  Check(berlin.FromLocal("2024-10-27T02:30:00Z"_dt)
+        == "2024-10-27T00:30:00Z"_dt);
+  const TimeZone sydney = TimeZone::FromPosix("AEST-10AEDT,M10.1.0,M4.1.0/3");
+  Check(sydney.OffsetAt("1969-01-15T00:00:00Z"_dt) == 39600);
+  Check(sydney.OffsetAt("1970-01-01T00:00:00Z"_dt) == 39600);
+  Check(sydney.OffsetAt("2024-04-06T15:59:59Z"_dt) == 39600);
+  Check(sydney.OffsetAt("2024-04-06T16:00:00Z"_dt) == 36000);
+  Check(sydney.OffsetAt("2024-10-05T16:00:00Z"_dt) == 39600);
+
+  const TimeZone fixed = TimeZone::FromPosix("<+0530>-5:30");
+  Check(fixed.OffsetAt("1900-01-01T00:00:00Z"_dt) == 19800);
+  Check(fixed.FromLocal("2024-01-01T05:30:00Z"_dt)
+        == "2024-01-01T00:00:00Z"_dt);
+  Check(TimeZone(-3600).OffsetAt("2024-07-01T00:00:00Z"_dt) == -3600);
+  Check(TimeZone::Utc().name() == "UTC");
+
+  for (const char *bad : {"", "CE-1", "CET", "CET-1CEST,M3.5", "CET-25",
+                          "CET-1CEST,M13.1.0,M10.5.0", "CET-1CEST,J0,J1"}) {
+    bool threw = false;
+    try {
+      TimeZone::FromPosix(bad);
+    } catch (const BadTimeZoneException &) {
+      threw = true;
+    }
+    Check(threw);
+  }
+
+  CheckTzif();
+  return 0;
+}
@@ -0,0 +1,1171 @@
+// Generates C++ validators and readers from a set of JSON Schema files.
+//
+// Usage: schema_codegen <output_dir> <namespace> <schema.json>...
+//
+// Writes <output_dir>/validators.h and <output_dir>/validators.cc, which
+// declare and define one `bool Matches<Name>(const rose::json::Node &,
+// rose::json::ElementScheduler *)` function for every schema file (named
+// after its "title") and for every nested object or array schema inside it.
+// Object keys are dispatched with a switch on their first character, and
+// scalar checks are written out inline. Arrays whose items are another schema
+// file go through the ElementScheduler, if there is one.
+//
+// Also writes <output_dir>/readers.h, with a `Read<Name>(node, reader,
+// handler)` template for each of those schemas. A reader checks the same
+// rules as the validator, through the Expect* functions of `reader` (a
+// bee::JsonReader), so the first broken one is reported with its JSONPath.
+// It passes every value it reads to `handler`, converted once: see
+// WriteReaders for the calls it makes.
+//
+// Only the keywords the schemas actually need are supported. Anything else
+// is an error, so a schema can never silently say more than the code checks.
+// Of those, "enum" only takes strings, "not" only {"const": <integer>} on
+// an integer, and "anyOf" only branches of different types, which are told
+// apart by type alone. Next to "$ref", only "required" is allowed, to ask
+// more of the other file's object.
+
+#include <aliases.h>
+#include <arena_allocator.h>
+#include <json.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+using namespace rose::json;
+
+namespace {
+
+constexpr size_t kArenaSizeBytes = 1000 * 1000;  // 1 MB
+
+// Keywords that only document a schema.
+const std::set<str_view> kAnnotations = {"$schema", "title", "description"};
+// Keywords that the generator knows how to turn into checks.
+const std::set<str_view> kKeywords = {
+    "$ref",      "type",     "properties", "required",  "additionalProperties",
+    "propertyNames", "items", "maxItems", "uniqueItems", "minLength",
+    "maxLength", "minimum",  "maximum",   "format",    "enum",
+    "not",       "anyOf"};
+
+// Returns `name` converted from snake_case (or kebab-case) to PascalCase.
+str PascalCase(const str_view name) {
+  str out;
+  bool upper = true;
+  for (const char c : name) {
+    if (c == '_' || c == '-' || c == '.' || c == ' ') {
+      upper = true;
+      continue;
+    }
+    out.push_back(upper ? static_cast<char>(std::toupper(c)) : c);
+    upper = false;
+  }
+  return out;
+}
+
+// Returns `string` as a C++ string literal.
+str Quote(const str_view string) {
+  str out = "\"";
+  for (const char c : string) {
+    if (c == '"' || c == '\\') out.push_back('\\');
+    out.push_back(c);
+  }
+  out.push_back('"');
+  return out;
+}
+
+str Indent(const u32 level) { return str(2 * level, ' '); }
+
+// How generated code refers to the Node being checked.
+struct NodeExpr {
+  // Expression of type `const Node &`.
+  str ref;
+  // Prefix for calling a member function on it.
+  str access;
+};
+
+const NodeExpr kNode = {"node", "node."};
+const NodeExpr kValue = {"*value", "value->"};
+const NodeExpr kElement = {"*element", "element->"};
+const NodeExpr kItem = {"*array[i]", "array[i]->"};
+
+// Returns the property named `key` in `schema`, or nullptr.
+const Node *Get(const Node &schema, const char *key) {
+  for (const auto &[name, value] : *schema.as_object().value()) {
+    if (strcmp(name, key) == 0) return value;
+  }
+  return nullptr;
+}
+
+f64 NumberValue(const Node &node) {
+  if (node.is_s64()) return static_cast<f64>(node.as_s64().value());
+  if (node.is_f64()) return node.as_f64().value();
+  throw std::runtime_error("Expected a number in schema");
+}
+
+class Generator {
+ public:
+  explicit Generator(str name_space) : namespace_(std::move(name_space)) {}
+
+  // Registers the schema file at `path`, whose text is `text` and which has
+  // already been parsed into `root`.
+  void AddFile(const str &path, const str_view text, const Node *root) {
+    // FNV-1a over every schema, so any edit gives validators a new version.
+    for (const char c : text) {
+      schema_hash_ = (schema_hash_ ^ static_cast<u8>(c)) * 0x100000001B3;
+    }
+    const Node *title = Get(*root, "title");
+    if (!title || !title->is_string()) {
+      throw std::runtime_error(path + " has no string \"title\"");
+    }
+    const str file = std::filesystem::path(path).filename().string();
+    files_.push_back({file, *title->as_string(),
+                      "Matches" + PascalCase(*title->as_string()), root});
+  }
+
+  void Generate() {
+    for (const File &file : files_) {
+      EmitFunction(file.function, *file.root, file.title);
+    }
+    for (const File &file : files_) {
+      EmitReaderFunction(ReaderName(file), *file.root, file.title, "");
+    }
+  }
+
+  void WriteHeader(std::ostream &out) const {
+    const str guard = "BOARD_BEE_GENERATED_SCHEMA_" + Upper(namespace_)
+                    + "_VALIDATORS_H_";
+    out << "// Generated by tools/schema_codegen.cc. Do not edit.\n\n"
+        << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+        << "#include <json.h>\n\n"
+        << "namespace bee::schema::" << namespace_ << " {\n\n"
+        << "// Hash of the schemas these validators were generated from.\n"
+        << "// Changes whenever any of them does, so it can be used to\n"
+        << "// version validation results.\n"
+        << "inline constexpr u64 kSchemaHash = 0x" << std::hex << schema_hash_
+        << std::dec << "u;\n\n";
+    for (const auto &[name, path] : declarations_) {
+      out << "// Returns true if `node` matches " << path << " in the schema.\n"
+          << "bool " << name << "(const rose::json::Node &node,\n"
+          << str(name.size() + 6, ' ')
+          << "rose::json::ElementScheduler *scheduler = nullptr);\n";
+    }
+    out << "\n}  // namespace bee::schema::" << namespace_ << "\n\n"
+        << "#endif  // " << guard << '\n';
+  }
+
+  void WriteSource(std::ostream &out) const {
+    out << "// Generated by tools/schema_codegen.cc. Do not edit.\n\n"
+        << "#include \"validators.h\"\n\n"
+        << "#include <json.h>\n#include <rose_time.h>\n\n"
+        << "#include <cstring>\n#include <initializer_list>\n\n"
+        << "namespace bee::schema::" << namespace_ << " {\n\n"
+        << "using namespace rose::json;\n\n"
+        << "namespace {\n\n"
+        << "// Returns the number of UTF-8 code points in `string`, stopping\n"
+        << "// early once `limit` have been counted.\n"
+        << "[[maybe_unused]] u64 CodePoints(const char *string, "
+        << "const u64 limit) {\n"
+        << "  u64 n = 0;\n"
+        << "  for (; *string && n < limit; ++string) {\n"
+        << "    if ((*string & 0xC0) != 0x80) ++n;\n"
+        << "  }\n"
+        << "  return n;\n"
+        << "}\n\n"
+        << "// Returns the index of `string` in `options`, or the number of\n"
+        << "// options if it isn't one of them.\n"
+        << "[[maybe_unused]] u64 IndexOf(\n"
+        << "    const char *string,\n"
+        << "    const std::initializer_list<const char *> options) {\n"
+        << "  u64 i = 0;\n"
+        << "  for (const char *option : options) {\n"
+        << "    if (strcmp(string, option) == 0) break;\n"
+        << "    ++i;\n"
+        << "  }\n"
+        << "  return i;\n"
+        << "}\n\n"
+        << "// Returns a mask with bit i set if `node` is an object with a\n"
+        << "// property named names[i].\n"
+        << "[[maybe_unused]] u64 FoundProperties(\n"
+        << "    const Node &node,\n"
+        << "    const std::initializer_list<const char *> names) {\n"
+        << "  u64 found = 0;\n"
+        << "  if (!node.is_object()) return found;\n"
+        << "  for (const auto &[key, value] : *node.as_object().value()) {\n"
+        << "    const u64 i = IndexOf(key, names);\n"
+        << "    if (i < names.size()) found |= u64{1} << i;\n"
+        << "  }\n"
+        << "  return found;\n"
+        << "}\n\n"
+        << "[[maybe_unused]] f64 NumberValue(const Node &node) {\n"
+        << "  return node.is_f64() ? node.as_f64().value()\n"
+        << "                       : static_cast<f64>(node.as_s64().value());\n"
+        << "}\n\n"
+        << "}  // namespace\n\n"
+        << definitions_.str()
+        << "}  // namespace bee::schema::" << namespace_ << '\n';
+  }
+
+  void WriteReaders(std::ostream &out) const {
+    const str guard = "BOARD_BEE_GENERATED_SCHEMA_" + Upper(namespace_)
+                    + "_READERS_H_";
+    out << "// Generated by tools/schema_codegen.cc. Do not edit.\n\n"
+        << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+        << "#include <json.h>\n#include <rose_time.h>\n\n"
+        << "#include <cstring>\n#include <initializer_list>\n"
+        << "#include <limits>\n\n"
+        << "namespace bee::schema::" << namespace_ << " {\n\n"
+        << "// Read<Name>(node, reader, handler) reads `node` as the schema\n"
+        << "// Name, failing through `reader` at the first rule it breaks,\n"
+        << "// and passes what it reads to the member of `handler` named\n"
+        << "// after its path from the root of the schema file:\n"
+        << "//   handler.Name(const char *)       \"name\", a string\n"
+        << "//   handler.DatesDue(DateTime)       \"dates\": {\"due\"}, a "
+        << "date-time\n"
+        << "//   handler.Completion(f64)          a number\n"
+        << "//   handler.Count(s64)               an integer\n"
+        << "//   handler.Done(bool)               a boolean\n"
+        << "//   handler.FrequencyMode(u64)       an enum, as the index of\n"
+        << "//                                    its value\n"
+        << "//   handler.LabelsValue(key, value)  an additional property\n"
+        << "//   handler.Tasks(const Array &)     an array, before its items\n"
+        << "//   handler.TasksItem(value)         each item of an array\n"
+        << "//   handler.Metadata(const Node &)   a $ref to another file, or\n"
+        << "//                                    an object or array with no\n"
+        << "//                                    rules of its own\n"
+        << "// A branch of an anyOf adds its title (or, for a $ref, the\n"
+        << "// title of that file), e.g. handler.EventGeneratorsItemNote.\n"
+        << "// Values a handler has no member for are still checked, and a\n"
+        << "// $ref it doesn't take is checked by that file's reader.\n\n"
+        << "namespace readers_internal {\n\n"
+        << "// A handler that takes nothing.\n"
+        << "struct Ignore {};\n\n"
+        << "// Returns the number of UTF-8 code points in `string`, stopping\n"
+        << "// early once `limit` have been counted.\n"
+        << "inline u64 CodePoints(const char *string, const u64 limit) {\n"
+        << "  u64 n = 0;\n"
+        << "  for (; *string && n < limit; ++string) {\n"
+        << "    if ((*string & 0xC0) != 0x80) ++n;\n"
+        << "  }\n"
+        << "  return n;\n"
+        << "}\n\n"
+        << "// Returns the index of `string` in `options`, or the number of\n"
+        << "// options if it isn't one of them.\n"
+        << "inline u64 IndexOf(const char *string,\n"
+        << "                   const std::initializer_list<const char *> "
+        << "options) {\n"
+        << "  u64 i = 0;\n"
+        << "  for (const char *option : options) {\n"
+        << "    if (strcmp(string, option) == 0) break;\n"
+        << "    ++i;\n"
+        << "  }\n"
+        << "  return i;\n"
+        << "}\n\n"
+        << "// Returns a mask with bit i set if `node` is an object with a\n"
+        << "// property named names[i].\n"
+        << "inline u64 FoundProperties(\n"
+        << "    const rose::json::Node &node,\n"
+        << "    const std::initializer_list<const char *> names) {\n"
+        << "  u64 found = 0;\n"
+        << "  if (!node.is_object()) return found;\n"
+        << "  for (const auto &[key, value] : *node.as_object().value()) {\n"
+        << "    const u64 i = IndexOf(key, names);\n"
+        << "    if (i < names.size()) found |= u64{1} << i;\n"
+        << "  }\n"
+        << "  return found;\n"
+        << "}\n\n"
+        << "}  // namespace readers_internal\n\n";
+    for (const auto &[name, path] : reader_declarations_) {
+      out << "// Reads `node` as " << path << " in the schema.\n"
+          << "template <typename Reader, typename Handler>\n"
+          << "void " << name << "(const rose::json::Node &node, "
+          << "Reader &reader, Handler &handler);\n";
+    }
+    out << '\n' << readers_.str()
+        << "}  // namespace bee::schema::" << namespace_ << "\n\n"
+        << "#endif  // " << guard << '\n';
+  }
+
+ private:
+  struct File {
+    str name;
+    str title;
+    str function;
+    const Node *root;
+  };
+
+  static str Upper(str string) {
+    for (char &c : string) c = static_cast<char>(std::toupper(c));
+    return string;
+  }
+
+  // Emits the definition of a function called `name` that validates a Node
+  // against `schema`, which is found at `path` (e.g. "Task.dates").
+  void EmitFunction(const str &name, const Node &schema, const str &path) {
+    declarations_.emplace_back(name, path);
+    std::stringstream body;
+    EmitChecks(body, schema, kNode, name, path, 1, true);
+    definitions_ << "bool " << name << "(const Node &node,\n"
+                 << str(name.size() + 6, ' ')
+                 << "[[maybe_unused]] ElementScheduler *scheduler) {\n"
+                 << body.str() << "  return true;\n}\n\n";
+  }
+
+  // Emits statements that return false unless `node` matches `schema`.
+  // Nested object and array schemas are only written out inline when
+  // `function_body` is true; otherwise they get a function of their own
+  // called `name`.
+  void EmitChecks(std::ostream &out, const Node &schema, const NodeExpr &node,
+                  const str &name, const str &path, const u32 level,
+                  const bool function_body) {
+    if (!schema.is_object()) {
+      throw std::runtime_error("Schema for " + name + " is not an object");
+    }
+    for (const auto &[key, value] : *schema.as_object().value()) {
+      if (!kAnnotations.contains(key) && !kKeywords.contains(key)) {
+        throw std::runtime_error(str("Unsupported keyword \"") + key
+                                 + "\" in schema for " + name);
+      }
+    }
+    const str pad = Indent(level);
+    if (const Node *ref = Get(schema, "$ref")) {
+      out << pad << "if (!" << RefFunction(*ref) << '(' << node.ref
+          << ", scheduler)) return false;\n";
+      if (const vector<str> names = RequiredWithRef(schema, path);
+          !names.empty()) {
+        out << pad << "if (FoundProperties(" << node.ref << ", "
+            << List(names) << ") != " << Mask(names.size()) << ") {\n"
+            << pad << "  return false;\n"
+            << pad << "}\n";
+      }
+      return;
+    }
+    if (Get(schema, "anyOf")) {
+      const vector<Branch> branches = Branches(schema, path);
+      for (u64 i = 0; i < branches.size(); ++i) {
+        out << pad << (i == 0 ? "if (" : "} else if (")
+            << TypeTest(branches[i].type, node.access) << ") {\n";
+        EmitChecks(out, *branches[i].schema, node,
+                   name + PascalCase(branches[i].title),
+                   path + '<' + branches[i].title + '>', level + 1, false);
+      }
+      out << pad << "} else {\n" << pad << "  return false;\n"
+          << pad << "}\n";
+      return;
+    }
+    const Node *type = Get(schema, "type");
+    if (!type) throw std::runtime_error("Schema for " + name + " has no type");
+    vector<str> types;
+    if (type->is_string()) {
+      types.emplace_back(*type->as_string());
+    } else {
+      for (const Node *t : **type->as_array()) {
+        types.emplace_back(*t->as_string());
+      }
+    }
+    const str &t = types.front();
+    const bool nested = types.size() == 1
+                     && ((t == "object" && HasObjectKeywords(schema))
+                         || (t == "array" && HasArrayKeywords(schema)));
+    if (nested && !function_body) {
+      EmitFunction(name, schema, path);
+      out << pad << "if (!" << name << '(' << node.ref
+          << ", scheduler)) return false;\n";
+      return;
+    }
+    str test;
+    for (const str &type_name : types) {
+      if (!test.empty()) test += " && ";
+      test += "!" + TypeTest(type_name, node.access);
+    }
+    out << pad << "if (" << test << ") return false;\n";
+    if (types.size() != 1) return;
+    if (t == "string") {
+      EmitStringChecks(out, schema, node.access + "as_string().value()", level);
+    }
+    if (t == "number" || t == "integer") {
+      EmitNumberChecks(out, schema, node, level);
+    }
+    if (const Node *excluded = Get(schema, "not")) {
+      out << pad << "if (" << node.access << "as_s64().value() == "
+          << IntegerLiteral(ExcludedConst(*excluded, t, path))
+          << ") return false;\n";
+    }
+    if (t == "object") EmitObjectChecks(out, schema, node, name, path, level);
+    if (t == "array") EmitArrayChecks(out, schema, node, name, path, level);
+  }
+
+  static bool HasObjectKeywords(const Node &schema) {
+    return Get(schema, "properties") || Get(schema, "required")
+        || Get(schema, "additionalProperties") || Get(schema, "propertyNames");
+  }
+
+  static bool HasArrayKeywords(const Node &schema) {
+    return Get(schema, "items") || Get(schema, "maxItems")
+        || Get(schema, "uniqueItems");
+  }
+
+  // Returns an expression testing the type of the Node reached through
+  // `access` (e.g. "node." or "value->").
+  static str TypeTest(const str &type, const str &access) {
+    if (type == "object") return access + "is_object()";
+    if (type == "array") return access + "is_array()";
+    if (type == "string") return access + "is_string()";
+    if (type == "integer") return access + "is_s64()";
+    if (type == "number") {
+      return "(" + access + "is_f64() || " + access + "is_s64())";
+    }
+    if (type == "boolean") return access + "is_bool()";
+    if (type == "null") return access + "is_null()";
+    throw std::runtime_error("Unknown type \"" + type + '"');
+  }
+
+  // Emits checks on `string`, an expression of type `const char *`.
+  void EmitStringChecks(std::ostream &out, const Node &schema,
+                        const str &string, const u32 level) {
+    const Node *min_length = Get(schema, "minLength");
+    const Node *max_length = Get(schema, "maxLength");
+    const Node *format = Get(schema, "format");
+    const Node *options = Get(schema, "enum");
+    if (!min_length && !max_length && !format && !options) return;
+    const str pad = Indent(level);
+    out << pad << "{\n"
+        << pad << "  const char *string = " << string << ";\n";
+    if (min_length) {
+      const s64 n = min_length->as_s64().value();
+      if (n == 1) {
+        out << pad << "  if (*string == '\\0') return false;\n";
+      } else if (n > 1) {
+        out << pad << "  if (CodePoints(string, " << n << ") < " << n
+            << ") return false;\n";
+      }
+    }
+    if (max_length) {
+      const s64 n = max_length->as_s64().value();
+      out << pad << "  if (CodePoints(string, " << n + 1 << ") > " << n
+          << ") return false;\n";
+    }
+    if (format) {
+      const str_view f = *format->as_string();
+      if (f != "date-time") {
+        throw std::runtime_error(str("Unsupported format \"") + str(f) + '"');
+      }
+      out << pad << "  if (!rose::time::DateTime::IsValidDateTime(string)) "
+          << "return false;\n";
+    }
+    if (options) {
+      const vector<str> names = EnumNames(*options);
+      out << pad << "  if (IndexOf(string, " << List(names) << ") == "
+          << names.size() << ") {\n"
+          << pad << "    return false;\n"
+          << pad << "  }\n";
+    }
+    out << pad << "}\n";
+  }
+
+  // Returns the names "required" lists next to the "$ref" in `schema`, at
+  // `path`, after making sure nothing else is there.
+  static vector<str> RequiredWithRef(const Node &schema, const str &path) {
+    vector<str> names;
+    for (const auto &[key, value] : *schema.as_object().value()) {
+      const str_view k = key;
+      if (k == "$ref" || kAnnotations.contains(k)) continue;
+      if (k != "required") {
+        throw std::runtime_error(str("Keyword \"") + key + "\" next to "
+                                 "$ref is unsupported (" + path + ')');
+      }
+      for (const Node *name : **value->as_array()) {
+        names.emplace_back(*name->as_string());
+      }
+    }
+    if (names.size() > 64) {
+      throw std::runtime_error(path + " requires over 64 properties");
+    }
+    return names;
+  }
+
+  // Returns a literal for a mask of the low `bits` bits.
+  static str Mask(const u64 bits) {
+    const u64 mask = bits == 64 ? ~u64{0} : (u64{1} << bits) - 1;
+    return std::to_string(mask) + 'u';
+  }
+
+  // Returns the strings an "enum" allows.
+  static vector<str> EnumNames(const Node &options) {
+    vector<str> names;
+    if (options.is_array()) {
+      for (const Node *option : **options.as_array()) {
+        if (!option->is_string()) break;
+        names.emplace_back(*option->as_string());
+      }
+    }
+    if (names.empty() || names.size() != (*options.as_array())->size()) {
+      throw std::runtime_error("Only non-empty enums of strings are "
+                               "supported");
+    }
+    return names;
+  }
+
+  // Returns `names` as a braced list of string literals.
+  static str List(const vector<str> &names) {
+    str list = "{";
+    for (u64 i = 0; i < names.size(); ++i) {
+      if (i != 0) list += ", ";
+      list += Quote(names[i]);
+    }
+    return list + '}';
+  }
+
+  // Returns the integer a "not" of type `type` at `path` rules out.
+  static const Node &ExcludedConst(const Node &excluded, const str &type,
+                                   const str &path) {
+    const Node *value =
+        excluded.is_object() && (*excluded.as_object())->size() == 1
+            ? Get(excluded, "const")
+            : nullptr;
+    if (type != "integer" || !value || !value->is_s64()) {
+      throw std::runtime_error("Only \"not\": {\"const\": <integer>} on an "
+                               "integer is supported (" + path + ')');
+    }
+    return *value;
+  }
+
+  // One branch of an anyOf, and the type that picks it.
+  struct Branch {
+    str type;
+    str title;
+    const Node *schema;
+  };
+
+  // Returns the branches of the anyOf in `schema`, at `path`.
+  vector<Branch> Branches(const Node &schema, const str &path) {
+    const Node *any_of = Get(schema, "anyOf");
+    if (!any_of->is_array() || (*any_of->as_array())->empty()) {
+      throw std::runtime_error("anyOf must be a non-empty array (" + path
+                               + ')');
+    }
+    for (const auto &[key, value] : *schema.as_object().value()) {
+      if (!kAnnotations.contains(key) && strcmp(key, "anyOf") != 0) {
+        throw std::runtime_error(str("Keyword \"") + key + "\" next to "
+                                 "anyOf is unsupported (" + path + ')');
+      }
+    }
+    vector<Branch> branches;
+    for (const Node *branch : **any_of->as_array()) {
+      const Node *ref = Get(*branch, "$ref");
+      const Node &typed = ref ? *RefFile(*ref).root : *branch;
+      const Node *type = Get(typed, "type");
+      const Node *title = Get(ref ? typed : *branch, "title");
+      if (!type || !type->is_string() || !title || !title->is_string()) {
+        throw std::runtime_error("Each anyOf branch needs one type and a "
+                                 "title (" + path + ')');
+      }
+      const str t = *type->as_string();
+      for (const Branch &other : branches) {
+        const bool overlap =
+            other.type == t
+            || (other.type == "number" && t == "integer")
+            || (other.type == "integer" && t == "number");
+        if (overlap) {
+          throw std::runtime_error("anyOf branches must differ in type ("
+                                   + path + ')');
+        }
+      }
+      branches.push_back({t, *title->as_string(), branch});
+    }
+    return branches;
+  }
+
+  void EmitNumberChecks(std::ostream &out, const Node &schema,
+                        const NodeExpr &node, const u32 level) {
+    const Node *minimum = Get(schema, "minimum");
+    const Node *maximum = Get(schema, "maximum");
+    if (!minimum && !maximum) return;
+    const str pad = Indent(level);
+    out << pad << "{\n"
+        << pad << "  const f64 x = NumberValue(" << node.ref << ");\n";
+    std::stringstream bound;
+    bound.precision(17);
+    if (minimum) {
+      bound << NumberValue(*minimum);
+      out << pad << "  if (x < " << Literal(bound.str()) << ") return false;\n";
+      bound.str("");
+    }
+    if (maximum) {
+      bound << NumberValue(*maximum);
+      out << pad << "  if (x > " << Literal(bound.str()) << ") return false;\n";
+    }
+    out << pad << "}\n";
+  }
+
+  // Makes sure a printed number reads as a floating-point literal.
+  static str Literal(str number) {
+    if (number.find_first_of(".eE") == str::npos) number += ".0";
+    return number;
+  }
+
+  void EmitObjectChecks(std::ostream &out, const Node &schema,
+                        const NodeExpr &node, const str &name,
+                        const str &path, const u32 level) {
+    const str pad = Indent(level);
+    const Node *properties = Get(schema, "properties");
+    const Node *required = Get(schema, "required");
+    const Node *additional = Get(schema, "additionalProperties");
+    const Node *property_names = Get(schema, "propertyNames");
+
+    // Properties in declaration order, and the bit each required one sets.
+    vector<std::pair<const char *, const Node *>> declared;
+    if (properties) {
+      for (const auto &[key, value] : **properties->as_object()) {
+        declared.emplace_back(key, value);
+      }
+    }
+    std::map<str, u32> required_bits;
+    if (required) {
+      for (const Node *key : **required->as_array()) {
+        const str k = *key->as_string();
+        const bool known = std::ranges::any_of(declared, [&](const auto &p) {
+          return k == p.first;
+        });
+        if (!known) {
+          throw std::runtime_error(name + " requires undeclared property " + k);
+        }
+        const auto bit = static_cast<u32>(required_bits.size());
+        if (bit == 64) {
+          throw std::runtime_error(name + " has over 64 required properties");
+        }
+        required_bits.emplace(k, bit);
+      }
+    }
+
+    if (!required_bits.empty()) out << pad << "u64 found = 0;\n";
+    out << pad << "for (const auto &[key, value] : *" << node.access
+        << "as_object().value()) {\n";
+    const str inner = Indent(level + 1);
+    if (property_names) {
+      // Keys are always strings, so only the string keywords mean anything.
+      for (const auto &[keyword, value] : **property_names->as_object()) {
+        const str_view k = keyword;
+        if (k == "type" && value->is_string()
+            && str_view(*value->as_string()) == "string") {
+          continue;
+        }
+        if (k != "minLength" && k != "maxLength" && k != "format"
+            && !kAnnotations.contains(k)) {
+          throw std::runtime_error(str("Unsupported propertyNames keyword \"")
+                                   + keyword + "\" in " + path);
+        }
+      }
+      EmitStringChecks(out, *property_names, "key", level + 1);
+    }
+    // Group keys by first character for the switch.
+    std::map<char, vector<std::pair<const char *, const Node *>>> buckets;
+    for (const auto &property : declared) {
+      buckets[property.first[0]].push_back(property);
+    }
+    if (!buckets.empty()) {
+      out << inner << "switch (key[0]) {\n";
+      for (const auto &[first, bucket] : buckets) {
+        out << inner << "  case '" << (first == '\'' ? "\\'" : str(1, first))
+            << "':\n";
+        for (const auto &[key, value] : bucket) {
+          out << inner << "    if (strcmp(key, " << Quote(key)
+              << ") == 0) {\n";
+          EmitChecks(out, *value, kValue, name + PascalCase(key),
+                     path + '.' + key, level + 4, false);
+          if (required_bits.contains(key)) {
+            out << inner << "      found |= u64{1} << "
+                << required_bits.at(key) << ";\n";
+          }
+          out << inner << "      continue;\n" << inner << "    }\n";
+        }
+        out << inner << "    break;\n";
+      }
+      out << inner << "  default:\n" << inner << "    break;\n"
+          << inner << "}\n";
+    }
+    // Only keys that weren't declared get this far.
+    if (!additional || (additional->is_bool() && *additional->as_bool())) {
+      // Anything goes.
+    } else if (additional->is_bool()) {
+      out << inner << "return false;\n";
+    } else {
+      EmitChecks(out, *additional, kValue, name + "Value", path + ".*",
+                 level + 1, false);
+    }
+    out << pad << "}\n";
+    if (!required_bits.empty()) {
+      const u64 mask = required_bits.size() == 64
+                         ? ~u64{0}
+                         : (u64{1} << required_bits.size()) - 1;
+      out << pad << "if (found != " << mask << "u) return false;\n";
+    }
+  }
+
+  void EmitArrayChecks(std::ostream &out, const Node &schema,
+                       const NodeExpr &node, const str &name,
+                       const str &path, const u32 level) {
+    const str pad = Indent(level);
+    const Node *items = Get(schema, "items");
+    const Node *max_items = Get(schema, "maxItems");
+    const Node *unique = Get(schema, "uniqueItems");
+    const bool unique_items = unique && *unique->as_bool();
+    if (!items && !max_items && !unique_items) return;
+    out << pad << "const Array &array = *" << node.access
+        << "as_array().value();\n";
+    if (max_items) {
+      out << pad << "if (array.size() > " << max_items->as_s64().value()
+          << ") return false;\n";
+    }
+    if (items && Get(*items, "$ref")) {
+      out << pad << "if (scheduler) {\n"
+          << pad << "  if (!scheduler->MatchesAll(array, "
+          << RefFunction(*Get(*items, "$ref")) << ")) return false;\n"
+          << pad << "} else {\n"
+          << pad << "  for (const Node *element : array) {\n";
+      EmitChecks(out, *items, kElement, name + "Item", path + "[]",
+                 level + 2, false);
+      out << pad << "  }\n" << pad << "}\n";
+    } else if (items) {
+      out << pad << "for (const Node *element : array) {\n";
+      EmitChecks(out, *items, kElement, name + "Item", path + "[]",
+                 level + 1, false);
+      out << pad << "}\n";
+    }
+    if (unique_items) {
+      out << pad << "for (u64 i = 0; i < array.size(); ++i) {\n"
+          << pad << "  for (u64 j = i + 1; j < array.size(); ++j) {\n"
+          << pad << "    if (Equal(*array[i], *array[j])) return false;\n"
+          << pad << "  }\n"
+          << pad << "}\n";
+    }
+  }
+
+  static str ReaderName(const File &file) {
+    return "Read" + PascalCase(file.title);
+  }
+
+  // Emits the definition of a reader template called `name` for `schema`,
+  // which is found at `path`. `method` is the handler member for the Node
+  // itself; those for its parts add on to it.
+  void EmitReaderFunction(const str &name, const Node &schema,
+                          const str &path, const str &method) {
+    reader_declarations_.emplace_back(name, path);
+    std::stringstream body;
+    EmitRead(body, schema, kNode, "", name, path, method, 1, true);
+    readers_ << "template <typename Reader, typename Handler>\n"
+             << "void " << name << "(const rose::json::Node &node, "
+             << "Reader &reader,\n"
+             << str(name.size() + 6, ' ')
+             << "[[maybe_unused]] Handler &handler) {\n"
+             << "  using namespace rose::json;\n"
+             << "  using namespace readers_internal;\n"
+             << body.str() << "}\n\n";
+  }
+
+  // Emits statements that read `node` as `schema` and pass what they read
+  // to the handler member `method`, after `key` if it isn't empty. Nested
+  // object and array schemas are only written out inline when
+  // `function_body` is true; otherwise they get a reader of their own called
+  // `name`. The schema has already been checked by EmitChecks.
+  void EmitRead(std::ostream &out, const Node &schema, const NodeExpr &node,
+                const str &key, const str &name, const str &path,
+                const str &method, const u32 level,
+                const bool function_body) {
+    const str pad = Indent(level);
+    const str args = key.empty() ? node.ref : key + ", " + node.ref;
+    if (const Node *ref = Get(schema, "$ref")) {
+      out << pad << "if constexpr (requires { handler." << method << '('
+          << args << "); }) {\n"
+          << pad << "  handler." << method << '(' << args << ");\n"
+          << pad << "} else {\n"
+          << pad << "  Ignore ignore;\n"
+          << pad << "  " << RefReader(*ref) << '(' << node.ref
+          << ", reader, ignore);\n"
+          << pad << "}\n";
+      if (const vector<str> names = RequiredWithRef(schema, path);
+          !names.empty()) {
+        out << pad << "reader.ExpectFound(FoundProperties(" << node.ref
+            << ", " << List(names) << "),\n"
+            << pad << "                   " << List(names) << ");\n";
+      }
+      return;
+    }
+    if (Get(schema, "anyOf")) {
+      const vector<Branch> branches = Branches(schema, path);
+      str expected = "Expected ";
+      for (u64 i = 0; i < branches.size(); ++i) {
+        out << pad << (i == 0 ? "if (" : "} else if (")
+            << TypeTest(branches[i].type, node.access) << ") {\n";
+        const str title = PascalCase(branches[i].title);
+        EmitRead(out, *branches[i].schema, node, key, name + title,
+                 path + '<' + branches[i].title + '>', method + title,
+                 level + 1, false);
+        if (i != 0) expected += i + 1 == branches.size() ? " or " : ", ";
+        expected += Article(branches[i].type);
+      }
+      out << pad << "} else {\n"
+          << pad << "  reader.Fail(" << Quote(expected) << ");\n"
+          << pad << "}\n";
+      return;
+    }
+    const Node *type = Get(schema, "type");
+    if (!type->is_string()) {
+      throw std::runtime_error("Readers don't support type lists (" + path
+                               + ')');
+    }
+    const str t = *type->as_string();
+    const bool nested = (t == "object" && HasObjectKeywords(schema))
+                     || (t == "array" && HasArrayKeywords(schema));
+    if (nested && !function_body) {
+      if (!key.empty()) {
+        throw std::runtime_error("Readers don't support nested "
+                                 "additionalProperties (" + path + ')');
+      }
+      EmitReaderFunction(name, schema, path, method);
+      out << pad << name << '(' << node.ref << ", reader, handler);\n";
+      return;
+    }
+    if (t == "object" && nested) {
+      EmitReadObject(out, schema, node, name, path, method, level);
+      return;
+    }
+    if (t == "array" && nested) {
+      EmitReadArray(out, schema, node, name, path, method, level);
+      return;
+    }
+    str value;
+    if (t == "object" || t == "array") {
+      out << pad << "reader.Expect" << (t == "object" ? "Object" : "Array")
+          << '(' << node.ref << ");\n";
+      out << pad << "if constexpr (requires { handler." << method << '('
+          << args << "); }) {\n"
+          << pad << "  handler." << method << '(' << args << ");\n"
+          << pad << "}\n";
+      return;
+    }
+    out << pad << "{\n";
+    if (t == "string") {
+      EmitReadString(out, schema, node, level + 1);
+    } else if (t == "integer") {
+      out << pad << "  [[maybe_unused]] const s64 x = reader.ExpectS64("
+          << node.ref;
+      const Node *minimum = Get(schema, "minimum");
+      const Node *maximum = Get(schema, "maximum");
+      if (minimum || maximum) {
+        out << ", "
+            << (minimum ? IntegerLiteral(*minimum)
+                        : str("std::numeric_limits<s64>::min()"))
+            << ", "
+            << (maximum ? IntegerLiteral(*maximum)
+                        : str("std::numeric_limits<s64>::max()"));
+      }
+      out << ");\n";
+      if (const Node *excluded = Get(schema, "not")) {
+        const str value = IntegerLiteral(ExcludedConst(*excluded, t, path));
+        out << pad << "  if (x == " << value << ") {\n"
+            << pad << "    reader.Fail(\"Expected a value other than " << value
+            << "\");\n"
+            << pad << "  }\n";
+      }
+    } else if (t == "number") {
+      const Node *minimum = Get(schema, "minimum");
+      const Node *maximum = Get(schema, "maximum");
+      std::stringstream bound;
+      bound.precision(17);
+      str low = "-std::numeric_limits<f64>::infinity()";
+      str high = "std::numeric_limits<f64>::infinity()";
+      if (minimum) {
+        bound << NumberValue(*minimum);
+        low = Literal(bound.str());
+        bound.str("");
+      }
+      if (maximum) {
+        bound << NumberValue(*maximum);
+        high = Literal(bound.str());
+      }
+      out << pad << "  [[maybe_unused]] const f64 x = reader.ExpectNumber("
+          << node.ref << ", " << low << ", " << high << ");\n";
+    } else if (t == "boolean") {
+      out << pad << "  [[maybe_unused]] const bool x = reader.ExpectBool("
+          << node.ref << ");\n";
+    } else {
+      throw std::runtime_error("Readers don't support type \"" + t + "\" ("
+                               + path + ')');
+    }
+    const str x = key.empty() ? "x" : key + ", x";
+    out << pad << "  if constexpr (requires { handler." << method << '(' << x
+        << "); }) {\n"
+        << pad << "    handler." << method << '(' << x << ");\n"
+        << pad << "  }\n"
+        << pad << "}\n";
+  }
+
+  // Emits a declaration of `x`, the string `node` holds, or the DateTime
+  // it spells for the "date-time" format.
+  void EmitReadString(std::ostream &out, const Node &schema,
+                      const NodeExpr &node, const u32 level) {
+    const str pad = Indent(level);
+    const Node *min_length = Get(schema, "minLength");
+    const Node *max_length = Get(schema, "maxLength");
+    if (const Node *options = Get(schema, "enum")) {
+      const vector<str> names = EnumNames(*options);
+      str expected = "Expected one of";
+      for (const str &option : names) expected += " \"" + option + '"';
+      out << pad << "[[maybe_unused]] const u64 x =\n"
+          << pad << "    IndexOf(reader.ExpectString(" << node.ref << "), "
+          << List(names) << ");\n"
+          << pad << "if (x == " << names.size() << ") reader.Fail("
+          << Quote(expected) << ");\n";
+      return;
+    }
+    if (Get(schema, "format")) {
+      // EmitStringChecks has made sure it's "date-time".
+      out << pad << "[[maybe_unused]] const rose::time::DateTime x =\n"
+          << pad << "    reader.ExpectDateTime(" << node.ref << ");\n";
+      return;
+    }
+    out << pad << "[[maybe_unused]] const char *x = reader.ExpectString("
+        << node.ref;
+    if (min_length) out << ", " << min_length->as_s64().value();
+    out << ");\n";
+    if (max_length) {
+      const s64 n = max_length->as_s64().value();
+      out << pad << "if (CodePoints(x, " << n + 1 << ") > " << n << ") {\n"
+          << pad << "  reader.Fail(\"Expected at most " << n
+          << " characters\");\n"
+          << pad << "}\n";
+    }
+  }
+
+  void EmitReadObject(std::ostream &out, const Node &schema,
+                      const NodeExpr &node, const str &name, const str &path,
+                      const str &method, const u32 level) {
+    const str pad = Indent(level);
+    const Node *properties = Get(schema, "properties");
+    const Node *required = Get(schema, "required");
+    const Node *additional = Get(schema, "additionalProperties");
+    const Node *property_names = Get(schema, "propertyNames");
+
+    vector<std::pair<const char *, const Node *>> declared;
+    if (properties) {
+      for (const auto &[key, value] : **properties->as_object()) {
+        declared.emplace_back(key, value);
+      }
+    }
+    // Bits are handed out in the order "required" lists the names, which is
+    // also the order ExpectFound wants them in.
+    vector<str> required_names;
+    if (required) {
+      for (const Node *key : **required->as_array()) {
+        required_names.emplace_back(*key->as_string());
+      }
+    }
+    const auto bit_of = [&](const str_view key) -> opt<u64> {
+      const auto it = std::ranges::find(required_names, key);
+      if (it == required_names.end()) return std::nullopt;
+      return it - required_names.begin();
+    };
+
+    if (!required_names.empty()) out << pad << "u64 found = 0;\n";
+    out << pad << "for (const auto &[key, value] : reader.ExpectObject("
+        << node.ref << ")) {\n";
+    const str inner = Indent(level + 1);
+    out << inner << "const auto scope = reader.Key(key);\n";
+    if (property_names) {
+      if (Get(*property_names, "format")) {
+        throw std::runtime_error("Readers don't support formats in "
+                                 "propertyNames (" + path + ')');
+      }
+      if (const Node *min_length = Get(*property_names, "minLength")) {
+        const s64 n = min_length->as_s64().value();
+        if (n == 1) {
+          out << inner << "if (*key == '\\0') {\n"
+              << inner << "  reader.Fail(\"Expected a non-empty name\");\n"
+              << inner << "}\n";
+        } else if (n > 1) {
+          out << inner << "if (CodePoints(key, " << n << ") < " << n
+              << ") {\n"
+              << inner << "  reader.Fail(\"Expected a name of at least " << n
+              << " characters\");\n"
+              << inner << "}\n";
+        }
+      }
+      if (const Node *max_length = Get(*property_names, "maxLength")) {
+        const s64 n = max_length->as_s64().value();
+        out << inner << "if (CodePoints(key, " << n + 1 << ") > " << n
+            << ") {\n"
+            << inner << "  reader.Fail(\"Expected a name of at most " << n
+            << " characters\");\n"
+            << inner << "}\n";
+      }
+    }
+    std::map<char, vector<std::pair<const char *, const Node *>>> buckets;
+    for (const auto &property : declared) {
+      buckets[property.first[0]].push_back(property);
+    }
+    if (!buckets.empty()) {
+      out << inner << "switch (key[0]) {\n";
+      for (const auto &[first, bucket] : buckets) {
+        out << inner << "  case '" << (first == '\'' ? "\\'" : str(1, first))
+            << "':\n";
+        for (const auto &[key, value] : bucket) {
+          out << inner << "    if (strcmp(key, " << Quote(key)
+              << ") == 0) {\n";
+          EmitRead(out, *value, kValue, "", name + PascalCase(key),
+                   path + '.' + key, method + PascalCase(key), level + 4,
+                   false);
+          if (const opt<u64> bit = bit_of(key)) {
+            out << inner << "      found |= u64{1} << " << *bit << ";\n";
+          }
+          out << inner << "      continue;\n" << inner << "    }\n";
+        }
+        out << inner << "    break;\n";
+      }
+      out << inner << "  default:\n" << inner << "    break;\n"
+          << inner << "}\n";
+    }
+    if (!additional || (additional->is_bool() && *additional->as_bool())) {
+      // Anything goes.
+    } else if (additional->is_bool()) {
+      out << inner << "reader.Fail(\"Unexpected property\");\n";
+    } else {
+      EmitRead(out, *additional, kValue, "key", name + "Value", path + ".*",
+               method + "Value", level + 1, false);
+    }
+    out << pad << "}\n";
+    if (!required_names.empty()) {
+      out << pad << "reader.ExpectFound(found, {";
+      for (u64 i = 0; i < required_names.size(); ++i) {
+        out << (i == 0 ? "" : ", ") << Quote(required_names[i]);
+      }
+      out << "});\n";
+    }
+  }
+
+  void EmitReadArray(std::ostream &out, const Node &schema,
+                     const NodeExpr &node, const str &name, const str &path,
+                     const str &method, const u32 level) {
+    const str pad = Indent(level);
+    const Node *items = Get(schema, "items");
+    const Node *max_items = Get(schema, "maxItems");
+    const Node *unique = Get(schema, "uniqueItems");
+    const bool unique_items = unique && *unique->as_bool();
+    out << pad << "const Array &array = reader.ExpectArray(" << node.ref
+        << ");\n";
+    if (max_items) {
+      const s64 n = max_items->as_s64().value();
+      out << pad << "if (array.size() > " << n << ") {\n"
+          << pad << "  reader.Fail(\"Expected at most " << n
+          << " items\");\n"
+          << pad << "}\n";
+    }
+    out << pad << "if constexpr (requires { handler." << method
+        << "(array); }) {\n"
+        << pad << "  handler." << method << "(array);\n"
+        << pad << "}\n";
+    if (!items && !unique_items) return;
+    out << pad << "for (u64 i = 0; i < array.size(); ++i) {\n"
+        << pad << "  const auto element = reader.Index(i);\n";
+    if (unique_items) {
+      out << pad << "  for (u64 j = 0; j < i; ++j) {\n"
+          << pad << "    if (Equal(*array[j], *array[i])) {\n"
+          << pad << "      reader.Fail(\"Duplicate item\");\n"
+          << pad << "    }\n"
+          << pad << "  }\n";
+    }
+    if (items) {
+      EmitRead(out, *items, kItem, "", name + "Item", path + "[]",
+               method + "Item", level + 1, false);
+    }
+    out << pad << "}\n";
+  }
+
+  // Returns "a string", "an object" and so on for a type.
+  static str Article(const str &type) {
+    const bool vowel = type == "object" || type == "array" || type == "integer";
+    return (vowel ? "an " : "a ") + (type == "number" ? str("number") : type);
+  }
+
+  static str IntegerLiteral(const Node &bound) {
+    if (!bound.is_s64()) {
+      throw std::runtime_error("Expected an integer bound in schema");
+    }
+    const s64 n = bound.as_s64().value();
+    // The most negative s64 has no literal of its own.
+    if (n == std::numeric_limits<s64>::min()) {
+      return "std::numeric_limits<s64>::min()";
+    }
+    return std::to_string(n);
+  }
+
+  // Returns the schema file `ref` points at.
+  const File &RefFile(const Node &ref) const {
+    const str file = std::filesystem::path(*ref.as_string()).filename();
+    for (const File &f : files_) {
+      if (f.name == file) return f;
+    }
+    throw std::runtime_error("Unresolved $ref \"" + str(*ref.as_string())
+                             + "\" (pass " + file + " to the generator)");
+  }
+
+  // Returns the reader for the schema file `ref` points at.
+  str RefReader(const Node &ref) const { return ReaderName(RefFile(ref)); }
+
+  // Returns the function that validates the schema file `ref` points at.
+  str RefFunction(const Node &ref) const { return RefFile(ref).function; }
+
+  str namespace_;
+  u64 schema_hash_ = 0xCBF29CE484222325;
+  vector<File> files_;
+  // Every generated function, along with the schema path it checks.
+  vector<std::pair<str, str>> declarations_;
+  std::stringstream definitions_;
+  // The same for readers.
+  vector<std::pair<str, str>> reader_declarations_;
+  std::stringstream readers_;
+};
+
+}  // namespace
+
+int main(const s32 argc, const char *argv[]) {
+  if (argc < 4) {
+    std::cerr << "Usage: " << argv[0]
+              << " <output_dir> <namespace> <schema.json>...\n";
+    return EXIT_FAILURE;
+  }
+  const std::filesystem::path output_dir = argv[1];
+  try {
+    rose::ArenaAllocator allocator(kArenaSizeBytes);
+    Generator generator(argv[2]);
+    for (s32 i = 3; i < argc; ++i) {
+      std::ifstream fin(argv[i]);
+      if (!fin) throw std::runtime_error(str("Can't open ") + argv[i]);
+      std::stringstream text;
+      text << fin.rdbuf();
+      Tokenizer tokenizer(text, allocator);
+      // The Parser is kept alive by the arena; only its root is needed.
+      auto *parser = allocator.Create<Parser>(tokenizer.Tokenize(), allocator);
+      parser->Parse();
+      generator.AddFile(argv[i], text.view(), parser->root());
+    }
+    generator.Generate();
+    std::filesystem::create_directories(output_dir);
+    std::ofstream header(output_dir / "validators.h");
+    generator.WriteHeader(header);
+    std::ofstream source(output_dir / "validators.cc");
+    generator.WriteSource(source);
+    std::ofstream readers(output_dir / "readers.h");
+    generator.WriteReaders(readers);
+  } catch (const std::exception &e) {
+    std::cerr << argv[0] << ": " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}